@@ -1,16 +1,33 @@
 /*
  * shelli - Educational Shell
- * builtins.c - Built-in commands: cd, pwd, exit, help
+ * builtins.c - Built-in commands and in-process utilities
+ *
+ * Besides the shell builtins (cd, pwd, exit, export, cachestats, ...), the most
+ * common utilities (echo, printf, test/[, true, false, cat) run inside
+ * the shell so they cost no fork/exec. They write through BuiltinIO,
+ * which is either an fd or the executor's capture store.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "builtins.h"
-
-static const char *builtins[] = {"cd", "pwd", "exit", "help", NULL};
+#include "executor.h"
+#include "plancache.h"
+#include "parallel.h"
+#include "memo.h"
+#include "vars.h"
+#include "outbuf.h"
+#include "vtparse.h"
+#include "execevent.h"
+#include "builtin_hash.h"  /* Generated from builtins.def at build time */
 
 static const char *help_text =
     "shelli - Educational Shell\n"
@@ -20,25 +37,105 @@ static const char *help_text =
     "  pwd         Print working directory\n"
     "  exit [n]    Exit shell with status n (default: 0)\n"
     "  help        Show this help message\n"
+    "  cachestats  Show cache and execution event counters\n"
+    "  pipesize [size|auto|default|bench [MiB]]\n"
+    "              Show or set the pipe buffer size, or benchmark sizes\n"
+    "  pty [on|off]\n"
+    "              Run captured commands on a pseudo-terminal (line\n"
+    "              buffered, in colour) instead of a pipe\n"
+    "  renderer [full|line|null]\n"
+    "              Show or switch the display: framed panels, a summary\n"
+    "              line per stage, or command output only\n"
+    "  parallel [-j N] cmd [args] [::: items]\n"
+    "              Run cmd once per item (stdin lines) on N workers;\n"
+    "              {} is replaced by the item, output stays in order\n"
+    "  memo [-i input] [-e VAR] cmd [args]\n"
+    "              Run cmd or replay the stdout of its last success;\n"
+    "              memo --clear empties the cache\n"
+    "  NAME=value  Set a shell variable\n"
+    "  export [NAME[=value]...]\n"
+    "              Pass variables to commands, or list exported ones\n"
+    "  unset NAME...\n"
+    "              Remove variables\n"
+    "\n"
+    "Utilities (run without forking):\n"
+    "  echo [-n] [args]       printf fmt [args]\n"
+    "  test expr, [ expr ]    true, false\n"
+    "  cat [file...]\n"
     "\n"
     "Features:\n"
-    "  - Pipes: cmd1 | cmd2 | cmd3\n"
+    "  - Pipes: cmd1 | cmd2 | cmd3 (PIPESIZE=1m cmd1 | cmd2 per pipeline)\n"
+    "  - Lists: cmd1 && cmd2 || cmd3; cmd4\n"
     "  - Redirects: cmd < in.txt, cmd > out.txt, cmd >> log.txt\n"
+    "  - Here-strings: cmd <<< \"text\" (heredocs <<EOF in scripts)\n"
     "  - Quoting: 'single quotes', \"double quotes\"\n"
+    "  - Globs: *.c, file?.txt, [a-z]*, **/*.h\n"
+    "  - Variables: $NAME, ${NAME}, $? (not in 'single quotes')\n"
     "\n"
     "Debug mode:\n"
     "  Run with --debug to see step-by-step execution\n";
 
-int builtin_is_builtin(const char *name) {
-    for (int i = 0; builtins[i]; i++) {
-        if (strcmp(name, builtins[i]) == 0) {
-            return 1;
+void builtin_io_fd(BuiltinIO *io, int in_fd, int out_fd) {
+    io->in_fd = in_fd;
+    io->out_fd = out_fd;
+    io->buf = NULL;
+    io->vt = NULL;
+}
+
+void builtin_io_buffer(BuiltinIO *io, int in_fd, OutBuf *buf) {
+    io->in_fd = in_fd;
+    io->out_fd = -1;
+    io->buf = buf;
+    io->vt = NULL;
+}
+
+int builtin_io_write(BuiltinIO *io, const void *data, size_t len) {
+    /* Capture: if the store fails, drop the rest like a full pipe */
+    if (io->buf) {
+        int ret = io->vt ? vtparse_feed(io->vt, data, len) : outbuf_append(io->buf, data, len);
+        if (ret < 0) io->buf = NULL;
+    }
+    if (io->out_fd < 0) return 0;
+
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(io->out_fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
         }
+        p += n;
+        len -= (size_t)n;
     }
     return 0;
 }
 
-static int builtin_cd(Command *cmd) {
+int builtin_io_printf(BuiltinIO *io, const char *fmt, ...) {
+    char small[512];
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, args);
+    va_end(args);
+    if (n < 0) return -1;
+    if ((size_t)n < sizeof(small)) {
+        return builtin_io_write(io, small, (size_t)n);
+    }
+
+    /* Too long for the stack buffer: format again into the heap */
+    char *big = malloc((size_t)n + 1);
+    if (!big) return -1;
+    va_start(args, fmt);
+    vsnprintf(big, (size_t)n + 1, fmt, args);
+    va_end(args);
+    int ret = builtin_io_write(io, big, (size_t)n);
+    free(big);
+    return ret;
+}
+
+static int builtin_cd(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)io;
+    (void)should_exit;
     const char *dir;
 
     if (cmd->argc < 2) {
@@ -59,17 +156,19 @@ static int builtin_cd(Command *cmd) {
     return 0;
 }
 
-static int builtin_pwd(void) {
+static int builtin_pwd(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)cmd;
+    (void)should_exit;
     char cwd[4096];
     if (getcwd(cwd, sizeof(cwd)) == NULL) {
         perror("pwd");
         return 1;
     }
-    printf("%s\n", cwd);
-    return 0;
+    return builtin_io_printf(io, "%s\n", cwd) < 0 ? 1 : 0;
 }
 
-static int builtin_exit(Command *cmd, int *should_exit) {
+static int builtin_exit(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)io;
     *should_exit = 1;
     if (cmd->argc >= 2) {
         return atoi(cmd->argv[1]);
@@ -77,27 +176,670 @@ static int builtin_exit(Command *cmd, int *should_exit) {
     return 0;
 }
 
-static int do_help(void) {
-    printf("%s", help_text);
+static int builtin_help_cmd(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)cmd;
+    (void)should_exit;
+    return builtin_io_write(io, help_text, strlen(help_text)) < 0 ? 1 : 0;
+}
+
+static int builtin_cachestats(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)cmd;
+    (void)should_exit;
+    unsigned long hits, misses;
+    int entries;
+    plancache_stats(&hits, &misses, &entries);
+
+    unsigned long lookups = hits + misses;
+    builtin_io_printf(io, "plan cache: %d/%d entries, %lu hits, %lu misses (%.1f%% hit rate)\n",
+                      entries, PLANCACHE_CAPACITY, hits, misses,
+                      lookups ? 100.0 * hits / lookups : 0.0);
+
+    unsigned long stores;
+    long long bytes;
+    memo_stats(&hits, &misses, &stores);
+    memo_disk_usage(&entries, &bytes);
+
+    lookups = hits + misses;
+    builtin_io_printf(io, "memo cache: %d entries (%.1f KiB), %lu hits, %lu misses, %lu stored (%.1f%% hit rate)\n",
+                      entries, bytes / 1024.0, hits, misses, stores,
+                      lookups ? 100.0 * hits / lookups : 0.0);
+
+    int exported;
+    unsigned long rebuilds;
+    vars_stats(&entries, &exported, &rebuilds);
+    builtin_io_printf(io, "environment: %d variables, %d exported, envp rebuilt %lu times\n",
+                      entries, exported, rebuilds);
+
+    uint64_t events[EXEC_EV_COUNT], dropped;
+    exec_event_stats(events, &dropped);
+    builtin_io_printf(io, "exec events: %llu forks, %llu threads, %llu builtins, %llu pipes, "
+                      "%llu redirects, %llu dropped\n",
+                      (unsigned long long)events[EXEC_EV_FORK],
+                      (unsigned long long)events[EXEC_EV_THREAD],
+                      (unsigned long long)events[EXEC_EV_BUILTIN],
+                      (unsigned long long)events[EXEC_EV_PIPE],
+                      (unsigned long long)(events[EXEC_EV_REDIR_IN] + events[EXEC_EV_REDIR_OUT] +
+                                           events[EXEC_EV_HEREDOC]),
+                      (unsigned long long)dropped);
     return 0;
 }
 
-int builtin_execute(Command *cmd, int *should_exit) {
-    *should_exit = 0;
+#define BENCH_WRITE_CHUNK (128 * 1024)   /* Producer write size */
+#define BENCH_READ_CHUNK  (1024 * 1024)  /* Consumer read size */
+
+/*
+ * Push total bytes through one pipe of the given size from a forked
+ * producer to a consumer that touches every cache line, returns MiB/s or -1
+ */
+static double bench_pipe(int size, size_t total) {
+    int fds[2];
+    if (executor_pipe(fds, size) < 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        static char chunk[BENCH_WRITE_CHUNK];
+        close(fds[0]);
+        memset(chunk, 'x', sizeof(chunk));
+        for (size_t sent = 0; sent < total; ) {
+            size_t n = total - sent < sizeof(chunk) ? total - sent : sizeof(chunk);
+            ssize_t w = write(fds[1], chunk, n);
+            if (w <= 0) _exit(1);
+            sent += (size_t)w;
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+
+    char *buf = malloc(BENCH_READ_CHUNK);
+    struct timespec t0, t1;
+    unsigned long sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (ssize_t n; buf && (n = read(fds[0], buf, BENCH_READ_CHUNK)) > 0; ) {
+        for (ssize_t i = 0; i < n; i += 64) sum += (unsigned char)buf[i];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    close(fds[0]);
+    free(buf);
+    waitpid(pid, NULL, 0);
+
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if (!buf || sum == 0 || secs <= 0) return -1;
+    return total / (1024.0 * 1024.0) / secs;
+}
+
+static int pipesize_bench(BuiltinIO *io, const char *mib_arg) {
+    long mib = mib_arg ? strtol(mib_arg, NULL, 10) : 256;
+    if (mib <= 0) {
+        fprintf(stderr, "pipesize: bench: invalid size '%s'\n", mib_arg);
+        return 1;
+    }
+
+    int max = executor_pipe_max_size();
+    int sizes[] = {64 * 1024, 256 * 1024, 1024 * 1024, max};
+    int count = max > 1024 * 1024 ? 4 : 3;
+
+    builtin_io_printf(io, "%ld MiB through one pipe (producer %d KiB writes):\n",
+                      mib, BENCH_WRITE_CHUNK / 1024);
+    for (int i = 0; i < count; i++) {
+        double rate = bench_pipe(sizes[i], (size_t)mib * 1024 * 1024);
+        if (rate < 0) {
+            builtin_io_printf(io, "  %6d KiB  failed\n", sizes[i] / 1024);
+        } else {
+            builtin_io_printf(io, "  %6d KiB  %8.1f MiB/s%s\n", sizes[i] / 1024, rate,
+                              i == 0 ? "  (kernel default)" : "");
+        }
+    }
+    return 0;
+}
+
+static int builtin_pipesize(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+
+    if (cmd->argc < 2) {
+        int size = executor_get_pipe_size();
+        int max = executor_pipe_max_size() / 1024;
+        if (size == PIPE_SIZE_AUTO) {
+            builtin_io_printf(io, "pipe size: auto (grows while writers block, max %d KiB)\n", max);
+        } else if (size == PIPE_SIZE_DEFAULT) {
+            builtin_io_printf(io, "pipe size: default (kernel, max %d KiB)\n", max);
+        } else {
+            builtin_io_printf(io, "pipe size: %d KiB (max %d KiB)\n", size / 1024, max);
+        }
+        return 0;
+    }
+
+    if (strcmp(cmd->argv[1], "bench") == 0) {
+        return pipesize_bench(io, cmd->argc > 2 ? cmd->argv[2] : NULL);
+    }
+
+    int size;
+    if (parse_pipe_size(cmd->argv[1], &size) < 0) {
+        fprintf(stderr, "pipesize: invalid size '%s' (bytes with k/m suffix, auto or default)\n",
+                cmd->argv[1]);
+        return 1;
+    }
+    executor_set_pipe_size(size);
+    return 0;
+}
+
+/* pty [on|off]: show or set whether captured commands run on a pty */
+static int builtin_pty(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+
+    if (cmd->argc < 2) {
+        builtin_io_printf(io, "pty: %s\n", executor_get_pty() ?
+                          "on (last stage writes a pseudo-terminal)" : "off (last stage writes a pipe)");
+        return 0;
+    }
+    if (strcmp(cmd->argv[1], "on") == 0) {
+        executor_set_pty(1);
+    } else if (strcmp(cmd->argv[1], "off") == 0) {
+        executor_set_pty(0);
+    } else {
+        fprintf(stderr, "pty: invalid mode '%s' (on or off)\n", cmd->argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+/* Display hooks, set by the interactive shell */
+static int (*renderer_select)(const char *name) = NULL;
+static const char *(*renderer_current)(void) = NULL;
+
+void builtins_set_renderer(int (*select)(const char *name), const char *(*current)(void)) {
+    renderer_select = select;
+    renderer_current = current;
+}
+
+/* renderer [full|line|null]: show or switch how the shell displays commands */
+static int builtin_renderer(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+
+    if (!renderer_select) {
+        fprintf(stderr, "renderer: no display to switch (not interactive)\n");
+        return 1;
+    }
+    if (cmd->argc < 2) {
+        builtin_io_printf(io, "renderer: %s\n", renderer_current());
+        return 0;
+    }
+    if (renderer_select(cmd->argv[1]) < 0) {
+        fprintf(stderr, "renderer: unknown renderer '%s' (full, line or null)\n", cmd->argv[1]);
+        return 1;
+    }
+    return 0;
+}
+
+/* NAME=value [NAME=value...]: set shell variables */
+static int builtin_assign(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)io;
+    (void)should_exit;
+
+    for (int i = 0; i < cmd->argc; i++) {
+        if (!vars_is_assignment(cmd->argv[i])) {
+            fprintf(stderr, "shelli: %s: assignments before a command are not supported "
+                    "(use export)\n", cmd->argv[i]);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    for (int i = 0; i < cmd->argc && status == 0; i++) {
+        char *eq = strchr(cmd->argv[i], '=');
+        *eq = '\0';
+        int ret = vars_set(cmd->argv[i], eq + 1, VARS_KEEP);
+        *eq = '=';
+        if (ret < 0) {
+            fprintf(stderr, "shelli: %s: cannot set variable\n", cmd->argv[i]);
+            status = 1;
+        }
+    }
+    /* Even after a failure: earlier assignments may have changed envp */
+    vars_sync_environ();
+    return status;
+}
+
+/* vars_list callback: print one export line */
+static void export_print(const char *name_value, size_t name_len, int exported, void *ctx) {
+    (void)exported;
+    builtin_io_printf(ctx, "export %.*s=\"%s\"\n", (int)name_len, name_value,
+                      name_value + name_len + 1);
+}
+
+static int builtin_export(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+
+    if (cmd->argc < 2) return vars_list(1, export_print, io) < 0 ? 1 : 0;
+
+    int status = 0;
+    for (int i = 1; i < cmd->argc; i++) {
+        char *eq = strchr(cmd->argv[i], '=');
+        int ret;
+        if (eq) {
+            *eq = '\0';
+            ret = vars_set(cmd->argv[i], eq + 1, VARS_EXPORT);
+            *eq = '=';
+        } else {
+            ret = vars_export(cmd->argv[i]);
+        }
+        if (ret < 0) {
+            fprintf(stderr, "export: %s: not a valid identifier\n", cmd->argv[i]);
+            status = 1;
+        }
+    }
+    vars_sync_environ();
+    return status;
+}
+
+static int builtin_unset(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)io;
+    (void)should_exit;
+
+    int status = 0;
+    for (int i = 1; i < cmd->argc; i++) {
+        if (vars_unset(cmd->argv[i]) < 0) {
+            fprintf(stderr, "unset: %s: not a valid identifier\n", cmd->argv[i]);
+            status = 1;
+        }
+    }
+    vars_sync_environ();
+    return status;
+}
+
+static int builtin_echo(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+    int newline = 1;
+    int i = 1;
 
-    if (strcmp(cmd->argv[0], "cd") == 0) {
-        return builtin_cd(cmd);
-    } else if (strcmp(cmd->argv[0], "pwd") == 0) {
-        return builtin_pwd();
-    } else if (strcmp(cmd->argv[0], "exit") == 0) {
-        return builtin_exit(cmd, should_exit);
-    } else if (strcmp(cmd->argv[0], "help") == 0) {
-        return do_help();
+    while (i < cmd->argc && strcmp(cmd->argv[i], "-n") == 0) {
+        newline = 0;
+        i++;
     }
 
+    for (int first = i; i < cmd->argc; i++) {
+        if (i > first && builtin_io_write(io, " ", 1) < 0) return 1;
+        if (builtin_io_write(io, cmd->argv[i], strlen(cmd->argv[i])) < 0) return 1;
+    }
+
+    if (newline && builtin_io_write(io, "\n", 1) < 0) return 1;
+    return 0;
+}
+
+/*
+ * Decode one backslash escape at *p (just past the backslash) into *out,
+ * advancing *p; unknown escapes are kept literally
+ */
+static int printf_escape(const char **p, char *out) {
+    const char *s = *p;
+    int n = 1;
+
+    switch (*s) {
+        case 'n':  out[0] = '\n'; break;
+        case 't':  out[0] = '\t'; break;
+        case 'r':  out[0] = '\r'; break;
+        case 'a':  out[0] = '\a'; break;
+        case 'b':  out[0] = '\b'; break;
+        case 'f':  out[0] = '\f'; break;
+        case 'v':  out[0] = '\v'; break;
+        case '\\': out[0] = '\\'; break;
+        case '"':  out[0] = '"';  break;
+        case '0': case '1': case '2': case '3':
+        case '4': case '5': case '6': case '7': {
+            int value = 0;
+            for (int k = 0; k < 3 && *s >= '0' && *s <= '7'; k++) {
+                value = value * 8 + (*s++ - '0');
+            }
+            out[0] = (char)value;
+            *p = s;
+            return 1;
+        }
+        case '\0':
+            out[0] = '\\';
+            return 1;
+        default:
+            out[0] = '\\';
+            out[1] = *s;
+            n = 2;
+            break;
+    }
+
+    *p = s + 1;
+    return n;
+}
+
+/*
+ * Convert a printf numeric argument; a leading quote gives the character
+ * code, as in POSIX printf. Returns -1 (and warns) on a bad number.
+ */
+static int printf_number(const char *arg, int is_signed, long long *sval,
+                         unsigned long long *uval) {
+    if (arg[0] == '\'' || arg[0] == '"') {
+        *sval = (unsigned char)arg[1];
+        *uval = (unsigned char)arg[1];
+        return 0;
+    }
+
+    char *end;
+    errno = 0;
+    if (is_signed) {
+        *sval = strtoll(arg, &end, 0);
+    } else {
+        *uval = strtoull(arg, &end, 0);
+    }
+    if (end == arg || *end || errno) {
+        fprintf(stderr, "printf: %s: invalid number\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+static int builtin_printf(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+    if (cmd->argc < 2) {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+
+    const char *format = cmd->argv[1];
+    int argi = 2;
+    int status = 0;
+
+    /* The format is reused until every argument has been consumed */
+    do {
+        int start_argi = argi;
+
+        for (const char *p = format; *p; ) {
+            if (*p == '\\') {
+                char out[2];
+                p++;
+                int n = printf_escape(&p, out);
+                if (builtin_io_write(io, out, (size_t)n) < 0) return 1;
+                continue;
+            }
+            if (*p != '%') {
+                const char *run = p;
+                while (*p && *p != '%' && *p != '\\') p++;
+                if (builtin_io_write(io, run, (size_t)(p - run)) < 0) return 1;
+                continue;
+            }
+            if (p[1] == '%') {
+                if (builtin_io_write(io, "%", 1) < 0) return 1;
+                p += 2;
+                continue;
+            }
+
+            /* Copy flags, width and precision into a spec for snprintf */
+            char spec[32];
+            int len = 0;
+            spec[len++] = *p++;
+            while (*p && strchr("-+ #0123456789.", *p) && len < (int)sizeof(spec) - 4) {
+                spec[len++] = *p++;
+            }
+            char conv = *p ? *p++ : '\0';
+            const char *arg = argi < cmd->argc ? cmd->argv[argi++] : NULL;
+            long long sval = 0;
+            unsigned long long uval = 0;
+
+            switch (conv) {
+                case 's':
+                    spec[len++] = 's';
+                    spec[len] = '\0';
+                    builtin_io_printf(io, spec, arg ? arg : "");
+                    break;
+                case 'c':
+                    if (arg && arg[0]) builtin_io_write(io, arg, 1);
+                    break;
+                case 'd': case 'i':
+                    if (arg && printf_number(arg, 1, &sval, &uval) < 0) status = 1;
+                    spec[len++] = 'l';
+                    spec[len++] = 'l';
+                    spec[len++] = conv;
+                    spec[len] = '\0';
+                    builtin_io_printf(io, spec, sval);
+                    break;
+                case 'u': case 'o': case 'x': case 'X':
+                    if (arg && printf_number(arg, 0, &sval, &uval) < 0) status = 1;
+                    spec[len++] = 'l';
+                    spec[len++] = 'l';
+                    spec[len++] = conv;
+                    spec[len] = '\0';
+                    builtin_io_printf(io, spec, uval);
+                    break;
+                default:
+                    fprintf(stderr, "printf: %%%c: invalid directive\n", conv ? conv : ' ');
+                    return 1;
+            }
+        }
+
+        /* A format without directives consumes nothing: stop, don't loop */
+        if (argi == start_argi) break;
+    } while (argi < cmd->argc);
+
+    return status;
+}
+
+/* test: unary file and string primaries */
+static int test_unary(const char *op, const char *arg) {
+    struct stat st;
+
+    if (strcmp(op, "-z") == 0) return arg[0] == '\0';
+    if (strcmp(op, "-n") == 0) return arg[0] != '\0';
+    if (strcmp(op, "-r") == 0) return access(arg, R_OK) == 0;
+    if (strcmp(op, "-w") == 0) return access(arg, W_OK) == 0;
+    if (strcmp(op, "-x") == 0) return access(arg, X_OK) == 0;
+    if (strcmp(op, "-L") == 0 || strcmp(op, "-h") == 0) {
+        return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+    }
+
+    /* The rest inspect stat(); a missing file is simply false */
+    if (op[0] != '-' || !op[1] || op[2] || !strchr("efdsp", op[1])) return -1;
+    if (stat(arg, &st) < 0) return 0;
+
+    switch (op[1]) {
+        case 'e': return 1;
+        case 'f': return S_ISREG(st.st_mode);
+        case 'd': return S_ISDIR(st.st_mode);
+        case 's': return st.st_size > 0;
+        default:  return S_ISFIFO(st.st_mode);
+    }
+}
+
+/* test: binary string and integer comparisons */
+static int test_binary(const char *lhs, const char *op, const char *rhs) {
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) return strcmp(lhs, rhs) == 0;
+    if (strcmp(op, "!=") == 0) return strcmp(lhs, rhs) != 0;
+
+    static const char *int_ops[] = {"-eq", "-ne", "-lt", "-le", "-gt", "-ge", NULL};
+    int which = -1;
+    for (int i = 0; int_ops[i]; i++) {
+        if (strcmp(op, int_ops[i]) == 0) which = i;
+    }
+    if (which < 0) return -1;
+
+    char *end_l, *end_r;
+    long long a = strtoll(lhs, &end_l, 10);
+    long long b = strtoll(rhs, &end_r, 10);
+    if (end_l == lhs || *end_l || end_r == rhs || *end_r) {
+        fprintf(stderr, "test: integer expression expected\n");
+        return -2;
+    }
+
+    switch (which) {
+        case 0:  return a == b;
+        case 1:  return a != b;
+        case 2:  return a < b;
+        case 3:  return a <= b;
+        case 4:  return a > b;
+        default: return a >= b;
+    }
+}
+
+/*
+ * Evaluate test arguments by count, following the POSIX rules for up to
+ * four arguments. Returns 1 true, 0 false, -1 syntax error, -2 reported.
+ */
+static int test_eval(char **argv, int argc) {
+    switch (argc) {
+        case 0:
+            return 0;
+        case 1:
+            return argv[0][0] != '\0';
+        case 2:
+            if (strcmp(argv[0], "!") == 0) return !test_eval(argv + 1, 1);
+            return test_unary(argv[0], argv[1]);
+        case 3: {
+            int r = test_binary(argv[0], argv[1], argv[2]);
+            if (r != -1) return r;
+            if (strcmp(argv[0], "!") == 0) {
+                r = test_eval(argv + 1, 2);
+                return r < 0 ? r : !r;
+            }
+            if (strcmp(argv[0], "(") == 0 && strcmp(argv[2], ")") == 0) {
+                return test_eval(argv + 1, 1);
+            }
+            return -1;
+        }
+        case 4:
+            if (strcmp(argv[0], "!") == 0) {
+                int r = test_eval(argv + 1, 3);
+                return r < 0 ? r : !r;
+            }
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+static int builtin_test(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)io;
+    (void)should_exit;
+    const char *name = cmd->argv[0];
+    int argc = cmd->argc - 1;
+
+    if (strcmp(name, "[") == 0) {
+        if (argc < 1 || strcmp(cmd->argv[cmd->argc - 1], "]") != 0) {
+            fprintf(stderr, "[: missing ']'\n");
+            return 2;
+        }
+        argc--;
+    }
+
+    int r = test_eval(cmd->argv + 1, argc);
+    if (r == -1) {
+        fprintf(stderr, "%s: syntax error\n", name);
+    }
+    return r < 0 ? 2 : !r;
+}
+
+static int builtin_true(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)cmd;
+    (void)io;
+    (void)should_exit;
+    return 0;
+}
+
+static int builtin_false(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)cmd;
+    (void)io;
+    (void)should_exit;
     return 1;
 }
 
+/* Copy an fd to the builtin's output */
+static int cat_fd(BuiltinIO *io, int fd) {
+    char buf[4096];
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) return 0;
+        if (builtin_io_write(io, buf, (size_t)n) < 0) return -1;
+    }
+}
+
+static int builtin_cat(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+    int status = 0;
+
+    if (cmd->argc < 2) {
+        if (cat_fd(io, io->in_fd) < 0) {
+            if (errno != EPIPE) perror("cat");
+            return 1;
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < cmd->argc; i++) {
+        const char *path = cmd->argv[i];
+        int fd = strcmp(path, "-") == 0 ? io->in_fd : open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "cat: %s: %s\n", path, strerror(errno));
+            status = 1;
+            continue;
+        }
+        int err = cat_fd(io, fd) < 0 ? errno : 0;
+        if (fd != io->in_fd) close(fd);
+        if (err == EPIPE) return 1;  /* Reader went away: stop quietly */
+        if (err) {
+            fprintf(stderr, "cat: %s: %s\n", path, strerror(err));
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+/*
+ * Dispatch table, expanded from builtins.def in the same order the hash
+ * generator saw the names
+ */
+#define BUILTIN(name, handler, flags) {name, handler, flags},
+static const Builtin builtin_table[] = {
+#include "builtins.def"
+};
+#undef BUILTIN
+
+/* NAME=value words are not names, so they are not in the hashed table */
+static const Builtin assign_builtin = {"NAME=value", builtin_assign, BUILTIN_PARENT};
+
+const Builtin *builtin_lookup(const char *name) {
+    uint32_t slot = builtin_name_hash(name, BUILTIN_HASH_SEED) & (BUILTIN_HASH_SIZE - 1);
+    int idx = builtin_hash_slots[slot];
+
+    /* One comparison confirms the name (unknown names may share a slot) */
+    if (idx >= 0 && strcmp(builtin_table[idx].name, name) == 0) return &builtin_table[idx];
+    return vars_is_assignment(name) ? &assign_builtin : NULL;
+}
+
+int builtin_is_builtin(const char *name) {
+    return builtin_lookup(name) != NULL;
+}
+
+int builtin_execute(Command *cmd, BuiltinIO *io, int *should_exit) {
+    *should_exit = 0;
+
+    /* Normally resolved once by the parser */
+    const Builtin *b = cmd->builtin ? cmd->builtin : builtin_lookup(cmd->argv[0]);
+    if (!b) return 1;
+
+    BuiltinIO std_io;
+    if (!io) {
+        fflush(stdout);
+        builtin_io_fd(&std_io, STDIN_FILENO, STDOUT_FILENO);
+        io = &std_io;
+    }
+
+    return b->handler(cmd, io, should_exit);
+}
+
 const char *builtin_help(void) {
     return help_text;
 }
@@ -6,16 +6,80 @@
 #ifndef BUILTINS_H
 #define BUILTINS_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "parser.h"
 
+/* Builtin flags */
+#define BUILTIN_PARENT        0x1  /* Must run in the shell process (changes shell state) */
+#define BUILTIN_PIPELINE_SAFE 0x2  /* Leaves shell state alone, runs on a thread as a pipeline stage */
+
+struct OutBuf;
+struct VtParse;
+
+/*
+ * Standard streams of a builtin running inside the shell: plain fds, or
+ * a capture store so no pipe (and no child to drain it) is needed
+ */
+typedef struct BuiltinIO {
+    int in_fd;          /* Standard input */
+    int out_fd;         /* Standard output, -1 for buf only */
+    struct OutBuf *buf; /* Capture store, also fed when out_fd is set
+                           (NULL: none) */
+    struct VtParse *vt; /* Interprets what goes to buf, as for a captured
+                           child (NULL: stored raw) */
+} BuiltinIO;
+
+/* Handler: returns exit status, sets *should_exit to end the shell */
+typedef int (*BuiltinFn)(Command *cmd, BuiltinIO *io, int *should_exit);
+
+typedef struct Builtin {
+    const char *name;
+    BuiltinFn handler;
+    int flags;
+} Builtin;
+
+/* Find a built-in by name in O(1), returns NULL for external commands */
+const Builtin *builtin_lookup(const char *name);
+
 /* Check if command is a built-in, returns 1 if yes */
 int builtin_is_builtin(const char *name);
 
 /* Execute built-in command, returns exit status
+ * io may be NULL for the shell's own stdin/stdout.
  * Sets *should_exit to 1 if shell should terminate */
-int builtin_execute(Command *cmd, int *should_exit);
+int builtin_execute(Command *cmd, BuiltinIO *io, int *should_exit);
+
+/* Point a builtin's streams at fds */
+void builtin_io_fd(BuiltinIO *io, int in_fd, int out_fd);
+
+/* Capture a builtin's output into buf (may be NULL to discard it) */
+void builtin_io_buffer(BuiltinIO *io, int in_fd, struct OutBuf *buf);
+
+/* Write to a builtin's output, returns 0 on success, -1 on error */
+int builtin_io_write(BuiltinIO *io, const void *data, size_t len);
+
+/* Formatted write to a builtin's output, returns 0 on success, -1 on error */
+int builtin_io_printf(BuiltinIO *io, const char *fmt, ...);
+
+/* Let the renderer builtin switch the display: select returns 0 or -1
+ * for an unknown name, current names the active one (unset: no TUI) */
+void builtins_set_renderer(int (*select)(const char *name), const char *(*current)(void));
 
 /* Get help text for all built-ins */
 const char *builtin_help(void);
 
+/*
+ * Name hash for the perfect-hash table. Shared with tools/mkbuiltinhash.c,
+ * which searches for a seed that maps every name to its own slot.
+ */
+static inline uint32_t builtin_name_hash(const char *name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    while (*name) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
 #endif /* BUILTINS_H */
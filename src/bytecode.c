@@ -0,0 +1,636 @@
+/*
+ * shelli - Educational Shell
+ * bytecode.c - Script compiler, interpreter loop and on-disk cache
+ *
+ * A script is compiled once into a flat instruction stream. Lists become
+ * conditional jumps, so `a && b || c` runs as:
+ *
+ *   SPAWN a, WAIT, JNZ L1, SPAWN b, WAIT, L1: JZ L2, SPAWN c, WAIT, L2:
+ *
+ * The compiled form is cached under ~/.cache/shelli/bytecode, keyed by the
+ * script path and validated against its mtime, size and content hash, so
+ * re-running an unchanged script skips lexing and parsing entirely.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "bytecode.h"
+#include "lexer.h"
+#include "executor.h"
+#include "builtins.h"
+#include "plancache.h"
+#include "hash.h"
+#include "fsutil.h"
+#include "vars.h"
+
+#define ARGV_END UINT32_MAX      /* Terminates each argv in argv_tab */
+#define NO_JUMP  UINT32_MAX
+
+#define CACHE_MAGIC   "SHBC"
+#define CACHE_VERSION 6
+
+/* On-disk header, followed by code, argv_tab and strings */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int64_t mtime;          /* Script modification time (seconds) */
+    uint64_t size;          /* Script size in bytes */
+    uint64_t hash;          /* Script content hash */
+    uint32_t code_len;
+    uint32_t argv_len;
+    uint32_t str_len;
+    uint32_t reserved;
+    uint64_t body_hash;     /* Hash of code, argv_tab and strings */
+} CacheHeader;
+
+const char *op_name(int op) {
+    switch (op) {
+        case OP_HALT:      return "HALT";
+        case OP_PIPE:      return "PIPE";
+        case OP_REDIR_IN:  return "REDIR_IN";
+        case OP_REDIR_OUT: return "REDIR_OUT";
+        case OP_SPAWN:     return "SPAWN";
+        case OP_BUILTIN:   return "BUILTIN";
+        case OP_WAIT:      return "WAIT";
+        case OP_JZ:        return "JZ";
+        case OP_JNZ:       return "JNZ";
+        case OP_ERROR:     return "ERROR";
+        case OP_EVAL:      return "EVAL";
+        default:           return "?";
+    }
+}
+
+void program_init(Program *prog) {
+    memset(prog, 0, sizeof(*prog));
+}
+
+void program_free(Program *prog) {
+    free(prog->code);
+    free(prog->argv_tab);
+    free(prog->strings);
+    free(prog->argv_ptrs);
+    program_init(prog);
+}
+
+/*
+ * Grow an array so it can hold at least need elements
+ */
+static int grow(void **buf, uint32_t *cap, uint32_t need, size_t elem_size) {
+    if (need <= *cap) return 0;
+    uint32_t new_cap = *cap ? *cap : 64;
+    while (new_cap < need) new_cap *= 2;
+    void *p = realloc(*buf, (size_t)new_cap * elem_size);
+    if (!p) return -1;
+    *buf = p;
+    *cap = new_cap;
+    return 0;
+}
+
+static int add_string(Program *prog, const char *s, uint32_t *offset) {
+    uint32_t len = (uint32_t)strlen(s) + 1;
+    if (grow((void **)&prog->strings, &prog->str_cap,
+             prog->str_len + len, 1) < 0) return -1;
+    memcpy(prog->strings + prog->str_len, s, len);
+    *offset = prog->str_len;
+    prog->str_len += len;
+    return 0;
+}
+
+static int add_argv(Program *prog, Command *cmd, uint32_t *index) {
+    if (grow((void **)&prog->argv_tab, &prog->argv_cap,
+             prog->argv_len + cmd->argc + 1, sizeof(uint32_t)) < 0) return -1;
+
+    uint32_t start = prog->argv_len;
+    for (int i = 0; i < cmd->argc; i++) {
+        uint32_t off;
+        if (add_string(prog, cmd->argv[i], &off) < 0) return -1;
+        prog->argv_tab[prog->argv_len++] = off;
+    }
+    prog->argv_tab[prog->argv_len++] = ARGV_END;
+    *index = start;
+    return 0;
+}
+
+static int emit(Program *prog, int op, uint16_t a, uint32_t b) {
+    if (grow((void **)&prog->code, &prog->code_cap,
+             prog->code_len + 1, sizeof(Insn)) < 0) return -1;
+    Insn *insn = &prog->code[prog->code_len++];
+    insn->op = (uint8_t)op;
+    insn->pad = 0;
+    insn->a = a;
+    insn->b = b;
+    return 0;
+}
+
+static int emit_string(Program *prog, int op, uint16_t a, const char *s) {
+    uint32_t off;
+    if (add_string(prog, s, &off) < 0) return -1;
+    return emit(prog, op, a, off);
+}
+
+/* Redirects are pending state consumed by the next SPAWN or BUILTIN */
+static int emit_redirects(Program *prog, Command *cmd) {
+    if (cmd->redir_in.type != REDIR_NONE &&
+        emit_string(prog, OP_REDIR_IN, (uint16_t)cmd->redir_in.type,
+                    cmd->redir_in.filename) < 0) return -1;
+    if (cmd->redir_out.type != REDIR_NONE &&
+        emit_string(prog, OP_REDIR_OUT, (uint16_t)cmd->redir_out.type,
+                    cmd->redir_out.filename) < 0) return -1;
+    return 0;
+}
+
+static int compile_pipeline(Program *prog, Pipeline *pipeline) {
+    Command *first = pipeline->first;
+    uint32_t argv_idx;
+
+    /* A lone builtin runs inside the shell, like executor_run does */
+    if (pipeline->cmd_count == 1 && first->builtin) {
+        if (emit_redirects(prog, first) < 0) return -1;
+        if (add_argv(prog, first, &argv_idx) < 0) return -1;
+        return emit(prog, OP_BUILTIN, (uint16_t)first->argc, argv_idx);
+    }
+
+    for (Command *cmd = first; cmd; cmd = cmd->next) {
+        if (cmd->next &&
+            emit(prog, OP_PIPE, 0, (uint32_t)pipeline->pipe_size) < 0) return -1;
+
+        if (emit_redirects(prog, cmd) < 0) return -1;
+        if (add_argv(prog, cmd, &argv_idx) < 0) return -1;
+        if (emit(prog, OP_SPAWN, (uint16_t)cmd->argc, argv_idx) < 0) return -1;
+    }
+
+    return emit(prog, OP_WAIT, 0, 0);
+}
+
+int bytecode_compile_list(Program *prog, CommandList *list) {
+    uint32_t pending = NO_JUMP;
+
+    for (int i = 0; i < list->count; i++) {
+        if (compile_pipeline(prog, list->entries[i].pipeline) < 0) return -1;
+
+        /* The previous connector's jump skips exactly this pipeline */
+        if (pending != NO_JUMP) {
+            prog->code[pending].b = prog->code_len;
+            pending = NO_JUMP;
+        }
+
+        int op = list->entries[i].op;
+        if (op == LIST_AND || op == LIST_OR) {
+            pending = prog->code_len;
+            if (emit(prog, op == LIST_AND ? OP_JNZ : OP_JZ, 0, 0) < 0) return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Compile one script line; syntax errors become OP_ERROR so that the
+ * lines before them still run, matching line-by-line execution. Lines
+ * with glob patterns or variable references depend on the filesystem or
+ * the shell's state when they run, so they are kept as source (OP_EVAL)
+ * instead of being compiled.
+ */
+static int compile_line(Program *prog, const char *line, int lineno) {
+    char error[256] = "";
+    char msg[300];
+    int owned = 0;
+
+    CommandList *list = plancache_lookup(line);
+    if (!list) {
+        TokenList tokens;
+        int ret = lexer_tokenize(line, &tokens);
+        if (ret == LEXER_INCOMPLETE) {
+            snprintf(msg, sizeof(msg), "line %d: heredoc delimiter not found", lineno);
+            return emit_string(prog, OP_ERROR, 0, msg);
+        }
+        if (ret < 0) {
+            snprintf(msg, sizeof(msg), "line %d: tokenization error (unterminated quote?)", lineno);
+            return emit_string(prog, OP_ERROR, 0, msg);
+        }
+        if (tokenlist_is_dynamic(&tokens)) {
+            tokenlist_free(&tokens);
+            return emit_string(prog, OP_EVAL, 0, line);
+        }
+        list = parser_parse_list(&tokens, error, sizeof(error));
+        tokenlist_free(&tokens);
+
+        if (!list) {
+            if (!error[0]) return 0;
+            snprintf(msg, sizeof(msg), "line %d: %s", lineno, error);
+            return emit_string(prog, OP_ERROR, 0, msg);
+        }
+        if (plancache_insert(line, list) < 0) owned = 1;
+    }
+
+    int ret = bytecode_compile_list(prog, list);
+    if (owned) commandlist_free(list);
+    return ret;
+}
+
+/* Is the line missing the body of a heredoc? */
+static int heredoc_open(const char *line) {
+    TokenList tokens;
+    int ret = lexer_tokenize(line, &tokens);
+    if (ret == 0) tokenlist_free(&tokens);
+    return ret == LEXER_INCOMPLETE;
+}
+
+int bytecode_compile_source(Program *prog, const char *src, size_t len) {
+    char *line = malloc(len + 1);
+    if (!line) return -1;
+
+    size_t pos = 0;
+    int lineno = 0;
+
+    while (pos < len) {
+        size_t end = pos;
+        while (end < len && src[end] != '\n') end++;
+        lineno++;
+
+        size_t n = end - pos;
+        memcpy(line, src + pos, n);
+        line[n] = '\0';
+        while (n > 0 && line[n - 1] == '\r') line[--n] = '\0';
+        pos = end + 1;
+
+        /* A heredoc takes the lines up to its delimiter with it */
+        while (pos < len && strstr(line, "<<") && heredoc_open(line)) {
+            end = pos;
+            while (end < len && src[end] != '\n') end++;
+            lineno++;
+
+            line[n++] = '\n';
+            memcpy(line + n, src + pos, end - pos);
+            n += end - pos;
+            line[n] = '\0';
+            while (line[n - 1] == '\r') line[--n] = '\0';
+            pos = end + 1;
+        }
+
+        /* Skip blank lines and comments */
+        const char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        if (compile_line(prog, line, lineno) < 0) {
+            free(line);
+            return -1;
+        }
+    }
+
+    free(line);
+    return emit(prog, OP_HALT, 0, 0);
+}
+
+/*
+ * Resolve argv_tab offsets into exec-ready pointer arrays
+ */
+static int program_link(Program *prog) {
+    free(prog->argv_ptrs);
+    prog->argv_ptrs = malloc((prog->argv_len ? prog->argv_len : 1) * sizeof(char *));
+    if (!prog->argv_ptrs) return -1;
+
+    for (uint32_t i = 0; i < prog->argv_len; i++) {
+        uint32_t off = prog->argv_tab[i];
+        if (off != ARGV_END && off >= prog->str_len) return -1;
+        prog->argv_ptrs[i] = off == ARGV_END ? NULL : prog->strings + off;
+    }
+    return 0;
+}
+
+/*
+ * Run a source line through the front end: lex, parse, then execute,
+ * expanding each list entry as it runs.
+ * Sets *should_exit if it ran the exit builtin.
+ */
+static int eval_line(const char *line, int *should_exit) {
+    TokenList tokens;
+    if (lexer_tokenize(line, &tokens) < 0) {
+        fprintf(stderr, "shelli: tokenization error (unterminated quote?)\n");
+        return 2;
+    }
+
+    char error[256] = "";
+    CommandList *list = parser_parse_list(&tokens, error, sizeof(error));
+    tokenlist_free(&tokens);
+    if (!list) {
+        if (!error[0]) return 0;
+        fprintf(stderr, "shelli: %s\n", error);
+        return 2;
+    }
+
+    int status = executor_run_list(list);
+    *should_exit = executor_exit_requested();
+    commandlist_free(list);
+    return status;
+}
+
+int bytecode_run(Program *prog) {
+    if (!prog->argv_ptrs && program_link(prog) < 0) {
+        fprintf(stderr, "shelli: invalid bytecode\n");
+        return 2;
+    }
+
+    /* Stages of the pipeline being assembled, run as a whole by WAIT */
+    Command *stages = NULL;
+    uint32_t stage_count = 0;
+    uint32_t stage_cap = 0;
+    int pipe_size = PIPE_SIZE_DEFAULT;
+    int failed = 0;         /* A stage could not be recorded */
+
+    int status = 0;
+    Redirect redir_in = {REDIR_NONE, NULL};
+    Redirect redir_out = {REDIR_NONE, NULL};
+
+    uint32_t pc = 0;
+    while (pc < prog->code_len) {
+        const Insn *insn = &prog->code[pc++];
+
+        switch (insn->op) {
+        case OP_HALT:
+            pc = prog->code_len;
+            break;
+
+        case OP_PIPE:
+            pipe_size = (int32_t)insn->b;
+            break;
+
+        case OP_REDIR_IN:
+            redir_in.type = insn->a;
+            redir_in.filename = prog->strings + insn->b;
+            break;
+
+        case OP_REDIR_OUT:
+            redir_out.type = insn->a;
+            redir_out.filename = prog->strings + insn->b;
+            break;
+
+        case OP_SPAWN: {
+            if (grow((void **)&stages, &stage_cap, stage_count + 1, sizeof(Command)) < 0) {
+                failed = 1;
+            } else {
+                Command *cmd = &stages[stage_count++];
+                memset(cmd, 0, sizeof(*cmd));
+                cmd->argv = &prog->argv_ptrs[insn->b];
+                cmd->argc = insn->a;
+                cmd->builtin = cmd->argc > 0 ? builtin_lookup(cmd->argv[0]) : NULL;
+                cmd->redir_in = redir_in;
+                cmd->redir_out = redir_out;
+            }
+            redir_in.type = REDIR_NONE;
+            redir_out.type = REDIR_NONE;
+            break;
+        }
+
+        case OP_BUILTIN: {
+            Command cmd = {0};
+            cmd.argv = &prog->argv_ptrs[insn->b];
+            cmd.argc = insn->a;
+            cmd.redir_in = redir_in;
+            cmd.redir_out = redir_out;
+            redir_in.type = REDIR_NONE;
+            redir_out.type = REDIR_NONE;
+
+            int should_exit = 0;
+            status = executor_run_builtin(&cmd, &should_exit);
+            if (should_exit) pc = prog->code_len;
+            break;
+        }
+
+        case OP_WAIT: {
+            /* The same stage launcher as -c and the REPL: pipeline-safe
+             * builtins run as threads, everything else is forked */
+            Pipeline pipeline = {stages, (int)stage_count, pipe_size};
+            for (uint32_t i = 0; i + 1 < stage_count; i++) stages[i].next = &stages[i + 1];
+
+            if (failed) {
+                fprintf(stderr, "shelli: out of memory\n");
+                status = 1;
+            } else if (stage_count > 0) {
+                status = executor_run(&pipeline);
+            }
+            stage_count = 0;
+            pipe_size = PIPE_SIZE_DEFAULT;
+            failed = 0;
+            break;
+        }
+
+        case OP_JZ:
+            if (status == 0) pc = insn->b;
+            break;
+
+        case OP_JNZ:
+            if (status != 0) pc = insn->b;
+            break;
+
+        case OP_ERROR:
+            fprintf(stderr, "shelli: %s\n", prog->strings + insn->b);
+            status = 2;
+            break;
+
+        case OP_EVAL: {
+            int should_exit = 0;
+            vars_set_status(status);
+            status = eval_line(prog->strings + insn->b, &should_exit);
+            if (should_exit) pc = prog->code_len;
+            break;
+        }
+
+        default:
+            fprintf(stderr, "shelli: bad opcode %d at %u\n", insn->op, pc - 1);
+            pc = prog->code_len;
+            status = 2;
+            break;
+        }
+    }
+
+    free(stages);
+    return status;
+}
+
+/*
+ * Build the cache file path for a script, returns 0 on success
+ */
+static int cache_path(const char *script, char *out, size_t out_size) {
+    char path[PATH_MAX];
+    if (cache_dir("bytecode", path, sizeof(path)) < 0) return -1;
+
+    char abs[PATH_MAX];
+    if (!realpath(script, abs)) return -1;
+
+    snprintf(out, out_size, "%s/%016llx.sbc", path,
+             (unsigned long long)hash_str(abs, HASH_SEED));
+    return 0;
+}
+
+/*
+ * Hash the serialized sections, so a damaged cache file is never run
+ */
+static uint64_t program_hash(const Program *prog) {
+    uint64_t h = hash_bytes(prog->code, prog->code_len * sizeof(Insn), HASH_SEED);
+    h = hash_bytes(prog->argv_tab, prog->argv_len * sizeof(uint32_t), h);
+    return hash_bytes(prog->strings, prog->str_len, h);
+}
+
+/*
+ * Load a cached program if it matches the script, returns 0 on hit
+ */
+static int cache_load(const char *path, const CacheHeader *want, Program *prog) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    CacheHeader h;
+    if (read_full(fd, &h, sizeof(h)) < 0 ||
+        memcmp(h.magic, CACHE_MAGIC, 4) != 0 || h.version != CACHE_VERSION ||
+        h.mtime != want->mtime || h.size != want->size || h.hash != want->hash) {
+        close(fd);
+        return -1;
+    }
+
+    if (grow((void **)&prog->code, &prog->code_cap, h.code_len, sizeof(Insn)) < 0 ||
+        grow((void **)&prog->argv_tab, &prog->argv_cap, h.argv_len, sizeof(uint32_t)) < 0 ||
+        grow((void **)&prog->strings, &prog->str_cap, h.str_len, 1) < 0 ||
+        read_full(fd, prog->code, h.code_len * sizeof(Insn)) < 0 ||
+        read_full(fd, prog->argv_tab, h.argv_len * sizeof(uint32_t)) < 0 ||
+        read_full(fd, prog->strings, h.str_len) < 0) {
+        close(fd);
+        program_free(prog);
+        return -1;
+    }
+    close(fd);
+
+    prog->code_len = h.code_len;
+    prog->argv_len = h.argv_len;
+    prog->str_len = h.str_len;
+
+    if (program_hash(prog) != h.body_hash) {
+        program_free(prog);
+        return -1;
+    }
+
+    /* Reject anything that would index outside the program */
+    for (uint32_t i = 0; i < prog->code_len; i++) {
+        const Insn *insn = &prog->code[i];
+        int bad = 0;
+        switch (insn->op) {
+            case OP_REDIR_IN:
+                bad = insn->b >= prog->str_len ||
+                      (insn->a != REDIR_IN && insn->a != REDIR_HEREDOC);
+                break;
+            case OP_REDIR_OUT: case OP_ERROR: case OP_EVAL:
+                bad = insn->b >= prog->str_len; break;
+            case OP_SPAWN: case OP_BUILTIN:
+                bad = (uint64_t)insn->b + insn->a >= prog->argv_len ||
+                      prog->argv_tab[insn->b + insn->a] != ARGV_END;
+                break;
+            case OP_JZ: case OP_JNZ:
+                bad = insn->b > prog->code_len; break;
+            default:
+                bad = insn->op > OP_EVAL; break;
+        }
+        if (bad) {
+            program_free(prog);
+            return -1;
+        }
+    }
+    if (prog->str_len > 0 && prog->strings[prog->str_len - 1] != '\0') {
+        program_free(prog);
+        return -1;
+    }
+
+    if (program_link(prog) < 0) {
+        program_free(prog);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Save a compiled program atomically (write to a temp file, then rename)
+ */
+static void cache_save(const char *path, const CacheHeader *key, const Program *prog) {
+    char tmp[PATH_MAX + 96];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+
+    CacheHeader h = *key;
+    memcpy(h.magic, CACHE_MAGIC, 4);
+    h.version = CACHE_VERSION;
+    h.code_len = prog->code_len;
+    h.argv_len = prog->argv_len;
+    h.str_len = prog->str_len;
+    h.reserved = 0;
+    h.body_hash = program_hash(prog);
+
+    int ok = write_full(fd, &h, sizeof(h)) == 0 &&
+             write_full(fd, prog->code, prog->code_len * sizeof(Insn)) == 0 &&
+             write_full(fd, prog->argv_tab, prog->argv_len * sizeof(uint32_t)) == 0 &&
+             write_full(fd, prog->strings, prog->str_len) == 0;
+
+    if (close(fd) < 0) ok = 0;
+    if (!ok || rename(tmp, path) < 0) {
+        unlink(tmp);
+    }
+}
+
+int bytecode_run_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "shelli: %s: %s\n", path, strerror(errno));
+        return 127;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "shelli: %s: %s\n", path, strerror(errno));
+        close(fd);
+        return 127;
+    }
+
+    size_t len = (size_t)st.st_size;
+    char *src = malloc(len ? len : 1);
+    if (!src || read_full(fd, src, len) < 0) {
+        fprintf(stderr, "shelli: %s: read failed\n", path);
+        free(src);
+        close(fd);
+        return 127;
+    }
+    close(fd);
+
+    CacheHeader key = {0};
+    key.mtime = (int64_t)st.st_mtime;
+    key.size = (uint64_t)st.st_size;
+    key.hash = hash_bytes(src, len, HASH_SEED);
+
+    Program prog;
+    program_init(&prog);
+
+    char cpath[PATH_MAX + 64];
+    int have_cache_path = cache_path(path, cpath, sizeof(cpath)) == 0;
+
+    if (!have_cache_path || cache_load(cpath, &key, &prog) < 0) {
+        if (bytecode_compile_source(&prog, src, len) < 0) {
+            fprintf(stderr, "shelli: %s: out of memory while compiling\n", path);
+            program_free(&prog);
+            free(src);
+            return 2;
+        }
+        if (have_cache_path) {
+            cache_save(cpath, &key, &prog);
+        }
+    }
+    free(src);
+
+    int status = bytecode_run(&prog);
+    program_free(&prog);
+    return status;
+}
@@ -0,0 +1,71 @@
+/*
+ * shelli - Educational Shell
+ * bytecode.h - Compact instruction stream for script execution
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+
+typedef enum {
+    OP_HALT = 0,    /* Stop execution */
+    OP_PIPE,        /* b = pipe size of the pipeline being assembled */
+    OP_REDIR_IN,    /* a = REDIR_IN or REDIR_HEREDOC, b = string (file or body) */
+    OP_REDIR_OUT,   /* a = REDIR_OUT or REDIR_APPEND, b = string */
+    OP_SPAWN,       /* a = argc, b = argv index: add one pipeline stage */
+    OP_BUILTIN,     /* a = argc, b = argv index: run builtin in the shell */
+    OP_WAIT,        /* Run the stages added (builtins as threads), status = last stage */
+    OP_JZ,          /* b = target: jump if status == 0 */
+    OP_JNZ,         /* b = target: jump if status != 0 */
+    OP_ERROR,       /* b = string: report a compile error, status = 2 */
+    OP_EVAL         /* b = string: run a source line that needs expanding */
+} OpCode;
+
+typedef struct {
+    uint8_t op;         /* OpCode */
+    uint8_t pad;
+    uint16_t a;
+    uint32_t b;
+} Insn;
+
+typedef struct {
+    Insn *code;         /* Instruction stream */
+    uint32_t code_len;
+    uint32_t code_cap;
+
+    uint32_t *argv_tab; /* String offsets, each argv ends with ARGV_END */
+    uint32_t argv_len;
+    uint32_t argv_cap;
+
+    char *strings;      /* NUL-separated string pool */
+    uint32_t str_len;
+    uint32_t str_cap;
+
+    char **argv_ptrs;   /* argv_tab resolved to pointers, built before running */
+} Program;
+
+/* Initialize an empty program */
+void program_init(Program *prog);
+
+/* Free all program storage */
+void program_free(Program *prog);
+
+/* Append code for a command list, returns 0 on success, -1 on error */
+int bytecode_compile_list(Program *prog, CommandList *list);
+
+/* Compile script source (one command list per line), returns 0 on success */
+int bytecode_compile_source(Program *prog, const char *src, size_t len);
+
+/* Run a compiled program, returns exit status of the last command */
+int bytecode_run(Program *prog);
+
+/* Run a script file, reusing the on-disk compiled form when it is current */
+int bytecode_run_file(const char *path);
+
+/* Get the mnemonic for an opcode */
+const char *op_name(int op);
+
+#endif /* BYTECODE_H */
@@ -0,0 +1,219 @@
+/*
+ * shelli - Educational Shell
+ * execevent.c - Typed execution trace events
+ *
+ * The executor records what it does (fork, pipe, redirect, exit, ...) as
+ * small fixed-size events rather than formatted strings. Events are
+ * counted always; while a sink is set they are also queued in a bounded
+ * lock-free ring (one sequence number per slot, so any thread can
+ * publish without a lock) and handed to the sink on its own thread.
+ * Text is produced only by exec_event_format, which the TUI calls for
+ * the lines it actually draws.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "execevent.h"
+#include "parser.h"
+
+#define RING_SIZE 256   /* Events queued between drains (power of two) */
+
+typedef struct {
+    size_t seq;         /* == position when free, position + 1 when full */
+    ExecEvent ev;
+} RingSlot;
+
+static RingSlot ring[RING_SIZE];
+static size_t ring_head = 0;    /* Next position to publish */
+static size_t ring_tail = 0;    /* Next position to deliver (sink thread) */
+static int ring_ready = 0;
+
+static ExecEventSink sink = NULL;
+static pthread_t sink_thread;
+static int draining = 0;
+
+static uint64_t counts[EXEC_EV_COUNT];
+static uint64_t dropped = 0;
+
+void exec_events_set_sink(ExecEventSink fn) {
+    if (!ring_ready) {
+        for (size_t i = 0; i < RING_SIZE; i++) ring[i].seq = i;
+        ring_ready = 1;
+    }
+    sink_thread = pthread_self();
+    sink = fn;
+}
+
+int exec_events_tracing(void) {
+    return sink != NULL;
+}
+
+/* Claim a slot and publish ev, returns -1 if the ring is full */
+static int ring_push(const ExecEvent *ev) {
+    size_t pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        RingSlot *slot = &ring[pos & (RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring_head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->ev = *ev;
+                __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+            /* Lost the race: pos now holds the current head */
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Take the oldest published event (single consumer), returns 0 if none */
+static int ring_pop(ExecEvent *ev) {
+    RingSlot *slot = &ring[ring_tail & (RING_SIZE - 1)];
+    size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != ring_tail + 1) return 0;
+
+    *ev = slot->ev;
+    __atomic_store_n(&slot->seq, ring_tail + RING_SIZE, __ATOMIC_RELEASE);
+    ring_tail++;
+    return 1;
+}
+
+void exec_events_drain(void) {
+    /* The sink may emit again (nested executor calls): deliver once */
+    if (!sink || draining || !pthread_equal(pthread_self(), sink_thread)) return;
+
+    ExecEvent ev;
+    draining = 1;
+    while (ring_pop(&ev)) sink(&ev);
+    draining = 0;
+}
+
+void exec_event_emit(int type, int arg, int32_t a, int32_t b, int64_t n, double ms,
+                     const char *s1, const char *s2) {
+    __atomic_fetch_add(&counts[type], 1, __ATOMIC_RELAXED);
+    if (!sink) return;
+
+    ExecEvent ev;
+    ev.type = (uint8_t)type;
+    ev.arg = (uint8_t)arg;
+    ev.a = a;
+    ev.b = b;
+    ev.ms = (float)ms;
+    ev.n = n;
+
+    /* s1, NUL, s2, NUL, truncated to fit */
+    size_t len = 0;
+    if (s1) {
+        len = strlen(s1);
+        if (len > EXEC_EVENT_TEXT - 2) len = EXEC_EVENT_TEXT - 2;
+        memcpy(ev.s, s1, len);
+    }
+    ev.s[len++] = '\0';
+    size_t len2 = s2 ? strlen(s2) : 0;
+    if (len2 > EXEC_EVENT_TEXT - 1 - len) len2 = EXEC_EVENT_TEXT - 1 - len;
+    if (len2 > 0) memcpy(ev.s + len, s2, len2);
+    ev.s[len + len2] = '\0';
+
+    /* Full: on the sink thread, make room by delivering what is queued */
+    if (ring_push(&ev) < 0) {
+        exec_events_drain();
+        if (ring_push(&ev) < 0) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    exec_events_drain();
+}
+
+/* The string after the first one in ev->s */
+static const char *second(const ExecEvent *ev) {
+    return ev->s + strlen(ev->s) + 1;
+}
+
+int exec_event_format(const ExecEvent *ev, char *buf, size_t size) {
+    static const char *heredoc_kind[] = {"pipe", "sealed memfd", "tmpfile"};
+    static const char *tee_kind[] = {"tee/splice, zero-copy", "copy", ""};
+    char from[EXEC_EVENT_TEXT + 8], to[EXEC_EVENT_TEXT + 8];
+
+    switch ((ExecEventType)ev->type) {
+        case EXEC_EV_FORK:
+            return snprintf(buf, size, "fork() → pid %d (%s)", ev->a, ev->s);
+        case EXEC_EV_THREAD:
+            return snprintf(buf, size, "thread: %s (builtin stage, no fork)", ev->s);
+        case EXEC_EV_BUILTIN:
+            return snprintf(buf, size, "builtin: %s", ev->s);
+        case EXEC_EV_PIPE:
+            if (ev->arg == EXEC_PIPE_SIZED) {
+                return snprintf(buf, size, "pipe() → fd[%d, %d] (%lld KiB)",
+                                ev->a, ev->b, (long long)ev->n);
+            }
+            if (ev->arg == EXEC_PIPE_REFUSED) {
+                return snprintf(buf, size, "pipe() → fd[%d, %d] (resize to %lld KiB refused)",
+                                ev->a, ev->b, (long long)ev->n);
+            }
+            return snprintf(buf, size, "pipe() → fd[%d, %d]", ev->a, ev->b);
+        case EXEC_EV_LINK:
+            if (ev->a > 0) snprintf(from, sizeof(from), "%d", ev->a);
+            else snprintf(from, sizeof(from), "thread %s", ev->s);
+            if (ev->b > 0) snprintf(to, sizeof(to), "%d", ev->b);
+            else snprintf(to, sizeof(to), "thread %s", second(ev));
+            return snprintf(buf, size, "pipe: %s stdout ──► %s stdin", from, to);
+        case EXEC_EV_PIPE_GROW:
+            return snprintf(buf, size, "pipe: %s stdin full, grew to %lld KiB",
+                            ev->s, (long long)ev->n);
+        case EXEC_EV_REDIR_IN:
+            return snprintf(buf, size, "  redirect: stdin ◄── %s", ev->s);
+        case EXEC_EV_REDIR_OUT:
+            return snprintf(buf, size, "  redirect: stdout ──► %s (%s)", ev->s,
+                            ev->arg ? "append" : "truncate");
+        case EXEC_EV_HEREDOC:
+            return snprintf(buf, size, "  redirect: stdin ◄── heredoc (%lld bytes, %s)",
+                            (long long)ev->n, heredoc_kind[ev->arg % 3]);
+        case EXEC_EV_TEE:
+            if (ev->arg == EXEC_TEE_FALLBACK) {
+                return snprintf(buf, size, "tee: splice unsupported for this file, copying");
+            }
+            return snprintf(buf, size, "tee: stdout ──► %s + result panel (%s)",
+                            ev->s, tee_kind[ev->arg % 3]);
+        case EXEC_EV_PTY:
+            if (ev->arg) {
+                return snprintf(buf, size, "pty: unavailable, %s writes a pipe", second(ev));
+            }
+            return snprintf(buf, size, "pty: %s stdout ──► %s (session leader)",
+                            second(ev), ev->s);
+        case EXEC_EV_EXIT:
+            if (ev->a > 0) {
+                return snprintf(buf, size, "exit: pid %d (%s) → status %d after %.1f ms",
+                                ev->a, ev->s, ev->b, ev->ms);
+            }
+            return snprintf(buf, size, "exit: thread %s → status %d after %.1f ms",
+                            ev->s, ev->b, ev->ms);
+        case EXEC_EV_SKIP:
+            return snprintf(buf, size, "list: %s skips %s (status %d)",
+                            list_op_str(ev->arg), ev->s, ev->b);
+        case EXEC_EV_MEMO:
+            if (ev->arg) {
+                return snprintf(buf, size, "memo: hit %s (%s, no fork)", ev->s, second(ev));
+            }
+            return snprintf(buf, size, "memo: miss, running %s", second(ev));
+        case EXEC_EV_NOTE:
+        case EXEC_EV_COUNT:
+            break;
+    }
+    return snprintf(buf, size, "%s", ev->s);
+}
+
+void exec_event_stats(uint64_t out[EXEC_EV_COUNT], uint64_t *out_dropped) {
+    for (int i = 0; i < EXEC_EV_COUNT; i++) {
+        out[i] = __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+    }
+    if (out_dropped) *out_dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,86 @@
+/*
+ * shelli - Educational Shell
+ * execevent.h - Typed execution trace events
+ */
+
+#ifndef EXECEVENT_H
+#define EXECEVENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    EXEC_EV_FORK,       /* a = pid, s = argv[0] */
+    EXEC_EV_THREAD,     /* s = argv[0] of a builtin pipeline stage */
+    EXEC_EV_BUILTIN,    /* s = argv[0] of a builtin run in the shell */
+    EXEC_EV_PIPE,       /* a, b = read/write fd, n = KiB, arg = EXEC_PIPE_* */
+    EXEC_EV_LINK,       /* a -> b pids (0: thread, names in s) */
+    EXEC_EV_PIPE_GROW,  /* n = KiB, s = reader's argv[0] */
+    EXEC_EV_REDIR_IN,   /* s = file */
+    EXEC_EV_REDIR_OUT,  /* s = file, arg = 1 for append */
+    EXEC_EV_HEREDOC,    /* n = bytes, arg = EXEC_HEREDOC_* */
+    EXEC_EV_TEE,        /* s = file, arg = EXEC_TEE_* */
+    EXEC_EV_PTY,        /* s = slave path then argv[0], arg = 1 if none opened */
+    EXEC_EV_EXIT,       /* a = pid (0: thread), b = status, ms, s = argv[0] */
+    EXEC_EV_SKIP,       /* arg = list op, b = status, s = argv[0] */
+    EXEC_EV_MEMO,       /* arg = 1 for a hit, s = key then argv[0] */
+    EXEC_EV_NOTE,       /* s = free-form text */
+    EXEC_EV_COUNT
+} ExecEventType;
+
+/* arg values */
+#define EXEC_PIPE_DEFAULT  0    /* Kernel default capacity */
+#define EXEC_PIPE_SIZED    1    /* Resized to n KiB */
+#define EXEC_PIPE_REFUSED  2    /* Resize to n KiB refused */
+
+#define EXEC_HEREDOC_PIPE    0
+#define EXEC_HEREDOC_MEMFD   1
+#define EXEC_HEREDOC_TMPFILE 2
+
+#define EXEC_TEE_SPLICE    0    /* tee/splice, zero-copy */
+#define EXEC_TEE_COPY      1    /* Copied through userspace */
+#define EXEC_TEE_FALLBACK  2    /* splice refused mid-run, now copying */
+
+#define EXEC_EVENT_TEXT 72
+
+/*
+ * One fixed-size event. Strings are copied (truncated) into s; a second
+ * string follows the first after its NUL.
+ */
+typedef struct {
+    uint8_t type;       /* ExecEventType */
+    uint8_t arg;
+    int32_t a;
+    int32_t b;
+    float ms;
+    int64_t n;
+    char s[EXEC_EVENT_TEXT];
+} ExecEvent;
+
+/* Receives events on the thread that set it */
+typedef void (*ExecEventSink)(const ExecEvent *ev);
+
+/* Set the sink (NULL: no tracing, events are only counted) */
+void exec_events_set_sink(ExecEventSink sink);
+
+/* Check whether events are being delivered */
+int exec_events_tracing(void);
+
+/*
+ * Record an event. Any thread may call this: the event goes through a
+ * lock-free ring, and is handed to the sink right away on the sink's
+ * thread or at the next drain otherwise. s1/s2 may be NULL.
+ */
+void exec_event_emit(int type, int arg, int32_t a, int32_t b, int64_t n, double ms,
+                     const char *s1, const char *s2);
+
+/* Hand queued events from other threads to the sink (sink thread only) */
+void exec_events_drain(void);
+
+/* Format an event as a trace line, returns its length */
+int exec_event_format(const ExecEvent *ev, char *buf, size_t size);
+
+/* Get per-type counts (since startup, traced or not) and ring overflows */
+void exec_event_stats(uint64_t counts[EXEC_EV_COUNT], uint64_t *dropped);
+
+#endif /* EXECEVENT_H */
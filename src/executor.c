@@ -3,474 +3,1260 @@
  * executor.c - Command execution with fork/exec/pipe/redirect
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* pipe2(), syscall(), F_SETPIPE_SZ, memfd_create(), posix_openpt() */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <time.h>
+#include <poll.h>
 #include <unistd.h>
+#include <limits.h>
+#include <termios.h>
 #include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <signal.h>
+#include <pthread.h>
 #include "executor.h"
 #include "builtins.h"
+#include "outbuf.h"
+#include "vtparse.h"
+#include "execevent.h"
+#include "fsutil.h"
+#include "vars.h"
+
+static ExecProgressCallback progress_callback = NULL;
+static pthread_t progress_thread;
+static ExecOutputCallback output_callback = NULL;
+static pthread_t output_thread;
+static int exit_requested = 0;
+static int session_pipe_size = PIPE_SIZE_DEFAULT;
+static int session_pty = 0;
+
+#define AUTO_PIPE_POLL_MS 20  /* Fill level sampling interval for auto pipe size */
+
+void executor_set_progress(ExecProgressCallback callback) {
+    progress_callback = callback;
+    progress_thread = pthread_self();
+}
 
-static ExecLogCallback log_callback = NULL;
+void executor_progress(const char *label, long done, long total) {
+    /* The TUI draws from one thread only */
+    if (!progress_callback || !pthread_equal(pthread_self(), progress_thread)) return;
+    progress_callback(label, done, total);
+}
 
-void executor_set_logger(ExecLogCallback callback) {
-    log_callback = callback;
+void executor_set_output_callback(ExecOutputCallback callback) {
+    output_callback = callback;
+    output_thread = pthread_self();
 }
 
-static void log_msg(const char *fmt, ...) {
-    if (!log_callback) return;
+void executor_log(const char *fmt, ...) {
+    /* Free-form notes are formatted only while someone is tracing */
+    if (!exec_events_tracing()) return;
 
-    char buf[512];
+    char buf[EXEC_EVENT_TEXT];
     va_list args;
     va_start(args, fmt);
     vsnprintf(buf, sizeof(buf), fmt, args);
     va_end(args);
-    log_callback(buf);
+    exec_event_emit(EXEC_EV_NOTE, 0, 0, 0, 0, 0, buf, NULL);
+}
+
+/*
+ * Create a pipe whose ends are close-on-exec, so a forked stage only
+ * keeps the two ends it dup2's onto stdin/stdout
+ */
+static int make_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#endif
+}
+
+#define HEREDOC_PIPE_MAX 4096  /* PIPE_BUF: always fits in an empty pipe */
+
+/*
+ * Make a read fd holding a heredoc body. A small body is written into
+ * a pipe, which it always fits; a larger one goes into a memfd sealed
+ * against writes and resizing. Neither touches the disk. Returns the fd
+ * (close-on-exec) or -1.
+ */
+static int heredoc_fd(const char *body) {
+    size_t len = strlen(body);
+
+    if (len <= HEREDOC_PIPE_MAX) {
+        int fds[2];
+        if (make_pipe(fds) < 0) return -1;
+        int ret = write_full(fds[1], body, len);
+        close(fds[1]);
+        if (ret < 0) {
+            close(fds[0]);
+            return -1;
+        }
+        exec_event_emit(EXEC_EV_HEREDOC, EXEC_HEREDOC_PIPE, 0, 0, (int64_t)len, 0, NULL, NULL);
+        return fds[0];
+    }
+
+#ifdef MFD_ALLOW_SEALING
+    int fd = memfd_create("shelli-heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) return -1;
+    if (write_full(fd, body, len) < 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0 ||
+        lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+        return -1;
+    }
+    exec_event_emit(EXEC_EV_HEREDOC, EXEC_HEREDOC_MEMFD, 0, 0, (int64_t)len, 0, NULL, NULL);
+    return fd;
+#else
+    /* No memfd: an already-unlinked temporary file */
+    FILE *tmp = tmpfile();
+    if (!tmp) return -1;
+    int fd = dup(fileno(tmp));
+    fclose(tmp);
+    if (fd < 0) return -1;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (write_full(fd, body, len) < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+        return -1;
+    }
+    exec_event_emit(EXEC_EV_HEREDOC, EXEC_HEREDOC_TMPFILE, 0, 0, (int64_t)len, 0, NULL, NULL);
+    return fd;
+#endif
 }
 
-static int setup_redirects(Command *cmd) {
+/*
+ * Open a command's redirect files, returns 0 on success, -1 on error.
+ * *in_fd / *out_fd are -1 when the command has no such redirect.
+ */
+static int open_redirects(Command *cmd, int *in_fd, int *out_fd) {
+    *in_fd = -1;
+    *out_fd = -1;
+
     /* Input redirect */
     if (cmd->redir_in.type == REDIR_IN) {
-        int fd = open(cmd->redir_in.filename, O_RDONLY);
-        if (fd < 0) {
+        *in_fd = open(cmd->redir_in.filename, O_RDONLY | O_CLOEXEC);
+        if (*in_fd < 0) {
             fprintf(stderr, "shelli: %s: %s\n",
                     cmd->redir_in.filename, strerror(errno));
             return -1;
         }
-        log_msg("  redirect: stdin ◄── %s", cmd->redir_in.filename);
-        dup2(fd, STDIN_FILENO);
-        close(fd);
+        exec_event_emit(EXEC_EV_REDIR_IN, 0, 0, 0, 0, 0, cmd->redir_in.filename, NULL);
+    } else if (cmd->redir_in.type == REDIR_HEREDOC) {
+        *in_fd = heredoc_fd(cmd->redir_in.filename);
+        if (*in_fd < 0) {
+            fprintf(stderr, "shelli: heredoc: %s\n", strerror(errno));
+            return -1;
+        }
     }
 
     /* Output redirect */
-    if (cmd->redir_out.type == REDIR_OUT) {
-        int fd = open(cmd->redir_out.filename,
-                      O_WRONLY | O_CREAT | O_TRUNC, 0644);
-        if (fd < 0) {
+    if (cmd->redir_out.type == REDIR_OUT || cmd->redir_out.type == REDIR_APPEND) {
+        int append = cmd->redir_out.type == REDIR_APPEND;
+        *out_fd = open(cmd->redir_out.filename,
+                       O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+        if (*out_fd < 0) {
             fprintf(stderr, "shelli: %s: %s\n",
                     cmd->redir_out.filename, strerror(errno));
+            if (*in_fd >= 0) close(*in_fd);
+            *in_fd = -1;
             return -1;
         }
-        log_msg("  redirect: stdout ──► %s (truncate)", cmd->redir_out.filename);
-        dup2(fd, STDOUT_FILENO);
-        close(fd);
-    } else if (cmd->redir_out.type == REDIR_APPEND) {
-        int fd = open(cmd->redir_out.filename,
-                      O_WRONLY | O_CREAT | O_APPEND, 0644);
-        if (fd < 0) {
-            fprintf(stderr, "shelli: %s: %s\n",
-                    cmd->redir_out.filename, strerror(errno));
-            return -1;
+        exec_event_emit(EXEC_EV_REDIR_OUT, append, 0, 0, 0, 0, cmd->redir_out.filename, NULL);
+    }
+
+    return 0;
+}
+
+/*
+ * Run a builtin inside the shell process, without forking. Redirect
+ * files are handed to the builtin as fds rather than dup2'd over the
+ * shell's own stdin/stdout. When capturing, output also goes to the
+ * capture store (if output is not NULL), even when redirected, through
+ * the same VT parser as a child's.
+ */
+static int run_builtin(Command *cmd, int capture, OutBuf *output, int *should_exit) {
+    int in_fd, out_fd;
+    *should_exit = 0;
+
+    exec_event_emit(EXEC_EV_BUILTIN, 0, 0, 0, 0, 0, cmd->argv[0], NULL);
+    if (open_redirects(cmd, &in_fd, &out_fd) < 0) {
+        return 1;
+    }
+
+    BuiltinIO io;
+    int stdin_fd = in_fd >= 0 ? in_fd : STDIN_FILENO;
+    if (capture) {
+        /* With a redirect, output goes to the file and the store (tee);
+         * the store gets it through a VT parser, like a child's */
+        builtin_io_buffer(&io, stdin_fd, output);
+        io.out_fd = out_fd;
+        if (output) io.vt = vtparse_new(output);
+    } else {
+        fflush(stdout);
+        builtin_io_fd(&io, stdin_fd, out_fd >= 0 ? out_fd : STDOUT_FILENO);
+    }
+
+    int status = builtin_execute(cmd, &io, should_exit);
+
+    if (io.vt) {
+        /* The last line may not end in a newline */
+        if (io.buf) vtparse_finish(io.vt);
+        vtparse_free(io.vt);
+    }
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+
+    return status;
+}
+
+int executor_run_builtin(Command *cmd, int *should_exit) {
+    return run_builtin(cmd, 0, NULL, should_exit);
+}
+
+int executor_pipe_max_size(void) {
+    static int max_size = 0;
+
+    if (max_size == 0) {
+        max_size = 1024 * 1024;  /* Linux default for unprivileged users */
+        FILE *f = fopen("/proc/sys/fs/pipe-max-size", "r");
+        if (f) {
+            int value;
+            if (fscanf(f, "%d", &value) == 1 && value > 0) max_size = value;
+            fclose(f);
         }
-        log_msg("  redirect: stdout ──► %s (append)", cmd->redir_out.filename);
-        dup2(fd, STDOUT_FILENO);
-        close(fd);
     }
+    return max_size;
+}
+
+/* Current capacity of a pipe in bytes, or -1 if it can't be queried */
+static int pipe_capacity(int fd) {
+#ifdef F_GETPIPE_SZ
+    return fcntl(fd, F_GETPIPE_SZ);
+#else
+    (void)fd;
+    return -1;
+#endif
+}
+
+/*
+ * Set a pipe's capacity (clamped to pipe-max-size), returns the capacity
+ * the kernel actually granted, or -1 if resizing isn't possible
+ */
+static int resize_pipe(int fd, int size) {
+#ifdef F_SETPIPE_SZ
+    if (size > executor_pipe_max_size()) size = executor_pipe_max_size();
+    return fcntl(fd, F_SETPIPE_SZ, size);
+#else
+    (void)fd;
+    (void)size;
+    return -1;
+#endif
+}
+
+void executor_set_pipe_size(int size) {
+    session_pipe_size = size;
+}
+
+int executor_get_pipe_size(void) {
+    return session_pipe_size;
+}
+
+void executor_set_pty(int enabled) {
+    session_pty = enabled;
+}
+
+int executor_get_pty(void) {
+    return session_pty;
+}
+
+/*
+ * Open a pseudo-terminal for a captured last stage: fds[0] is the
+ * master (read by the shell), fds[1] the slave (the child's stdout),
+ * both close-on-exec. Output post-processing is off so bytes arrive as
+ * the child wrote them (no \n to \r\n), and the window size is the
+ * shell's own. Returns 0, or -1 if no pty is available.
+ */
+static int open_pty(int fds[2], char *name, size_t size) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0) return -1;
+    fcntl(master, F_SETFD, FD_CLOEXEC);
+
+    const char *path = NULL;
+    if (grantpt(master) < 0 || unlockpt(master) < 0 || !(path = ptsname(master))) {
+        close(master);
+        return -1;
+    }
+    snprintf(name, size, "%s", path);
+
+    int slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave < 0) {
+        close(master);
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(slave, &tio) == 0) {
+        tio.c_oflag &= ~(tcflag_t)OPOST;
+        tio.c_lflag &= ~(tcflag_t)ECHO;
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) < 0 || ws.ws_col == 0) {
+        memset(&ws, 0, sizeof(ws));
+        ws.ws_col = 80;
+        ws.ws_row = 24;
+    }
+    ioctl(slave, TIOCSWINSZ, &ws);
 
+    fds[0] = master;
+    fds[1] = slave;
     return 0;
 }
 
-static int execute_single(Command *cmd) {
-    /* Check for built-in */
-    if (builtin_is_builtin(cmd->argv[0])) {
-        int should_exit = 0;
-        log_msg("builtin: %s", cmd->argv[0]);
-        return builtin_execute(cmd, &should_exit);
+int executor_pipe(int fds[2], int size) {
+    if (make_pipe(fds) < 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    if (size == PIPE_SIZE_DEFAULT) size = session_pipe_size;
+    if (size > 0) {
+        int granted = resize_pipe(fds[1], size);
+        if (granted > 0) {
+            exec_event_emit(EXEC_EV_PIPE, EXEC_PIPE_SIZED, fds[0], fds[1], granted / 1024, 0,
+                            NULL, NULL);
+            return 0;
+        }
+        exec_event_emit(EXEC_EV_PIPE, EXEC_PIPE_REFUSED, fds[0], fds[1], size / 1024, 0,
+                        NULL, NULL);
+        return 0;
+    }
+
+    exec_event_emit(EXEC_EV_PIPE, EXEC_PIPE_DEFAULT, fds[0], fds[1], 0, 0, NULL, NULL);
+    return 0;
+}
+
+/*
+ * Report a failure from a forked child. Job runners fork from pipeline
+ * threads, so the child may only make async-signal-safe calls: no stdio,
+ * whose locks another thread may have held at the fork, and no strerror.
+ */
+static void child_error(const char *name, const char *what, int err) {
+    const char *msg;
+    switch (err) {
+        case ENOENT:  msg = "No such file or directory"; break;
+        case EACCES:  msg = "Permission denied"; break;
+        case ENOEXEC: msg = "Exec format error"; break;
+        case ENOTDIR: msg = "Not a directory"; break;
+        case E2BIG:   msg = "Argument list too long"; break;
+        case ENOMEM:  msg = "Cannot allocate memory"; break;
+        case ELOOP:   msg = "Too many levels of symbolic links"; break;
+        default:      msg = "cannot execute"; break;
+    }
+
+    const char *parts[] = {"shelli: ", name, ": ", what ? what : "", what ? ": " : "", msg, "\n"};
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        if (write(STDERR_FILENO, parts[i], strlen(parts[i])) < 0) break;
     }
+}
+
+/*
+ * Fork and exec cmd with the given standard streams (-1 keeps the
+ * shell's), then its own redirects. The redirect files are opened here,
+ * before the fork, so the child only dup2's and execs; if one cannot be
+ * opened the error is reported and the child exits 1 without running.
+ * With own_tty, out_fd is a pty slave and the child becomes a session
+ * leader with it as its controlling terminal. Returns pid or -1.
+ */
+static pid_t fork_command(Command *cmd, int in_fd, int out_fd, int err_fd, int own_tty) {
+    int redir_in = -1, redir_out = -1;
+    int redir_failed = open_redirects(cmd, &redir_in, &redir_out) < 0;
 
     pid_t pid = fork();
     if (pid < 0) {
         perror("fork");
-        return 1;
+        if (redir_in >= 0) close(redir_in);
+        if (redir_out >= 0) close(redir_out);
+        return -1;
     }
 
     if (pid == 0) {
-        /* Child process */
-        if (setup_redirects(cmd) < 0) {
+        /* Child process: builtin threads block SIGPIPE, commands must not */
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+
+        if (redir_failed) _exit(1);
+
+        if (own_tty && (setsid() < 0 || ioctl(out_fd, TIOCSCTTY, 0) < 0)) {
+            child_error(cmd->argv[0], "pty", errno);
             _exit(1);
         }
+
+        /* Redirects override pipe connections */
+        if (redir_in >= 0) in_fd = redir_in;
+        if (redir_out >= 0) out_fd = redir_out;
+
+        if (in_fd >= 0) {
+            dup2(in_fd, STDIN_FILENO);
+            close(in_fd);
+        }
+        if (out_fd >= 0) {
+            dup2(out_fd, STDOUT_FILENO);
+            close(out_fd);
+        }
+        if (err_fd >= 0) {
+            dup2(err_fd, STDERR_FILENO);
+            close(err_fd);
+        }
+
         execvp(cmd->argv[0], cmd->argv);
-        fprintf(stderr, "shelli: %s: %s\n", cmd->argv[0], strerror(errno));
+        child_error(cmd->argv[0], NULL, errno);
         _exit(127);
     }
 
-    /* Parent process */
-    log_msg("fork() → pid %d (%s)", pid, cmd->argv[0]);
-
-    int status;
-    waitpid(pid, &status, 0);
+    if (redir_in >= 0) close(redir_in);
+    if (redir_out >= 0) close(redir_out);
+    return pid;
+}
 
-    if (WIFEXITED(status)) {
-        return WEXITSTATUS(status);
+/* Fork a pipeline stage (on a pty if own_tty) and trace it */
+static pid_t spawn_stage(Command *cmd, int in_fd, int out_fd, int own_tty) {
+    pid_t pid = fork_command(cmd, in_fd, out_fd, -1, own_tty);
+    if (pid > 0) {
+        exec_event_emit(EXEC_EV_FORK, 0, pid, 0, 0, 0, cmd->argv[0], NULL);
     }
-    return 1;
+    return pid;
 }
 
-static int execute_pipeline(Pipeline *pipeline) {
-    int cmd_count = pipeline->cmd_count;
+pid_t executor_spawn_job(Command *cmd, int in_fd, int *out_fd, int *err_fd) {
+    int out[2], err[2];
 
-    if (cmd_count == 1) {
-        return execute_single(pipeline->first);
+    if (make_pipe(out) < 0) return -1;
+    if (make_pipe(err) < 0) {
+        close(out[0]);
+        close(out[1]);
+        return -1;
     }
 
-    /* Allocate pipes: we need (cmd_count - 1) pipes */
-    int (*pipes)[2] = malloc((cmd_count - 1) * sizeof(int[2]));
-    if (!pipes) {
-        perror("malloc");
-        return 1;
+    pid_t pid = fork_command(cmd, in_fd, out[1], err[1], 0);
+    close(out[1]);
+    close(err[1]);
+    if (pid < 0) {
+        close(out[0]);
+        close(err[0]);
+        return -1;
     }
 
-    /* Create all pipes */
-    for (int i = 0; i < cmd_count - 1; i++) {
-        if (pipe(pipes[i]) < 0) {
-            perror("pipe");
-            free(pipes);
-            return 1;
-        }
-        log_msg("pipe() → fd[%d, %d]", pipes[i][0], pipes[i][1]);
+    exec_event_emit(EXEC_EV_FORK, 0, pid, 0, 0, 0, cmd->argv[0], NULL);
+    *out_fd = out[0];
+    *err_fd = err[0];
+    return pid;
+}
+
+/*
+ * A pipeline-safe builtin running as a pipeline stage on its own thread.
+ * The thread owns its fds and closes them when the builtin returns, so
+ * the next stage sees EOF.
+ */
+typedef struct {
+    pthread_t tid;
+    Command *cmd;
+    BuiltinIO io;
+    int in_fd;          /* Pipe ends held until the thread starts, -1 if none */
+    int out_fd;
+    int started;
+    int status;
+    double end_ms;      /* When the builtin returned (now_ms clock) */
+} BuiltinThread;
+
+/* One pipeline stage: a forked child or a builtin thread */
+typedef struct {
+    Command *cmd;
+    pid_t pid;          /* Child pid, 0 for a thread stage, -1 if never launched */
+    int pidfd;          /* Pollable handle on the child, -1 if unavailable */
+    int watch_fd;       /* Auto pipe size: read end of the input pipe, or -1 */
+    int done;
+    int status;
+    BuiltinThread thread;
+} Stage;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * Get a pollable, reuse-safe handle on a child (readable once it exits).
+ * Returns -1 where pidfd_open is unavailable; such children are waited
+ * for in pipeline order instead.
+ */
+static int open_pidfd(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static int stage_runs_as_thread(Command *cmd) {
+    return cmd->builtin && (cmd->builtin->flags & BUILTIN_PIPELINE_SAFE);
+}
+
+static void *builtin_thread_main(void *arg) {
+    BuiltinThread *t = arg;
+    int should_exit = 0;
+
+    /* A closed reader must fail the write with EPIPE, not kill the shell */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    t->status = builtin_execute(t->cmd, &t->io, &should_exit);
+    t->end_ms = now_ms();
+
+    if (t->io.in_fd != STDIN_FILENO) close(t->io.in_fd);
+    if (t->io.out_fd != STDOUT_FILENO) close(t->io.out_fd);
+    return NULL;
+}
+
+/*
+ * Start a builtin stage on the pipe ends it holds (-1 for the shell's own
+ * stdin/stdout). Its redirects take precedence, as in a forked stage.
+ * The thread takes ownership of the ends; on failure they are closed,
+ * t->status is set and -1 returned.
+ */
+static int start_builtin_thread(BuiltinThread *t) {
+    int redir_in, redir_out;
+    int in = t->in_fd, out = t->out_fd;
+
+    t->in_fd = t->out_fd = -1;
+    t->status = 1;
+    if (open_redirects(t->cmd, &redir_in, &redir_out) < 0) {
+        if (in >= 0) close(in);
+        if (out >= 0) close(out);
+        return -1;
     }
 
-    /* Fork all children */
-    pid_t *pids = malloc(cmd_count * sizeof(pid_t));
-    if (!pids) {
-        perror("malloc");
-        free(pipes);
-        return 1;
+    if (redir_in >= 0) {
+        if (in >= 0) close(in);
+        in = redir_in;
     }
+    if (redir_out >= 0) {
+        if (out >= 0) close(out);
+        out = redir_out;
+    }
+    builtin_io_fd(&t->io, in >= 0 ? in : STDIN_FILENO, out >= 0 ? out : STDOUT_FILENO);
 
-    Command *cmd = pipeline->first;
-    for (int i = 0; i < cmd_count; i++) {
-        pids[i] = fork();
-        if (pids[i] < 0) {
-            perror("fork");
-            /* TODO: clean up properly */
-            free(pipes);
-            free(pids);
-            return 1;
-        }
+    if (pthread_create(&t->tid, NULL, builtin_thread_main, t) != 0) {
+        perror("shelli: builtin thread");
+        if (in >= 0) close(in);
+        if (out >= 0) close(out);
+        return -1;
+    }
 
-        if (pids[i] == 0) {
-            /* Child process */
+    t->started = 1;
+    exec_event_emit(EXEC_EV_THREAD, 0, 0, 0, 0, 0, t->cmd->argv[0], NULL);
+    return 0;
+}
 
-            /* Connect to previous pipe (read end) */
-            if (i > 0) {
-                dup2(pipes[i-1][0], STDIN_FILENO);
+/*
+ * Launch every stage of a pipeline. Pipes are created one stage at a
+ * time with close-on-exec ends, and the parent closes each end as soon
+ * as it has been handed to a child, so setup is O(n) and only a couple
+ * of pipe fds are open at once. Builtin stages keep their ends until
+ * their threads start, after every child is forked, so no child
+ * inherits a thread's fds. A thread stage that forks jobs of its own
+ * (parallel, memo) goes through fork_command, whose child makes only
+ * async-signal-safe calls, so a lock held by another thread at the
+ * fork cannot hang it.
+ *
+ * last_out (-1 for the shell's stdout) receives the last stage's output
+ * and is owned by this function; last_tty means it is a pty slave the
+ * last stage takes as its terminal. last_cmd, if not NULL, replaces the
+ * last command (a copy with its redirect moved to the capture tee).
+ * Each stage's pid is set to the child
+ * pid, 0 for a thread stage, or -1 for a stage that was never launched.
+ * Returns 0 on success, -1 if a pipe or fork failed.
+ */
+static int launch_stages(Pipeline *pipeline, int last_out, int last_tty,
+                         Command *last_cmd, Stage *stages) {
+    int cmd_count = pipeline->cmd_count;
+    int in_fd = -1;     /* Read end of the previous stage's pipe */
+    int failed = 0;
+    int i = 0;
+
+    int pipe_size = pipeline->pipe_size != PIPE_SIZE_DEFAULT ?
+                    pipeline->pipe_size : session_pipe_size;
+    for (int j = 0; j < cmd_count; j++) stages[j].watch_fd = -1;
+
+    Command *next_cmd = pipeline->first;
+    for (; i < cmd_count; i++) {
+        Command *cmd = next_cmd;
+        Stage *st = &stages[i];
+        int out_fd = last_out;
+        int next_in = -1;
+
+        next_cmd = cmd->next;
+        if (!next_cmd && last_cmd) cmd = last_cmd;
+        st->cmd = cmd;
+        st->pidfd = -1;
+
+        if (i < cmd_count - 1) {
+            int fds[2];
+            if (executor_pipe(fds, pipe_size) < 0) {
+                if (in_fd >= 0) close(in_fd);
+                failed = 1;
+                break;
             }
-
-            /* Connect to next pipe (write end) */
-            if (i < cmd_count - 1) {
-                dup2(pipes[i][1], STDOUT_FILENO);
+            out_fd = fds[1];
+            next_in = fds[0];
+
+            /* Auto size: keep an eye on the pipe while a child reads it.
+             * Only children, whose exit we see at once through their
+             * pidfd, so the extra read end never outlives the reader. */
+            if (pipe_size == PIPE_SIZE_AUTO && !stage_runs_as_thread(next_cmd)) {
+                stages[i + 1].watch_fd = fcntl(fds[0], F_DUPFD_CLOEXEC, 0);
             }
+        }
 
-            /* Close all pipe fds */
-            for (int j = 0; j < cmd_count - 1; j++) {
-                close(pipes[j][0]);
-                close(pipes[j][1]);
+        if (stage_runs_as_thread(cmd)) {
+            st->pid = 0;
+            st->thread.cmd = cmd;
+            st->thread.in_fd = in_fd;
+            st->thread.out_fd = out_fd;
+        } else {
+            st->pid = spawn_stage(cmd, in_fd, out_fd, last_tty && !next_cmd);
+            if (st->pid > 0) st->pidfd = open_pidfd(st->pid);
+            if (st->pidfd < 0 && st->watch_fd >= 0) {
+                close(st->watch_fd);
+                st->watch_fd = -1;
             }
+            if (in_fd >= 0) close(in_fd);
+            if (out_fd >= 0) close(out_fd);
+        }
+        in_fd = next_in;
 
-            /* Apply redirects (may override pipe connections) */
-            if (setup_redirects(cmd) < 0) {
-                _exit(1);
-            }
+        if (st->pid < 0) {
+            if (in_fd >= 0) close(in_fd);
+            failed = 1;
+            i++;
+            break;
+        }
+    }
 
-            execvp(cmd->argv[0], cmd->argv);
-            fprintf(stderr, "shelli: %s: %s\n", cmd->argv[0], strerror(errno));
-            _exit(127);
+    /* Stages after a failure never run */
+    if (failed) {
+        if (i < cmd_count && last_out >= 0) close(last_out);
+        for (int j = i; j < cmd_count; j++) {
+            if (stages[j].watch_fd >= 0) close(stages[j].watch_fd);
+            stages[j].watch_fd = -1;
+            stages[j].pid = -1;
+            stages[j].pidfd = -1;
+            stages[j].done = 1;
+            stages[j].status = 1;
         }
+    }
 
-        log_msg("fork() → pid %d (%s)", pids[i], cmd->argv[0]);
-        cmd = cmd->next;
+    /* Start builtin stages, or release their ends if the launch failed */
+    for (int j = 0; j < cmd_count; j++) {
+        BuiltinThread *t = &stages[j].thread;
+        if (stages[j].pid != 0) continue;
+        if (failed) {
+            if (t->in_fd >= 0) close(t->in_fd);
+            if (t->out_fd >= 0) close(t->out_fd);
+            t->status = 1;
+        } else {
+            start_builtin_thread(t);
+        }
     }
 
-    /* Parent: close all pipes */
-    for (int i = 0; i < cmd_count - 1; i++) {
-        close(pipes[i][0]);
-        close(pipes[i][1]);
+    return failed ? -1 : 0;
+}
+
+/* Record the pipe connections between consecutive stages */
+static void log_stage_pipes(const Stage *stages, int count) {
+    for (int i = 0; i < count - 1; i++) {
+        const Stage *a = &stages[i], *b = &stages[i + 1];
+        if (a->pid < 0 || b->pid < 0) break;
+        exec_event_emit(EXEC_EV_LINK, 0, a->pid, b->pid, 0, 0,
+                        a->cmd->argv[0], b->cmd->argv[0]);
     }
+}
 
-    /* Log pipe connections */
-    cmd = pipeline->first;
-    for (int i = 0; i < cmd_count - 1; i++) {
-        log_msg("pipe: %d stdout ──► %d stdin", pids[i], pids[i+1]);
-        cmd = cmd->next;
+/* Collect a child's exit status and report when it finished */
+static void stage_reaped(Stage *st, double start_ms) {
+    int wstatus = 0;
+    pid_t r;
+    while ((r = waitpid(st->pid, &wstatus, 0)) < 0 && errno == EINTR) {
+    }
+    /* Same statuses as the job runners: 128 + signal for a killed child */
+    if (r < 0) {
+        fprintf(stderr, "shelli: waitpid %d: %s\n", (int)st->pid, strerror(errno));
+        st->status = 1;
+    } else {
+        st->status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) :
+                     WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : 1;
+    }
+    st->done = 1;
+    if (st->pidfd >= 0) {
+        close(st->pidfd);
+        st->pidfd = -1;
+    }
+    if (st->watch_fd >= 0) {
+        close(st->watch_fd);
+        st->watch_fd = -1;
     }
 
-    /* Wait for all children */
-    int last_status = 0;
-    for (int i = 0; i < cmd_count; i++) {
-        int status;
-        waitpid(pids[i], &status, 0);
-        if (i == cmd_count - 1 && WIFEXITED(status)) {
-            last_status = WEXITSTATUS(status);
+    const char *name = st->cmd ? st->cmd->argv[0] : "child";
+    exec_event_emit(EXEC_EV_EXIT, 0, st->pid, st->status, 0, now_ms() - start_ms, name, NULL);
+}
+
+/*
+ * Auto pipe size: a pipe that is (nearly) full means its writer is
+ * blocked on a slower reader, so double its capacity up to pipe-max-size
+ */
+static void grow_full_pipes(Stage *stages, int count) {
+    for (int i = 0; i < count; i++) {
+        int fd = stages[i].watch_fd;
+        int queued = 0;
+        if (fd < 0 || ioctl(fd, FIONREAD, &queued) < 0) continue;
+
+        int capacity = pipe_capacity(fd);
+        if (capacity <= 0 || queued < capacity - PIPE_BUF) continue;
+
+        if (capacity >= executor_pipe_max_size() ||
+            resize_pipe(fd, capacity * 2) <= capacity) {
+            /* At the limit (or refused): stop watching this pipe */
+            close(fd);
+            stages[i].watch_fd = -1;
+            continue;
         }
+        exec_event_emit(EXEC_EV_PIPE_GROW, 0, 0, 0, pipe_capacity(fd) / 1024, 0,
+                        stages[i].cmd->argv[0], NULL);
     }
+}
 
-    free(pipes);
-    free(pids);
+/*
+ * The read side of a captured pipeline: the last stage's output is read
+ * through the VT parser into the output store and, in tee mode (the last stage redirects its
+ * stdout while capturing), also written to the redirect file. The file
+ * side uses tee(2) to duplicate the pipe into ui and splice(2) to move
+ * it into the file, so those bytes never pass through userspace.
+ */
+typedef struct {
+    int fd;             /* Read end of the capture pipe, -1 once closed */
+    OutBuf *output;     /* NULL: no store (or it failed) */
+    VtParse *vt;        /* Lays output out into lines for the store, or NULL */
+    int file_fd;        /* Tee target, -1 if none */
+    int ui[2];          /* Pipe the store's copy is tee'd into, -1 to copy */
+} Capture;
+
+#define TEE_CHUNK (1024 * 1024)
+
+static int capture_wants_output(const Capture *c) {
+    return c->output != NULL;
+}
 
-    return last_status;
+static void capture_failed(Capture *c) {
+    fprintf(stderr, "shelli: output store full, result truncated\n");
+    c->output = NULL;
 }
 
-int executor_run(Pipeline *pipeline) {
-    if (!pipeline || !pipeline->first) {
-        return 0;
+/* Append to the output store; if it fails (disk full), stop keeping */
+static void capture_keep(Capture *c, const char *data, size_t n) {
+    if (!capture_wants_output(c)) return;
+    int ret = c->vt ? vtparse_feed(c->vt, data, n) : outbuf_append(c->output, data, n);
+    if (ret < 0) {
+        capture_failed(c);
+        return;
+    }
+    if (output_callback && pthread_equal(pthread_self(), output_thread)) {
+        output_callback(c->output);
     }
-    return execute_pipeline(pipeline);
+}
+
+static void capture_close(Capture *c) {
+    close(c->fd);
+    c->fd = -1;
+}
+
+/* Stop teeing after a file error; the store keeps being filled */
+static void capture_drop_file(Capture *c) {
+    perror("shelli: tee");
+    close(c->file_fd);
+    c->file_fd = -1;
 }
 
 /*
- * Execute a single command with output capture
+ * Tee fallback: read up to max bytes through userspace into the file
+ * (and the store if keep). Returns bytes moved, 0 at EOF, -1 on error.
  */
-static int execute_single_capture(Command *cmd, char *output, int output_size) {
-    int is_builtin = builtin_is_builtin(cmd->argv[0]);
-
-    /* Special case: cd must run in parent process (can't fork) */
-    if (is_builtin && strcmp(cmd->argv[0], "cd") == 0) {
-        int should_exit = 0;
-        log_msg("builtin: %s", cmd->argv[0]);
-        int ret = builtin_execute(cmd, &should_exit);
-        if (output && output_size > 0) {
-            output[0] = '\0';  /* cd has no output */
+static ssize_t capture_copy(Capture *c, size_t max, int keep) {
+    char buf[65536];
+    if (max > sizeof(buf)) max = sizeof(buf);
+
+    ssize_t n = read(c->fd, buf, max);
+    if (n <= 0) return n;
+
+    for (ssize_t off = 0; c->file_fd >= 0 && off < n; ) {
+        ssize_t w = write(c->file_fd, buf + off, (size_t)(n - off));
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) {
+            capture_drop_file(c);
+            break;
         }
-        return ret;
+        off += w;
     }
+    if (keep) capture_keep(c, buf, (size_t)n);
+    return n;
+}
 
-    /* Create pipe to capture stdout */
-    int capture_pipe[2];
-    if (pipe(capture_pipe) < 0) {
-        perror("pipe");
-        return 1;
+#ifdef __linux__
+/* Read exactly n tee'd bytes back out of the ui pipe into the store */
+static void capture_drain_ui(Capture *c, ssize_t n) {
+    char scratch[65536];
+    while (n > 0) {
+        size_t want = (size_t)n < sizeof(scratch) ? (size_t)n : sizeof(scratch);
+        ssize_t r = read(c->ui[0], scratch, want);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        capture_keep(c, scratch, (size_t)r);
+        n -= r;
     }
+}
 
-    pid_t pid = fork();
-    if (pid < 0) {
-        perror("fork");
-        close(capture_pipe[0]);
-        close(capture_pipe[1]);
-        return 1;
+/*
+ * Zero-copy tee step. Returns 1 to keep going, 0 once the capture pipe
+ * is at EOF, -1 if splicing isn't supported (fall back to copying).
+ */
+static int capture_splice(Capture *c) {
+    int to_ui = capture_wants_output(c);
+    ssize_t n = TEE_CHUNK;
+
+    if (to_ui) {
+        /* Duplicate what is queued into ui without consuming it */
+        n = tee(c->fd, c->ui[1], TEE_CHUNK, SPLICE_F_NONBLOCK);
+        if (n < 0) return errno == EAGAIN || errno == EINTR ? 1 : -1;
+        if (n == 0) {
+            capture_close(c);
+            return 0;
+        }
     }
 
-    if (pid == 0) {
-        /* Child process */
-        close(capture_pipe[0]);  /* Close read end */
-
-        /* Redirect stdout to capture pipe (unless there's an explicit redirect) */
-        if (cmd->redir_out.type == 0) {
-            dup2(capture_pipe[1], STDOUT_FILENO);
+    /* Move the same bytes from the capture pipe into the file */
+    ssize_t moved = 0;
+    while (moved < n) {
+        ssize_t m = splice(c->fd, NULL, c->file_fd, NULL, (size_t)(n - moved),
+                           SPLICE_F_MOVE | (to_ui ? 0 : SPLICE_F_NONBLOCK));
+        if (m < 0 && errno == EINTR) continue;
+        if (m < 0 && errno == EAGAIN && !to_ui) break;
+        if (m < 0) {
+            if (errno != EINVAL) {
+                capture_drop_file(c);
+                break;
+            }
+            /* Not spliceable: finish this chunk by copying, then stay copying */
+            while (moved < n) {
+                ssize_t k = capture_copy(c, (size_t)(n - moved), 0);
+                if (k <= 0) break;
+                moved += k;
+            }
+            if (to_ui) capture_drain_ui(c, n);
+            return -1;
         }
-        close(capture_pipe[1]);
-
-        if (setup_redirects(cmd) < 0) {
-            _exit(1);
+        if (m == 0) {
+            if (!to_ui) capture_close(c);
+            break;
         }
+        moved += m;
+        if (!to_ui) break;  /* One splice per wakeup without a store */
+    }
 
-        if (is_builtin) {
-            /* Execute builtin in child so output is captured */
-            int should_exit = 0;
-            int ret = builtin_execute(cmd, &should_exit);
-            _exit(ret);
-        } else {
-            execvp(cmd->argv[0], cmd->argv);
-            fprintf(stderr, "shelli: %s: %s\n", cmd->argv[0], strerror(errno));
-            _exit(127);
+    if (to_ui) {
+        if (c->file_fd < 0) {
+            /* The file failed mid-chunk: consume what it didn't take */
+            char scratch[4096];
+            while (moved < n) {
+                ssize_t k = read(c->fd, scratch, (size_t)(n - moved) < sizeof(scratch) ?
+                                 (size_t)(n - moved) : sizeof(scratch));
+                if (k <= 0) break;
+                moved += k;
+            }
         }
+        capture_drain_ui(c, n);
+    }
+    return c->fd >= 0 ? 1 : 0;
+}
+#endif
+
+/* Handle the capture pipe becoming readable */
+static void capture_pump(Capture *c) {
+    if (c->file_fd < 0) {
+        /* Plain capture: stop reading if the store fails (a pty master
+         * reports EIO once the last slave is closed, like EOF) */
+        char buf[65536];
+        ssize_t n = read(c->fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) return;
+        if (n > 0) capture_keep(c, buf, (size_t)n);
+        if (n <= 0 || !capture_wants_output(c)) capture_close(c);
+        return;
     }
 
-    /* Parent process */
-    close(capture_pipe[1]);  /* Close write end */
+#ifdef __linux__
+    if (c->ui[0] >= 0) {
+        if (capture_splice(c) >= 0) return;
+        exec_event_emit(EXEC_EV_TEE, EXEC_TEE_FALLBACK, 0, 0, 0, 0, NULL, NULL);
+        close(c->ui[0]);
+        close(c->ui[1]);
+        c->ui[0] = c->ui[1] = -1;
+        return;
+    }
+#endif
 
-    if (is_builtin) {
-        log_msg("builtin: %s", cmd->argv[0]);
-    } else {
-        log_msg("fork() → pid %d (%s)", pid, cmd->argv[0]);
+    ssize_t n = capture_copy(c, 65536, 1);
+    if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+        capture_close(c);
     }
+}
 
-    /* Read captured output */
-    if (output && output_size > 0) {
-        int total_read = 0;
-        int bytes_left = output_size - 1;
+/*
+ * Open the tee file for a redirected last stage. splice(2) refuses
+ * O_APPEND files, so >> opens for writing and seeks to the end instead.
+ */
+static int open_tee_file(Command *cmd) {
+    int append = cmd->redir_out.type == REDIR_APPEND;
+    int fd = open(cmd->redir_out.filename,
+                  O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        fprintf(stderr, "shelli: %s: %s\n", cmd->redir_out.filename, strerror(errno));
+        return -1;
+    }
+    if (append) lseek(fd, 0, SEEK_END);
+    return fd;
+}
+
+/*
+ * Wait for every stage and return the last stage's exit status.
+ *
+ * Children with a pidfd share one poll set with the capture pipe, so
+ * they are reaped in completion order while output is still being read;
+ * the capture pipe is closed here. Without a tee file, output stops being
+ * read when the store fails (the writer then gets EPIPE) or when there
+ * is no store. Children without a pidfd are waited for in pipeline order
+ * afterwards, and builtin threads are joined last.
+ */
+static int reap_stages(Stage *stages, int count, double start_ms, Capture *cap) {
+    struct pollfd *fds = malloc((count + 1) * sizeof(struct pollfd));
+    int *owner = malloc((count + 1) * sizeof(int));
+
+    if (cap && cap->fd >= 0 && cap->file_fd < 0 && !capture_wants_output(cap)) {
+        capture_close(cap);
+    }
 
-        while (bytes_left > 0) {
-            int n = read(capture_pipe[0], output + total_read, bytes_left);
-            if (n <= 0) break;
-            total_read += n;
-            bytes_left -= n;
+    while (fds && owner) {
+        int nfds = 0;
+        if (cap && cap->fd >= 0) {
+            fds[nfds].fd = cap->fd;
+            fds[nfds].events = POLLIN;
+            owner[nfds++] = -1;
+        }
+        int watching = 0;
+        for (int i = 0; i < count; i++) {
+            if (stages[i].pid > 0 && !stages[i].done && stages[i].pidfd >= 0) {
+                fds[nfds].fd = stages[i].pidfd;
+                fds[nfds].events = POLLIN;
+                owner[nfds++] = i;
+            }
+            if (stages[i].watch_fd >= 0) watching = 1;
         }
-        output[total_read] = '\0';
+        if (nfds == 0) break;
+
+        /* Sample pipe fill levels every few ms while auto-sizing */
+        int ready = poll(fds, nfds, watching ? AUTO_PIPE_POLL_MS : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (watching) grow_full_pipes(stages, count);
+        if (ready == 0) continue;
+
+        for (int k = 0; k < nfds; k++) {
+            if (!fds[k].revents) continue;
 
-        /* Trim trailing newline for cleaner display */
-        while (total_read > 0 && (output[total_read - 1] == '\n' || output[total_read - 1] == '\r')) {
-            output[--total_read] = '\0';
+            if (owner[k] >= 0) {
+                stage_reaped(&stages[owner[k]], start_ms);
+            } else {
+                capture_pump(cap);
+            }
         }
     }
 
-    close(capture_pipe[0]);
+    free(fds);
+    free(owner);
 
-    int status;
-    waitpid(pid, &status, 0);
+    /* Fallback (or poll failure): drain the capture, then pipeline order */
+    while (cap && cap->fd >= 0) {
+        capture_pump(cap);
+    }
+    for (int i = 0; i < count; i++) {
+        if (stages[i].pid > 0 && !stages[i].done) {
+            stage_reaped(&stages[i], start_ms);
+        }
+    }
 
-    if (WIFEXITED(status)) {
-        return WEXITSTATUS(status);
+    for (int i = 0; i < count; i++) {
+        BuiltinThread *t = &stages[i].thread;
+        if (stages[i].pid != 0) continue;
+        if (t->started) {
+            pthread_join(t->tid, NULL);
+            exec_event_emit(EXEC_EV_EXIT, 0, 0, t->status, 0, t->end_ms - start_ms,
+                            t->cmd->argv[0], NULL);
+        }
+        stages[i].status = t->status;
+        stages[i].done = 1;
     }
-    return 1;
+
+    return count > 0 ? stages[count - 1].status : 0;
 }
 
 /*
- * Execute a pipeline with output capture (captures last command's stdout)
+ * Run a pipeline's stages to completion. With capture, the last stage's
+ * stdout is appended to output; if it is also redirected, it is tee'd
+ * into the file as well. Without capture it goes to the shell's stdout.
+ * In pty mode a captured, unredirected last child writes to a pty, so
+ * its stdio is line buffered and it keeps colour.
  */
-static int execute_pipeline_capture(Pipeline *pipeline, char *output, int output_size) {
+static int run_stages(Pipeline *pipeline, int capture, OutBuf *output) {
     int cmd_count = pipeline->cmd_count;
+    int capture_pipe[2] = {-1, -1};
+    Capture cap = {-1, output, NULL, -1, {-1, -1}};
+    Command tee_cmd;
+    Command *last_cmd = NULL;
+    int on_pty = 0;
+
+    if (capture) {
+        Command *last = pipeline->first;
+        while (last->next) last = last->next;
+
+        /* Tee mode: the parent owns the file; the stage writes the pipe */
+        if (last->redir_out.type != REDIR_NONE) {
+            cap.file_fd = open_tee_file(last);
+            if (cap.file_fd < 0) return 1;
+            tee_cmd = *last;
+            tee_cmd.redir_out.type = REDIR_NONE;
+            last_cmd = &tee_cmd;
+#ifdef __linux__
+            if (make_pipe(cap.ui) < 0) cap.ui[0] = cap.ui[1] = -1;
+#endif
+            exec_event_emit(EXEC_EV_TEE, cap.ui[0] >= 0 ? EXEC_TEE_SPLICE : EXEC_TEE_COPY,
+                            0, 0, 0, 0, last->redir_out.filename, NULL);
+        }
 
-    if (cmd_count == 1) {
-        return execute_single_capture(pipeline->first, output, output_size);
-    }
-
-    /* For multi-command pipelines, capture the last command's output */
-    int (*pipes)[2] = malloc((cmd_count - 1) * sizeof(int[2]));
-    if (!pipes) {
-        perror("malloc");
-        return 1;
-    }
-
-    /* Create pipe to capture final output */
-    int capture_pipe[2];
-    if (pipe(capture_pipe) < 0) {
-        perror("pipe");
-        free(pipes);
-        return 1;
-    }
+        /* Tee mode needs a pipe to splice from, builtin threads need no tty */
+        if (session_pty && cap.file_fd < 0 && !stage_runs_as_thread(last)) {
+            char name[64];
+            on_pty = open_pty(capture_pipe, name, sizeof(name)) == 0;
+            if (on_pty) {
+                exec_event_emit(EXEC_EV_PTY, 0, 0, 0, 0, 0, name, last->argv[0]);
+            } else {
+                exec_event_emit(EXEC_EV_PTY, 1, 0, 0, 0, 0, NULL, last->argv[0]);
+            }
+        }
 
-    /* Create all inter-command pipes */
-    for (int i = 0; i < cmd_count - 1; i++) {
-        if (pipe(pipes[i]) < 0) {
+        if (!on_pty && make_pipe(capture_pipe) < 0) {
             perror("pipe");
-            free(pipes);
-            close(capture_pipe[0]);
-            close(capture_pipe[1]);
+            if (cap.file_fd >= 0) close(cap.file_fd);
+            if (cap.ui[0] >= 0) {
+                close(cap.ui[0]);
+                close(cap.ui[1]);
+            }
             return 1;
         }
-        log_msg("pipe() → fd[%d, %d]", pipes[i][0], pipes[i][1]);
     }
 
-    /* Fork all children */
-    pid_t *pids = malloc(cmd_count * sizeof(pid_t));
-    if (!pids) {
+    /* Escape sequences, CR and tabs are interpreted, not stored raw */
+    if (capture && output) cap.vt = vtparse_new(output);
+
+    Stage *stages = calloc(cmd_count, sizeof(Stage));
+    int failed = 1;
+    int last_status = 1;
+
+    if (stages) {
+        /* The last stage writes the capture pipe (launch_stages closes our end) */
+        double start_ms = now_ms();
+        cap.fd = capture_pipe[0];
+        failed = launch_stages(pipeline, capture_pipe[1], on_pty, last_cmd, stages) < 0;
+        log_stage_pipes(stages, cmd_count);
+        last_status = reap_stages(stages, cmd_count, start_ms, &cap);
+        free(stages);
+    } else {
         perror("malloc");
-        free(pipes);
-        close(capture_pipe[0]);
-        close(capture_pipe[1]);
-        return 1;
-    }
-
-    Command *cmd = pipeline->first;
-    for (int i = 0; i < cmd_count; i++) {
-        pids[i] = fork();
-        if (pids[i] < 0) {
-            perror("fork");
-            free(pipes);
-            free(pids);
+        if (capture_pipe[0] >= 0) {
             close(capture_pipe[0]);
             close(capture_pipe[1]);
-            return 1;
         }
+    }
 
-        if (pids[i] == 0) {
-            /* Child process */
-
-            /* Connect to previous pipe (read end) */
-            if (i > 0) {
-                dup2(pipes[i-1][0], STDIN_FILENO);
-            }
-
-            /* Connect to next pipe (write end) or capture pipe for last command */
-            if (i < cmd_count - 1) {
-                dup2(pipes[i][1], STDOUT_FILENO);
-            } else {
-                /* Last command: capture its output */
-                if (cmd->redir_out.type == 0) {
-                    dup2(capture_pipe[1], STDOUT_FILENO);
-                }
-            }
+    if (cap.file_fd >= 0) close(cap.file_fd);
+    if (cap.ui[0] >= 0) {
+        close(cap.ui[0]);
+        close(cap.ui[1]);
+    }
+    if (cap.vt) {
+        /* The last line may not end in a newline */
+        if (capture_wants_output(&cap) && vtparse_finish(cap.vt) < 0) capture_failed(&cap);
+        vtparse_free(cap.vt);
+    }
 
-            /* Close all pipe fds */
-            for (int j = 0; j < cmd_count - 1; j++) {
-                close(pipes[j][0]);
-                close(pipes[j][1]);
-            }
-            close(capture_pipe[0]);
-            close(capture_pipe[1]);
+    return failed ? 1 : last_status;
+}
 
-            /* Apply redirects (may override pipe connections) */
-            if (setup_redirects(cmd) < 0) {
-                _exit(1);
-            }
+static int execute_pipeline(Pipeline *pipeline) {
+    /* A lone builtin runs in the shell itself */
+    if (pipeline->cmd_count == 1 && pipeline->first->builtin) {
+        int should_exit = 0;
+        return run_builtin(pipeline->first, 0, NULL, &should_exit);
+    }
+    return run_stages(pipeline, 0, NULL);
+}
 
-            execvp(cmd->argv[0], cmd->argv);
-            fprintf(stderr, "shelli: %s: %s\n", cmd->argv[0], strerror(errno));
-            _exit(127);
-        }
+int executor_run(Pipeline *pipeline) {
+    if (!pipeline || !pipeline->first) {
+        return 0;
+    }
+    return execute_pipeline(pipeline);
+}
 
-        log_msg("fork() → pid %d (%s)", pids[i], cmd->argv[0]);
-        cmd = cmd->next;
+/*
+ * Execute a pipeline with output capture (captures last command's stdout)
+ */
+static int execute_pipeline_capture(Pipeline *pipeline, OutBuf *output) {
+    /* Builtins run in the shell and write straight into the capture store */
+    if (pipeline->cmd_count == 1 && pipeline->first->builtin) {
+        int should_exit = 0;
+        return run_builtin(pipeline->first, 1, output, &should_exit);
     }
+    return run_stages(pipeline, 1, output);
+}
 
-    /* Parent: close all inter-command pipes */
-    for (int i = 0; i < cmd_count - 1; i++) {
-        close(pipes[i][0]);
-        close(pipes[i][1]);
+int executor_run_capture(Pipeline *pipeline, OutBuf *output) {
+    if (!pipeline || !pipeline->first) {
+        return 0;
     }
-    close(capture_pipe[1]);  /* Close write end of capture pipe */
+    return execute_pipeline_capture(pipeline, output);
+}
 
-    /* Log pipe connections */
-    cmd = pipeline->first;
-    for (int i = 0; i < cmd_count - 1; i++) {
-        log_msg("pipe: %d stdout ──► %d stdin", pids[i], pids[i+1]);
-        cmd = cmd->next;
+/*
+ * Decide whether a list entry runs, given the connector before it
+ */
+static int list_should_run(int op, int last_status) {
+    switch (op) {
+        case LIST_AND: return last_status == 0;
+        case LIST_OR:  return last_status != 0;
+        default:       return 1;
     }
+}
 
-    /* Read captured output */
-    if (output && output_size > 0) {
-        int total_read = 0;
-        int bytes_left = output_size - 1;
+/*
+ * Handle `exit` as a whole pipeline: it must run in the shell itself,
+ * never in a forked child, so the list can stop
+ */
+static int is_exit_pipeline(Pipeline *pipeline) {
+    return pipeline->cmd_count == 1 &&
+           strcmp(pipeline->first->argv[0], "exit") == 0;
+}
 
-        while (bytes_left > 0) {
-            int n = read(capture_pipe[0], output + total_read, bytes_left);
-            if (n <= 0) break;
-            total_read += n;
-            bytes_left -= n;
-        }
-        output[total_read] = '\0';
+static int run_exit(Pipeline *pipeline) {
+    int should_exit = 0;
+    exec_event_emit(EXEC_EV_BUILTIN, 0, 0, 0, 0, 0, "exit", NULL);
+    int status = builtin_execute(pipeline->first, NULL, &should_exit);
+    exit_requested = should_exit;
+    return status;
+}
 
-        /* Trim trailing newline */
-        while (total_read > 0 && (output[total_read - 1] == '\n' || output[total_read - 1] == '\r')) {
-            output[--total_read] = '\0';
-        }
+/*
+ * Get the pipeline to run for a list entry, with its variables and globs
+ * expanded now that the entries before it have run. Returns NULL with
+ * *status set if there is nothing to run.
+ */
+static Pipeline *entry_pipeline(const ListEntry *entry, int *status) {
+    char error[256];
+    Pipeline *pipeline = parser_expand_entry(entry, error, sizeof(error));
+
+    if (!pipeline) {
+        if (error[0]) fprintf(stderr, "shelli: %s\n", error);
+        *status = error[0] ? 2 : 0;
     }
-    close(capture_pipe[0]);
+    return pipeline;
+}
+
+/*
+ * Run a list with && / || short-circuiting. With output (NULL: none),
+ * every pipeline that runs is captured into it, each on lines of its own.
+ */
+static int run_list(CommandList *list, OutBuf *output) {
+    exit_requested = 0;
+    if (!list) return 0;
 
-    /* Wait for all children */
     int last_status = 0;
-    for (int i = 0; i < cmd_count; i++) {
-        int status;
-        waitpid(pids[i], &status, 0);
-        if (i == cmd_count - 1 && WIFEXITED(status)) {
-            last_status = WEXITSTATUS(status);
+    int prev_op = LIST_END;
+
+    for (int i = 0; i < list->count && !exit_requested; i++) {
+        ListEntry *entry = &list->entries[i];
+        Pipeline *pipeline;
+
+        if (!list_should_run(prev_op, last_status)) {
+            exec_event_emit(EXEC_EV_SKIP, prev_op, 0, last_status, 0, 0,
+                            entry->pipeline->first->argv[0], NULL);
+        } else if ((pipeline = entry_pipeline(entry, &last_status)) != NULL) {
+            if (is_exit_pipeline(pipeline)) {
+                last_status = run_exit(pipeline);
+            } else if (output) {
+                /* Keep each pipeline's output on lines of its own */
+                if (!outbuf_at_line_start(output)) outbuf_append(output, "\n", 1);
+                last_status = executor_run_capture(pipeline, output);
+            } else {
+                last_status = executor_run(pipeline);
+            }
+            if (pipeline != entry->pipeline) pipeline_free(pipeline);
         }
+        /* Later entries see this status as $? */
+        vars_set_status(last_status);
+        prev_op = entry->op;
     }
 
-    free(pipes);
-    free(pids);
-
+    /* Deliver events that pipeline threads queued */
+    exec_events_drain();
     return last_status;
 }
 
-int executor_run_capture(Pipeline *pipeline, char *output, int output_size) {
-    if (!pipeline || !pipeline->first) {
-        if (output && output_size > 0) output[0] = '\0';
-        return 0;
-    }
-    return execute_pipeline_capture(pipeline, output, output_size);
+int executor_run_list(CommandList *list) {
+    return run_list(list, NULL);
+}
+
+int executor_run_list_capture(CommandList *list, OutBuf *output) {
+    return run_list(list, output);
+}
+
+int executor_exit_requested(void) {
+    return exit_requested;
 }
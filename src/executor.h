@@ -6,18 +6,82 @@
 #ifndef EXECUTOR_H
 #define EXECUTOR_H
 
+#include <sys/types.h>
 #include "parser.h"
 
-/* Callback for logging execution steps */
-typedef void (*ExecLogCallback)(const char *message);
+struct OutBuf;
 
-/* Set the logging callback for execution tracing */
-void executor_set_logger(ExecLogCallback callback);
+/* Record a free-form trace note from a builtin (any thread; execution
+ * steps are traced as typed events, see execevent.h) */
+void executor_log(const char *fmt, ...);
+
+/* Callback for progress of long-running builtins: done of total units,
+ * total <= 0 when it isn't known yet */
+typedef void (*ExecProgressCallback)(const char *label, long done, long total);
+
+/* Set the progress callback. It is only ever called on the thread that
+ * set it; reports from pipeline threads are dropped. */
+void executor_set_progress(ExecProgressCallback callback);
+
+/* Report progress through the callback, if any */
+void executor_progress(const char *label, long done, long total);
+
+/* Callback for captured output: called each time bytes are appended to
+ * the capture store, so a viewer can follow a running command */
+typedef void (*ExecOutputCallback)(struct OutBuf *output);
+
+/* Set the output callback. Like progress, it is only called on the
+ * thread that set it. */
+void executor_set_output_callback(ExecOutputCallback callback);
 
 /* Execute a pipeline, returns exit status of last command */
 int executor_run(Pipeline *pipeline);
 
-/* Execute a pipeline and capture stdout, returns exit status */
-int executor_run_capture(Pipeline *pipeline, char *output, int output_size);
+/* Execute a pipeline and append its stdout to output (may be NULL),
+ * returns exit status */
+int executor_run_capture(Pipeline *pipeline, struct OutBuf *output);
+
+/* Execute a command list with && / || short-circuiting,
+ * returns exit status of the last pipeline that ran */
+int executor_run_list(CommandList *list);
+
+/* Execute a command list and append the stdout of every pipeline that
+ * ran to output (NULL: run without capture), each starting on a new line */
+int executor_run_list_capture(CommandList *list, struct OutBuf *output);
+
+/* Returns 1 if the last list execution ran the exit builtin */
+int executor_exit_requested(void);
+
+/* Session pipe buffer size: bytes, PIPE_SIZE_DEFAULT (kernel default)
+ * or PIPE_SIZE_AUTO. A pipeline's PIPESIZE= prefix overrides it. */
+void executor_set_pipe_size(int size);
+int executor_get_pipe_size(void);
+
+/* Session pty mode: a captured last stage that is a child (not a
+ * builtin, not redirected) writes to a pseudo-terminal instead of a pipe,
+ * so its stdio stays line buffered and it keeps colour */
+void executor_set_pty(int enabled);
+int executor_get_pty(void);
+
+/* Largest pipe size an unprivileged process may set (pipe-max-size) */
+int executor_pipe_max_size(void);
+
+/*
+ * Low-level spawn path, shared with builtins and the job runners
+ */
+
+/* Create a pipe for connecting two stages, returns 0 on success.
+ * size is in bytes, PIPE_SIZE_DEFAULT for the session setting. */
+int executor_pipe(int fds[2], int size);
+
+/* Fork and exec one job for a job runner: stdin from in_fd, stdout and
+ * stderr into new close-on-exec pipes whose read ends are returned in
+ * *out_fd / *err_fd. Traced as a fork; the runner emits EXEC_EV_EXIT
+ * when it reaps the job. Returns pid or -1. */
+pid_t executor_spawn_job(Command *cmd, int in_fd, int *out_fd, int *err_fd);
+
+/* Run a builtin in the shell process with its redirects, no fork.
+ * Returns exit status, sets *should_exit if the shell should terminate. */
+int executor_run_builtin(Command *cmd, int *should_exit);
 
 #endif /* EXECUTOR_H */
@@ -0,0 +1,61 @@
+/*
+ * shelli - Educational Shell
+ * fsutil.c - File helpers shared by the caches and the executor
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "fsutil.h"
+
+int cache_dir(const char *name, char *out, size_t out_size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int n;
+
+    if (xdg && xdg[0]) {
+        n = snprintf(out, out_size, "%s/shelli/%s", xdg, name);
+    } else if (home && home[0]) {
+        n = snprintf(out, out_size, "%s/.cache/shelli/%s", home, name);
+    } else {
+        return -1;
+    }
+    if (n < 0 || (size_t)n >= out_size) return -1;
+
+    /* Create each level of the cache directory */
+    for (char *p = out + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(out, 0755);
+            *p = '/';
+        }
+    }
+    if (mkdir(out, 0755) < 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+int read_full(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int write_full(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * shelli - Educational Shell
+ * fsutil.h - File helpers shared by the caches and the executor
+ */
+
+#ifndef FSUTIL_H
+#define FSUTIL_H
+
+#include <stddef.h>
+
+/* Get ~/.cache/shelli/<name> (or under $XDG_CACHE_HOME), creating it and
+ * its parents as needed. Returns 0 on success, -1 if there is no home
+ * directory or it cannot be created. */
+int cache_dir(const char *name, char *out, size_t out_size);
+
+/* Read exactly len bytes, returns 0 on success, -1 on error or early EOF */
+int read_full(int fd, void *buf, size_t len);
+
+/* Write all len bytes, returns 0 on success, -1 on error */
+int write_full(int fd, const void *buf, size_t len);
+
+#endif /* FSUTIL_H */
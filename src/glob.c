@@ -0,0 +1,898 @@
+/*
+ * shelli - Educational Shell
+ * glob.c - Pathname expansion (*, ?, [...] and **)
+ *
+ * A pass between the lexer and the parser: every word the lexer flagged
+ * as a pattern is replaced by the sorted paths it matches, or kept as
+ * written (minus its escapes) if nothing matches. Each path segment is
+ * compiled once into a short op list. Directory listings are read with
+ * getdents64(2) in 64 KiB batches and cached while one list entry is
+ * expanded, so patterns in a command that share directories (*.c *.h)
+ * scan them once. Each entry starts with an empty cache, since an earlier
+ * one may have changed the tree (mkdir d; touch d/x; ls d/x*).
+ * A ** segment walks the tree below it, handing directories to worker
+ * threads once the walk has found enough of them to share.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "glob.h"
+#include "hash.h"
+
+#define GLOB_BUCKETS       256          /* Directory cache buckets (power of two) */
+#define GETDENTS_BATCH     (64 * 1024)  /* Bytes of entries per getdents64 call */
+#define WALK_PARALLEL_MIN  32           /* Queued directories before workers start */
+#define WALK_MAX_WORKERS   8
+
+/*
+ * ============================================================================
+ * Compiled segment matcher
+ * ============================================================================
+ */
+
+typedef enum {
+    GOP_LITERAL,    /* len bytes of text at arg */
+    GOP_ANY,        /* ? */
+    GOP_STAR,       /* * */
+    GOP_CLASS       /* [...], bitmap arg */
+} GlobOpType;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint32_t arg;
+} GlobOp;
+
+typedef struct {
+    GlobOp *ops;
+    int count;
+    char *text;             /* Literal bytes, unescaped */
+    unsigned char (*classes)[32];
+    int class_count;
+    int has_meta;           /* Any op other than a literal */
+    int dot_ok;             /* Starts with a literal '.': may match dot files */
+    int min_len;            /* Shortest name that can match */
+} GlobSegment;
+
+static void segment_free(GlobSegment *s) {
+    free(s->ops);
+    free(s->text);
+    free(s->classes);
+    memset(s, 0, sizeof(*s));
+}
+
+static int segment_push(GlobSegment *s, int type, int len, uint32_t arg) {
+    /* Extend the previous literal instead of starting a new one */
+    if (type == GOP_LITERAL && s->count > 0 && s->ops[s->count - 1].type == GOP_LITERAL &&
+        s->ops[s->count - 1].arg + s->ops[s->count - 1].len == arg) {
+        s->ops[s->count - 1].len += (uint16_t)len;
+        return 0;
+    }
+    /* ** inside a segment is just * */
+    if (type == GOP_STAR && s->count > 0 && s->ops[s->count - 1].type == GOP_STAR) {
+        return 0;
+    }
+
+    GlobOp *ops = realloc(s->ops, (s->count + 1) * sizeof(GlobOp));
+    if (!ops) return -1;
+    s->ops = ops;
+    s->ops[s->count].type = (uint8_t)type;
+    s->ops[s->count].len = (uint16_t)len;
+    s->ops[s->count].arg = arg;
+    s->count++;
+    return 0;
+}
+
+static void class_set(unsigned char *bits, int c) {
+    bits[(unsigned char)c >> 3] |= (unsigned char)(1u << (c & 7));
+}
+
+/* [:name:] inside a bracket expression, returns 0 if name is known */
+static int class_named(unsigned char *bits, const char *name, size_t len) {
+    static const struct {
+        const char *name;
+        int (*fn)(int);
+    } named[] = {
+        {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum},
+        {"upper", isupper}, {"lower", islower}, {"space", isspace},
+        {"punct", ispunct}, {"xdigit", isxdigit}, {"print", isprint},
+    };
+
+    for (size_t i = 0; i < sizeof(named) / sizeof(named[0]); i++) {
+        if (strlen(named[i].name) == len && strncmp(named[i].name, name, len) == 0) {
+            for (int c = 1; c < 256; c++) {
+                if (named[i].fn(c)) class_set(bits, c);
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Parse a bracket expression starting after '['. Returns the length
+ * consumed including the closing ']', or 0 if it isn't one (then '['
+ * is a literal).
+ */
+static size_t parse_class(const char *p, size_t len, unsigned char *bits) {
+    size_t i = 0;
+    int negate = 0;
+
+    memset(bits, 0, 32);
+    if (i < len && (p[i] == '!' || p[i] == '^')) {
+        negate = 1;
+        i++;
+    }
+
+    int first = 1;
+    while (i < len && (p[i] != ']' || first)) {
+        first = 0;
+
+        if (p[i] == '[' && i + 1 < len && p[i + 1] == ':') {
+            const char *end = strstr(p + i + 2, ":]");
+            if (end && (size_t)(end - p) < len &&
+                class_named(bits, p + i + 2, (size_t)(end - (p + i + 2))) == 0) {
+                i = (size_t)(end - p) + 2;
+                continue;
+            }
+        }
+
+        int lo = (unsigned char)p[i];
+        if (p[i] == '\\' && i + 1 < len) lo = (unsigned char)p[++i];
+        i++;
+
+        int hi = lo;
+        if (i + 1 < len && p[i] == '-' && p[i + 1] != ']') {
+            i++;
+            hi = (unsigned char)p[i];
+            if (p[i] == '\\' && i + 1 < len) hi = (unsigned char)p[++i];
+            i++;
+        }
+        for (int c = lo; c <= hi; c++) class_set(bits, c);
+    }
+
+    if (i >= len) return 0;  /* No closing ']' */
+
+    if (negate) {
+        for (int k = 0; k < 32; k++) bits[k] = (unsigned char)~bits[k];
+    }
+    bits[0] &= (unsigned char)~1u;  /* Never NUL */
+    return i + 1;
+}
+
+/*
+ * Compile one path segment (len bytes of escaped pattern text)
+ */
+static int segment_compile(GlobSegment *s, const char *p, size_t len) {
+    memset(s, 0, sizeof(*s));
+    s->text = malloc(len + 1);
+    if (!s->text) return -1;
+    size_t text_len = 0;
+
+    for (size_t i = 0; i < len; ) {
+        char c = p[i];
+
+        if (c == '*' || c == '?') {
+            if (segment_push(s, c == '*' ? GOP_STAR : GOP_ANY, 0, 0) < 0) goto fail;
+            if (c == '?') s->min_len++;
+            s->has_meta = 1;
+            i++;
+            continue;
+        }
+
+        if (c == '[') {
+            unsigned char bits[32];
+            size_t used = parse_class(p + i + 1, len - i - 1, bits);
+            if (used > 0) {
+                unsigned char (*classes)[32] = realloc(s->classes, (s->class_count + 1) * 32);
+                if (!classes) goto fail;
+                s->classes = classes;
+                memcpy(s->classes[s->class_count], bits, 32);
+                if (segment_push(s, GOP_CLASS, 0, (uint32_t)s->class_count++) < 0) goto fail;
+                s->has_meta = 1;
+                s->min_len++;
+                i += used + 1;
+                continue;
+            }
+        }
+
+        if (c == '\\' && i + 1 < len) c = p[++i];
+        if (text_len == 0 && s->count == 0 && c == '.') s->dot_ok = 1;
+        s->text[text_len] = c;
+        if (segment_push(s, GOP_LITERAL, 1, (uint32_t)text_len) < 0) goto fail;
+        text_len++;
+        s->min_len++;
+        i++;
+    }
+
+    s->text[text_len] = '\0';
+    return 0;
+
+fail:
+    segment_free(s);
+    return -1;
+}
+
+/*
+ * Match a name against a compiled segment. Only the most recent * needs
+ * to be retried, so this runs in O(len(name) * ops) at worst.
+ */
+static int segment_match(const GlobSegment *s, const char *name, size_t name_len) {
+    if ((int)name_len < s->min_len) return 0;
+    if (name[0] == '.' && !s->dot_ok) return 0;
+
+    const char *n = name;
+    const char *end = name + name_len;
+    int op = 0;
+    int star_op = -1;
+    const char *star_n = NULL;
+
+    for (;;) {
+        if (op < s->count) {
+            const GlobOp *g = &s->ops[op];
+            switch (g->type) {
+                case GOP_STAR:
+                    star_op = op++;
+                    star_n = n;
+                    continue;
+                case GOP_ANY:
+                    if (n < end) {
+                        n++;
+                        op++;
+                        continue;
+                    }
+                    break;
+                case GOP_CLASS: {
+                    unsigned char c = (unsigned char)*n;
+                    if (n < end && (s->classes[g->arg][c >> 3] & (1u << (c & 7)))) {
+                        n++;
+                        op++;
+                        continue;
+                    }
+                    break;
+                }
+                default:
+                    if ((size_t)(end - n) >= g->len && memcmp(n, s->text + g->arg, g->len) == 0) {
+                        n += g->len;
+                        op++;
+                        continue;
+                    }
+                    break;
+            }
+        } else if (n == end) {
+            return 1;
+        }
+
+        /* Mismatch: let the last * swallow one more character */
+        if (star_op < 0 || star_n == end) return 0;
+        n = ++star_n;
+        op = star_op + 1;
+    }
+}
+
+/*
+ * ============================================================================
+ * Directory listings (read once per command line)
+ * ============================================================================
+ */
+
+typedef struct {
+    uint32_t name;          /* Offset into names */
+    uint16_t len;
+    unsigned char type;     /* DT_* from the directory entry */
+} DirEntry;
+
+typedef struct DirListing {
+    char *path;
+    uint64_t hash;
+    char *names;
+    size_t names_len;
+    DirEntry *entries;
+    int count;
+    struct DirListing *chain;
+} DirListing;
+
+typedef struct {
+    DirListing *buckets[GLOB_BUCKETS];
+    pthread_mutex_t lock;   /* Held around lookups and inserts */
+} DirCache;
+
+static void listing_free(DirListing *l) {
+    free(l->path);
+    free(l->names);
+    free(l->entries);
+    free(l);
+}
+
+static int listing_add(DirListing *l, size_t *names_cap, int *cap,
+                       const char *name, unsigned char type) {
+    size_t len = strlen(name);
+    if (name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'))) return 0;
+    if (len > UINT16_MAX) return 0;
+
+    if (l->names_len + len + 1 > *names_cap) {
+        size_t ncap = *names_cap ? *names_cap * 2 : 4096;
+        while (ncap < l->names_len + len + 1) ncap *= 2;
+        char *names = realloc(l->names, ncap);
+        if (!names) return -1;
+        l->names = names;
+        *names_cap = ncap;
+    }
+    if (l->count >= *cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        DirEntry *entries = realloc(l->entries, ncap * sizeof(DirEntry));
+        if (!entries) return -1;
+        l->entries = entries;
+        *cap = ncap;
+    }
+
+    memcpy(l->names + l->names_len, name, len + 1);
+    l->entries[l->count].name = (uint32_t)l->names_len;
+    l->entries[l->count].len = (uint16_t)len;
+    l->entries[l->count].type = type;
+    l->count++;
+    l->names_len += len + 1;
+    return 0;
+}
+
+#ifdef __linux__
+/* Kernel layout of getdents64 records */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+/*
+ * Read a directory ("" is the cwd). Unreadable directories give an
+ * empty listing, as they match nothing.
+ */
+static DirListing *listing_read(const char *path) {
+    DirListing *l = calloc(1, sizeof(DirListing));
+    if (!l) return NULL;
+    l->path = strdup(path);
+    if (!l->path) {
+        free(l);
+        return NULL;
+    }
+
+    size_t names_cap = 0;
+    int cap = 0;
+    const char *dir = path[0] ? path : ".";
+
+#ifdef __linux__
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return l;
+
+    char *buf = malloc(GETDENTS_BATCH);
+    for (;;) {
+        long n = buf ? syscall(SYS_getdents64, fd, buf, GETDENTS_BATCH) : -1;
+        if (n <= 0) break;
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            if (listing_add(l, &names_cap, &cap, d->d_name, d->d_type) < 0) {
+                n = 0;
+                break;
+            }
+            off += d->d_reclen;
+        }
+    }
+    free(buf);
+    close(fd);
+#else
+    DIR *d = opendir(dir);
+    if (!d) return l;
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (listing_add(l, &names_cap, &cap, e->d_name, e->d_type) < 0) break;
+    }
+    closedir(d);
+#endif
+
+    return l;
+}
+
+static DirListing *cache_find(DirCache *cache, const char *path, uint64_t hash) {
+    DirListing *l = cache->buckets[hash & (GLOB_BUCKETS - 1)];
+    while (l && (l->hash != hash || strcmp(l->path, path) != 0)) {
+        l = l->chain;
+    }
+    return l;
+}
+
+/* Get a directory's listing, reading it on first use (thread-safe) */
+static DirListing *cache_get(DirCache *cache, const char *path) {
+    uint64_t hash = hash_str(path, HASH_SEED);
+
+    pthread_mutex_lock(&cache->lock);
+    DirListing *l = cache_find(cache, path, hash);
+    pthread_mutex_unlock(&cache->lock);
+    if (l) return l;
+
+    DirListing *fresh = listing_read(path);
+    if (!fresh) return NULL;
+    fresh->hash = hash;
+
+    /* Another walker may have read it meanwhile; keep the first */
+    pthread_mutex_lock(&cache->lock);
+    l = cache_find(cache, path, hash);
+    if (!l) {
+        fresh->chain = cache->buckets[hash & (GLOB_BUCKETS - 1)];
+        cache->buckets[hash & (GLOB_BUCKETS - 1)] = fresh;
+        l = fresh;
+        fresh = NULL;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (fresh) listing_free(fresh);
+    return l;
+}
+
+static void cache_free(DirCache *cache) {
+    for (int i = 0; i < GLOB_BUCKETS; i++) {
+        DirListing *l = cache->buckets[i];
+        while (l) {
+            DirListing *next = l->chain;
+            listing_free(l);
+            l = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+}
+
+/*
+ * ============================================================================
+ * Expansion
+ * ============================================================================
+ */
+
+typedef struct {
+    char **items;
+    int count;
+    int cap;
+} PathList;
+
+/*
+ * Append path, taking ownership: it is freed if it cannot be added. A
+ * NULL path (its allocation failed) is an error too, returns -1.
+ */
+static int pathlist_add(PathList *list, char *path) {
+    if (!path) return -1;
+    if (list->count >= list->cap) {
+        int cap = list->cap ? list->cap * 2 : 16;
+        char **items = realloc(list->items, cap * sizeof(char *));
+        if (!items) {
+            free(path);
+            return -1;
+        }
+        list->items = items;
+        list->cap = cap;
+    }
+    list->items[list->count++] = path;
+    return 0;
+}
+
+static void pathlist_free(PathList *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+/* base + "/" + name, where base "" is the cwd */
+static char *path_join(const char *base, const char *name, size_t name_len, const char *suffix) {
+    size_t base_len = strlen(base);
+    int sep = base_len > 0 && base[base_len - 1] != '/';
+    char *out = malloc(base_len + sep + name_len + strlen(suffix) + 1);
+    if (!out) return NULL;
+
+    memcpy(out, base, base_len);
+    if (sep) out[base_len] = '/';
+    memcpy(out + base_len + sep, name, name_len);
+    strcpy(out + base_len + sep + name_len, suffix);
+    return out;
+}
+
+/* Is this entry a directory (following symlinks, like the shell does)? */
+static int entry_is_dir(const char *base, const DirListing *l, const DirEntry *e, int follow) {
+    if (e->type == DT_DIR) return 1;
+    if (e->type != DT_UNKNOWN && (e->type != DT_LNK || !follow)) return 0;
+
+    char *path = path_join(base, l->names + e->name, e->len, "");
+    struct stat st;
+    int dir = path && (follow ? stat(path, &st) : lstat(path, &st)) == 0 && S_ISDIR(st.st_mode);
+    free(path);
+    return dir;
+}
+
+/* ** walk state, shared by the walker threads */
+typedef struct {
+    DirCache *cache;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    PathList queue;         /* Directories not yet read */
+    PathList found;         /* Every directory reached, base included */
+    int active;             /* Walkers currently reading a directory */
+    int workers_started;
+    int failed;
+} Walk;
+
+static void *walk_worker(void *arg);
+
+/*
+ * Take directories off the queue until it is empty and no walker can add
+ * more. The first walker starts helpers once the queue is long enough.
+ */
+static void walk_loop(Walk *w, int first) {
+    pthread_t helpers[WALK_MAX_WORKERS];
+    int helper_count = 0;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (w->queue.count == 0 && w->active > 0) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (w->queue.count == 0) break;
+
+        char *dir = w->queue.items[--w->queue.count];
+        w->active++;
+        pthread_mutex_unlock(&w->lock);
+
+        /* Read outside the lock; failures are recorded once it is retaken */
+        PathList subdirs = {NULL, 0, 0};
+        int failed = 0;
+        DirListing *l = cache_get(w->cache, dir);
+        for (int i = 0; l && i < l->count; i++) {
+            const DirEntry *e = &l->entries[i];
+            if (l->names[e->name] == '.' || !entry_is_dir(dir, l, e, 0)) continue;
+            if (pathlist_add(&subdirs, path_join(dir, l->names + e->name, e->len, "")) < 0) {
+                failed = 1;
+                break;
+            }
+        }
+        if (!l) failed = 1;
+        free(dir);
+
+        pthread_mutex_lock(&w->lock);
+        if (failed) w->failed = 1;
+        for (int i = 0; i < subdirs.count; i++) {
+            /* Both adds own their argument, freed on failure */
+            if (pathlist_add(&w->queue, strdup(subdirs.items[i])) < 0) {
+                w->failed = 1;
+                free(subdirs.items[i]);
+            } else if (pathlist_add(&w->found, subdirs.items[i]) < 0) {
+                w->failed = 1;
+            }
+        }
+        free(subdirs.items);
+        w->active--;
+        pthread_cond_broadcast(&w->cond);
+
+        /* Big tree: share the queue with helper threads */
+        if (first && !w->workers_started && w->queue.count >= WALK_PARALLEL_MIN) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            int want = cpus > 1 ? (int)(cpus - 1) : 0;
+            if (want > WALK_MAX_WORKERS) want = WALK_MAX_WORKERS;
+            w->workers_started = 1;
+            for (int i = 0; i < want; i++) {
+                if (pthread_create(&helpers[helper_count], NULL, walk_worker, w) == 0) {
+                    helper_count++;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    for (int i = 0; i < helper_count; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+}
+
+static void *walk_worker(void *arg) {
+    walk_loop(arg, 0);
+    return NULL;
+}
+
+/* Collect base and every non-hidden directory below it, not following symlinks */
+static int walk_tree(DirCache *cache, const char *base, PathList *dirs) {
+    Walk w;
+    memset(&w, 0, sizeof(w));
+    w.cache = cache;
+    pthread_mutex_init(&w.lock, NULL);
+    pthread_cond_init(&w.cond, NULL);
+
+    if (pathlist_add(&w.queue, strdup(base)) < 0 || pathlist_add(&w.found, strdup(base)) < 0) {
+        w.failed = 1;
+    } else {
+        walk_loop(&w, 1);
+    }
+
+    pathlist_free(&w.queue);
+    pthread_mutex_destroy(&w.lock);
+    pthread_cond_destroy(&w.cond);
+
+    *dirs = w.found;
+    return w.failed ? -1 : 0;
+}
+
+typedef struct {
+    DirCache *cache;
+    GlobSegment *segs;
+    char **raw;             /* Segment source text (for literal segments) */
+    int count;
+    int want_dir;           /* Pattern ended in '/' */
+    PathList *out;
+} Expansion;
+
+static char *unescape(const char *p, size_t len) {
+    char *out = malloc(len + 1);
+    if (!out) return NULL;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '\\' && i + 1 < len) i++;
+        out[n++] = p[i];
+    }
+    out[n] = '\0';
+    return out;
+}
+
+/* Add a final match, checking it exists (and is a directory for a trailing /) */
+static int add_match(Expansion *x, char *path) {
+    if (!path) return -1;
+    struct stat st;
+    int ok = x->want_dir ? stat(path, &st) == 0 && S_ISDIR(st.st_mode) : lstat(path, &st) == 0;
+    if (!ok) {
+        free(path);
+        return 0;
+    }
+    if (x->want_dir) {
+        size_t len = strlen(path);
+        char *slashed = realloc(path, len + 2);
+        if (!slashed) {
+            free(path);
+            return -1;
+        }
+        strcpy(slashed + len, "/");
+        path = slashed;
+    }
+    return pathlist_add(x->out, path);
+}
+
+static int expand_from(Expansion *x, const char *base, int seg);
+
+/* Match every non-hidden entry of base against segment seg */
+static int expand_dir(Expansion *x, const char *base, int seg) {
+    DirListing *l = cache_get(x->cache, base);
+    if (!l) return -1;
+
+    int last = seg == x->count - 1;
+    for (int i = 0; i < l->count; i++) {
+        const DirEntry *e = &l->entries[i];
+        const char *name = l->names + e->name;
+        if (!segment_match(&x->segs[seg], name, e->len)) continue;
+
+        if (last) {
+            if (!x->want_dir || entry_is_dir(base, l, e, 1)) {
+                if (add_match(x, path_join(base, name, e->len, "")) < 0) return -1;
+            }
+        } else if (entry_is_dir(base, l, e, 1)) {
+            char *next = path_join(base, name, e->len, "");
+            int rc = next ? expand_from(x, next, seg + 1) : -1;
+            free(next);
+            if (rc < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static int expand_from(Expansion *x, const char *base, int seg) {
+    if (seg == x->count) {
+        return add_match(x, strdup(base[0] ? base : "."));
+    }
+
+    /* ** : this segment matches any number of directories */
+    if (strcmp(x->raw[seg], "**") == 0) {
+        PathList dirs;
+        int rc = walk_tree(x->cache, base, &dirs);
+        for (int i = 0; rc == 0 && i < dirs.count; i++) {
+            if (seg == x->count - 1) {
+                /* Trailing **: everything below, files included */
+                if (i > 0) rc = add_match(x, strdup(dirs.items[i]));
+                if (rc == 0 && !x->want_dir) {
+                    DirListing *l = cache_get(x->cache, dirs.items[i]);
+                    for (int k = 0; l && rc == 0 && k < l->count; k++) {
+                        const DirEntry *e = &l->entries[k];
+                        if (l->names[e->name] == '.' || e->type == DT_DIR) continue;
+                        rc = add_match(x, path_join(dirs.items[i], l->names + e->name, e->len, ""));
+                    }
+                }
+            } else {
+                rc = expand_from(x, dirs.items[i], seg + 1);
+            }
+        }
+        pathlist_free(&dirs);
+        return rc;
+    }
+
+    /* A literal segment needs no listing */
+    if (!x->segs[seg].has_meta) {
+        char *name = unescape(x->raw[seg], strlen(x->raw[seg]));
+        char *next = name ? path_join(base, name, strlen(name), "") : NULL;
+        free(name);
+        if (!next) return -1;
+
+        int rc = seg == x->count - 1 ? add_match(x, next) : expand_from(x, next, seg + 1);
+        if (seg != x->count - 1) free(next);
+        return rc;
+    }
+
+    return expand_dir(x, base, seg);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+ * Expand one pattern into out (sorted). Returns 0 on success, 1 if the
+ * word has no real metacharacters, -1 on error.
+ */
+static int expand_pattern(DirCache *cache, const char *pattern, PathList *out) {
+    size_t len = strlen(pattern);
+    char *copy = malloc(len + 1);
+    int nseg = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (pattern[i] == '/') nseg++;
+    }
+
+    GlobSegment *segs = calloc(nseg, sizeof(GlobSegment));
+    char **raw = calloc(nseg, sizeof(char *));
+    if (!copy || !segs || !raw) {
+        free(copy);
+        free(segs);
+        free(raw);
+        return -1;
+    }
+    memcpy(copy, pattern, len + 1);
+
+    /* Split on '/', dropping empty segments; remember a trailing one */
+    Expansion x = {cache, segs, raw, 0, len > 0 && pattern[len - 1] == '/', out};
+    int meta = 0;
+    int rc = 0;
+    for (char *p = copy; rc == 0 && *p; ) {
+        char *slash = strchr(p, '/');
+        if (slash) *slash = '\0';
+        if (*p) {
+            raw[x.count] = p;
+            if (segment_compile(&segs[x.count], p, strlen(p)) < 0) rc = -1;
+            if (segs[x.count].has_meta || strcmp(p, "**") == 0) meta = 1;
+            x.count++;
+        }
+        if (!slash) break;
+        p = slash + 1;
+    }
+
+    if (rc == 0 && !meta) {
+        rc = 1;
+    } else if (rc == 0) {
+        rc = expand_from(&x, pattern[0] == '/' ? "/" : "", 0);
+        if (rc == 0 && out->count > 1) {
+            qsort(out->items, out->count, sizeof(char *), compare_paths);
+        }
+    }
+
+    for (int i = 0; i < x.count; i++) {
+        segment_free(&segs[i]);
+    }
+    free(segs);
+    free(raw);
+    free(copy);
+    return rc;
+}
+
+static int tokens_push(Token **tokens, int *count, int *cap, TokenType type, char *value) {
+    if (*count >= *cap) {
+        int ncap = *cap ? *cap * 2 : 16;
+        Token *grown = realloc(*tokens, ncap * sizeof(Token));
+        if (!grown) {
+            free(value);
+            return -1;
+        }
+        *tokens = grown;
+        *cap = ncap;
+    }
+    (*tokens)[*count].type = type;
+    (*tokens)[*count].value = value;
+    (*tokens)[*count].flags = 0;
+    (*count)++;
+    return 0;
+}
+
+int glob_expand_tokens(TokenList *list) {
+    int patterns = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (list->tokens[i].flags & TOKEN_GLOB) patterns++;
+    }
+    if (patterns == 0) return 0;
+
+    DirCache cache;
+    memset(&cache, 0, sizeof(cache));
+    pthread_mutex_init(&cache.lock, NULL);
+
+    Token *tokens = NULL;
+    int count = 0;
+    int cap = 0;
+    int rc = 0;
+
+    for (int i = 0; rc == 0 && i < list->count; i++) {
+        Token *tok = &list->tokens[i];
+        if (!(tok->flags & TOKEN_GLOB)) {
+            rc = tokens_push(&tokens, &count, &cap, tok->type, tok->value);
+            if (rc == 0) tok->value = NULL;
+            continue;
+        }
+
+        /* Redirect targets and here-strings are not expanded (as in a
+         * non-interactive sh) */
+        int redirect = i > 0 && (list->tokens[i - 1].type == TOK_REDIR_IN ||
+                                 list->tokens[i - 1].type == TOK_REDIR_OUT ||
+                                 list->tokens[i - 1].type == TOK_REDIR_APP ||
+                                 list->tokens[i - 1].type == TOK_HERESTRING);
+
+        PathList matches = {NULL, 0, 0};
+        int found = redirect ? 1 : expand_pattern(&cache, tok->value, &matches);
+        if (found < 0) {
+            pathlist_free(&matches);
+            rc = -1;
+            break;
+        }
+
+        if (matches.count == 0) {
+            /* No match: the word stays, minus its escapes */
+            char *word = unescape(tok->value, strlen(tok->value));
+            rc = word ? tokens_push(&tokens, &count, &cap, TOK_WORD, word) : -1;
+        }
+        for (int k = 0; rc == 0 && k < matches.count; k++) {
+            rc = tokens_push(&tokens, &count, &cap, TOK_WORD, matches.items[k]);
+            matches.items[k] = NULL;
+        }
+        pathlist_free(&matches);
+    }
+
+    cache_free(&cache);
+    pthread_mutex_destroy(&cache.lock);
+
+    if (rc < 0) {
+        for (int i = 0; i < count; i++) {
+            free(tokens[i].value);
+        }
+        free(tokens);
+        return -1;
+    }
+
+    /* Swap in the expanded tokens */
+    for (int i = 0; i < list->count; i++) {
+        free(list->tokens[i].value);
+    }
+    free(list->tokens);
+    list->tokens = tokens;
+    list->count = count;
+    list->capacity = cap;
+    return patterns;
+}
@@ -0,0 +1,18 @@
+/*
+ * shelli - Educational Shell
+ * glob.h - Pathname expansion
+ */
+
+#ifndef GLOB_H
+#define GLOB_H
+
+#include "lexer.h"
+
+/* Replace every TOKEN_GLOB word with the sorted paths it matches (a word
+ * that matches nothing stays, unescaped). Runs on a list entry's tokens
+ * after lexer_expand, before they are parsed.
+ * Returns the number of pattern words (0: the line doesn't depend on the
+ * filesystem), -1 on error. */
+int glob_expand_tokens(TokenList *list);
+
+#endif /* GLOB_H */
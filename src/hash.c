@@ -0,0 +1,27 @@
+/*
+ * shelli - Educational Shell
+ * hash.c - FNV-1a hashing shared by the caches
+ */
+
+#include "hash.h"
+
+#define FNV_PRIME 1099511628211ULL
+
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = data;
+    uint64_t h = seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+uint64_t hash_str(const char *s, uint64_t seed) {
+    uint64_t h = seed;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
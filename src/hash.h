@@ -0,0 +1,21 @@
+/*
+ * shelli - Educational Shell
+ * hash.h - Non-cryptographic hashing shared by the caches
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* FNV-1a 64-bit offset basis, used as the seed for a fresh hash */
+#define HASH_SEED 14695981039346656037ULL
+
+/* Hash len bytes, continuing from seed (pass HASH_SEED to start) */
+uint64_t hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/* Hash a NUL-terminated string, continuing from seed */
+uint64_t hash_str(const char *s, uint64_t seed);
+
+#endif /* HASH_H */
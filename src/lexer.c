@@ -7,6 +7,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "lexer.h"
+#include "vars.h"
 
 #define INITIAL_CAPACITY 16
 
@@ -50,6 +51,316 @@ static int tokenlist_add(TokenList *list, TokenType type, const char *value) {
     Token *tok = &list->tokens[list->count++];
     tok->type = type;
     tok->value = value ? strdup(value) : NULL;
+    tok->flags = 0;
+    return 0;
+}
+
+/* Text being collected: a word or a heredoc body */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} TextBuf;
+
+static int text_append(TextBuf *t, const char *s, size_t n) {
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 256;
+        while (cap < t->len + n + 1) cap *= 2;
+        char *data = realloc(t->data, cap);
+        if (!data) return -1;
+        t->data = data;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+    return 0;
+}
+
+int tokenlist_copy(const TokenList *list, int start, int end, TokenList *out) {
+    tokenlist_init(out);
+    for (int i = start; i < end; i++) {
+        const Token *tok = &list->tokens[i];
+        if (tokenlist_add(out, tok->type, tok->value) < 0 ||
+            (tok->value && !out->tokens[out->count - 1].value)) {
+            tokenlist_free(out);
+            return -1;
+        }
+        out->tokens[out->count - 1].flags = tok->flags;
+    }
+    if (tokenlist_add(out, TOK_EOF, NULL) < 0) {
+        tokenlist_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * A word being built. Alongside the text the lexer keeps the word as a
+ * glob pattern, with quoted metacharacters escaped, in case an unquoted
+ * *, ? or [ turns up, and as a source form for words with variable
+ * references: the references as written, every other $ and \ (and the
+ * quoted metacharacters) escaped with \, so lexer_expand can fill them
+ * in later without losing track of what was quoted.
+ */
+typedef struct {
+    TextBuf text;
+    TextBuf pattern;
+    TextBuf source;
+    int glob;
+    int quoted;     /* Saw a quote: keep the word even if empty */
+    int var;        /* Has a variable reference */
+    int failed;     /* Ran out of memory */
+} WordBuf;
+
+static int is_glob_char(char c) {
+    return c == '*' || c == '?' || c == '[' || c == ']' || c == '\\';
+}
+
+static void word_putc(WordBuf *w, char c, int quoted) {
+    char escaped[2] = {'\\', c};
+    int escape = is_glob_char(c) && (quoted || c == '\\');
+    int source_escape = escape || c == '$';
+
+    if (text_append(&w->text, &c, 1) < 0 ||
+        text_append(&w->pattern, escaped + !escape, 1 + escape) < 0 ||
+        text_append(&w->source, escaped + !source_escape, 1 + source_escape) < 0) {
+        w->failed = 1;
+    }
+    if (!quoted && (c == '*' || c == '?' || c == '[')) w->glob = 1;
+}
+
+static void word_reset(WordBuf *w) {
+    w->text.len = w->pattern.len = w->source.len = 0;
+    w->glob = w->quoted = w->var = 0;
+}
+
+static void word_free(WordBuf *w) {
+    free(w->text.data);
+    free(w->pattern.data);
+    free(w->source.data);
+}
+
+/*
+ * Parse the $NAME, ${NAME} or $? reference at p. Returns the characters
+ * it spans, or 0 if p is not a reference (a literal $).
+ */
+static int var_ref(const char *p, const char **name, size_t *len) {
+    const char *n = p + 1;
+    size_t l = 0;
+
+    if (*n == '?') {
+        *name = n;
+        *len = 1;
+        return 2;
+    }
+    if (*n == '{') {
+        n++;
+        while (n[l] && n[l] != '}') l++;
+        if (n[l] != '}' || (!vars_valid_name(n, l) && !(l == 1 && n[0] == '?'))) return 0;
+        *name = n;
+        *len = l;
+        return (int)l + 3;
+    }
+    while (isalnum((unsigned char)n[l]) || n[l] == '_') l++;
+    if (!vars_valid_name(n, l)) return 0;
+    *name = n;
+    *len = l;
+    return (int)l + 1;
+}
+
+/*
+ * Add the reference at p to w's source form, as written. Returns the
+ * characters consumed, or 0 if p is not a reference.
+ */
+static int word_ref(WordBuf *w, const char *p) {
+    const char *name;
+    size_t len;
+    int consumed = var_ref(p, &name, &len);
+    if (consumed == 0) return 0;
+
+    if (text_append(&w->source, p, (size_t)consumed) < 0) w->failed = 1;
+    w->var = 1;
+    return consumed;
+}
+
+/*
+ * Build w from a word's source form, with the variables' current values.
+ * Values are added as quoted text: they are never split or globbed.
+ */
+static void word_expand(WordBuf *w, const char *s) {
+    while (*s) {
+        const char *name;
+        size_t len;
+        int consumed = *s == '$' ? var_ref(s, &name, &len) : 0;
+
+        if (*s == '\\' && s[1]) {
+            word_putc(w, s[1], 1);
+            s += 2;
+        } else if (consumed > 0) {
+            const char *value = vars_get_n(name, len);
+            for (; value && *value; value++) word_putc(w, *value, 1);
+            s += consumed;
+        } else {
+            word_putc(w, *s++, 0);
+        }
+    }
+}
+
+static int word_finish(TokenList *list, WordBuf *w) {
+    /* Make sure all three forms are terminated strings */
+    if (text_append(&w->text, "", 0) < 0 || text_append(&w->pattern, "", 0) < 0 ||
+        text_append(&w->source, "", 0) < 0 || w->failed) {
+        return -1;
+    }
+
+    const char *value = w->var ? w->source.data : w->glob ? w->pattern.data : w->text.data;
+    if (tokenlist_add(list, TOK_WORD, value) < 0) return -1;
+
+    Token *tok = &list->tokens[list->count - 1];
+    if (w->glob) tok->flags |= TOKEN_GLOB;
+    if (w->var) tok->flags |= TOKEN_VAR;
+    if (w->quoted) tok->flags |= TOKEN_QUOTED;
+    word_reset(w);
+    return 0;
+}
+
+int lexer_expand(TokenList *list) {
+    WordBuf w;
+    int kept = 0;
+    int rc = 0;
+
+    memset(&w, 0, sizeof(w));
+    for (int i = 0; i < list->count; i++) {
+        Token tok = list->tokens[i];
+
+        if (tok.flags & TOKEN_VAR) {
+            word_expand(&w, tok.value);
+            if (text_append(&w.text, "", 0) < 0 || text_append(&w.pattern, "", 0) < 0 ||
+                w.failed) {
+                rc = -1;
+                break;
+            }
+
+            /* An unquoted word that expands to nothing leaves no word */
+            if (w.text.len == 0 && !(tok.flags & TOKEN_QUOTED)) {
+                free(tok.value);
+                word_reset(&w);
+                continue;
+            }
+            char *value = strdup(tok.flags & TOKEN_GLOB ? w.pattern.data : w.text.data);
+            if (!value) {
+                rc = -1;
+                break;
+            }
+            free(tok.value);
+            tok.value = value;
+            tok.flags &= ~TOKEN_VAR;
+            word_reset(&w);
+        }
+        list->tokens[kept++] = tok;
+    }
+
+    /* Keep the rest of the list as it was after a failure */
+    for (int i = kept; rc < 0 && i < list->count; i++) {
+        list->tokens[kept++] = list->tokens[i];
+    }
+    list->count = kept;
+    word_free(&w);
+    return rc;
+}
+
+int tokenlist_is_dynamic(const TokenList *list) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->tokens[i].flags & (TOKEN_GLOB | TOKEN_VAR)) return 1;
+    }
+    return 0;
+}
+
+#define MAX_HEREDOCS 16  /* Heredocs pending on one command line */
+
+typedef struct {
+    int token;          /* Index of the delimiter word, replaced by the body */
+    int strip_tabs;     /* <<- */
+    int expand;         /* Unquoted delimiter: $ references are expanded */
+} Heredoc;
+
+/* Note a heredoc whose delimiter word was just added to the list */
+static int heredoc_note(TokenList *list, Heredoc *docs, int *count, int quoted) {
+    if (list->count < 2 || list->tokens[list->count - 1].type != TOK_WORD) return 0;
+    TokenType op = list->tokens[list->count - 2].type;
+    if (op != TOK_HEREDOC && op != TOK_HEREDOC_TAB) return 0;
+
+    if (*count >= MAX_HEREDOCS) return -1;
+    docs[*count].token = list->count - 1;
+    docs[*count].strip_tabs = op == TOK_HEREDOC_TAB;
+    docs[*count].expand = !quoted;
+    (*count)++;
+    return 0;
+}
+
+/*
+ * Read the bodies of the pending heredocs, in order, from the lines
+ * after *pos (the newline ending their command line). Each body replaces
+ * its delimiter word; *pos is left at the line after the last delimiter.
+ */
+static int heredoc_read(TokenList *list, Heredoc *docs, int count, const char **pos) {
+    const char *p = *pos + 1;
+
+    for (int i = 0; i < count; i++) {
+        Token *delim = &list->tokens[docs[i].token];
+        size_t delim_len = strlen(delim->value);
+        TextBuf body = {NULL, 0, 0};
+
+        for (;;) {
+            if (*p == '\0') {
+                free(body.data);
+                return LEXER_INCOMPLETE;
+            }
+            const char *end = strchr(p, '\n');
+            if (!end) end = p + strlen(p);
+            const char *line = p;
+            if (docs[i].strip_tabs) {
+                while (*line == '\t') line++;
+            }
+            p = *end ? end + 1 : end;
+
+            size_t n = (size_t)(end - line);
+            if (n == delim_len && memcmp(line, delim->value, n) == 0) break;
+            if (text_append(&body, line, n) < 0 || text_append(&body, "\n", 1) < 0) {
+                free(body.data);
+                return -1;
+            }
+        }
+
+        if (!body.data && text_append(&body, "", 0) < 0) return -1;
+        free(delim->value);
+        delim->value = body.data;
+        delim->flags = 0;
+
+        /* A body with references keeps them for lexer_expand, like a
+         * double-quoted word */
+        if (docs[i].expand && strchr(body.data, '$')) {
+            WordBuf w;
+            memset(&w, 0, sizeof(w));
+            for (const char *b = body.data; *b; ) {
+                int n = *b == '$' ? word_ref(&w, b) : 0;
+                if (n == 0) word_putc(&w, *b, 1);
+                b += n ? n : 1;
+            }
+            if (w.var && !w.failed && text_append(&w.source, "", 0) == 0) {
+                free(delim->value);
+                delim->value = w.source.data;
+                w.source.data = NULL;
+                delim->flags = TOKEN_VAR | TOKEN_QUOTED;
+            }
+            int failed = w.failed;
+            word_free(&w);
+            if (failed) return -1;
+        }
+    }
+
+    *pos = p;
     return 0;
 }
 
@@ -60,6 +371,12 @@ const char *token_type_str(TokenType type) {
         case TOK_REDIR_IN:  return "REDIR_IN";
         case TOK_REDIR_OUT: return "REDIR_OUT";
         case TOK_REDIR_APP: return "REDIR_APP";
+        case TOK_HEREDOC:   return "HEREDOC";
+        case TOK_HEREDOC_TAB: return "HEREDOC_TAB";
+        case TOK_HERESTRING: return "HERESTRING";
+        case TOK_SEMI:      return "SEMI";
+        case TOK_AND:       return "AND";
+        case TOK_OR:        return "OR";
         case TOK_EOF:       return "EOF";
         default:            return "UNKNOWN";
     }
@@ -67,11 +384,14 @@ const char *token_type_str(TokenType type) {
 
 int lexer_tokenize(const char *input, TokenList *list) {
     LexerState state = STATE_START;
-    char wordbuf[1024];
-    int wordlen = 0;
+    WordBuf word;
+    Heredoc heredocs[MAX_HEREDOCS];
+    int pending = 0;
+    int rc = -1;
     const char *p = input;
 
     tokenlist_init(list);
+    memset(&word, 0, sizeof(word));
 
     while (1) {
         char c = *p;
@@ -80,11 +400,46 @@ int lexer_tokenize(const char *input, TokenList *list) {
         case STATE_START:
             if (c == '\0') {
                 goto done;
+            } else if (c == '\n') {
+                /* A newline ends the command, like ';', unless the line
+                 * ended on an operator that needs more */
+                if (list->count > 0 && list->tokens[list->count - 1].type == TOK_WORD) {
+                    if (tokenlist_add(list, TOK_SEMI, ";") < 0) goto error;
+                }
+                if (pending > 0) {
+                    /* Heredoc bodies start on the next line */
+                    rc = heredoc_read(list, heredocs, pending, &p);
+                    if (rc < 0) goto error;
+                    rc = -1;
+                    pending = 0;
+                } else {
+                    p++;
+                }
             } else if (isspace(c)) {
                 p++;
             } else if (c == '|') {
-                if (tokenlist_add(list, TOK_PIPE, "|") < 0) goto error;
+                if (*(p + 1) == '|') {
+                    if (tokenlist_add(list, TOK_OR, "||") < 0) goto error;
+                    p += 2;
+                } else {
+                    if (tokenlist_add(list, TOK_PIPE, "|") < 0) goto error;
+                    p++;
+                }
+            } else if (c == '&' && *(p + 1) == '&') {
+                if (tokenlist_add(list, TOK_AND, "&&") < 0) goto error;
+                p += 2;
+            } else if (c == ';') {
+                if (tokenlist_add(list, TOK_SEMI, ";") < 0) goto error;
                 p++;
+            } else if (c == '<' && p[1] == '<' && p[2] == '<') {
+                if (tokenlist_add(list, TOK_HERESTRING, "<<<") < 0) goto error;
+                p += 3;
+            } else if (c == '<' && p[1] == '<' && p[2] == '-') {
+                if (tokenlist_add(list, TOK_HEREDOC_TAB, "<<-") < 0) goto error;
+                p += 3;
+            } else if (c == '<' && p[1] == '<') {
+                if (tokenlist_add(list, TOK_HEREDOC, "<<") < 0) goto error;
+                p += 2;
             } else if (c == '<') {
                 if (tokenlist_add(list, TOK_REDIR_IN, "<") < 0) goto error;
                 p++;
@@ -98,36 +453,41 @@ int lexer_tokenize(const char *input, TokenList *list) {
                 }
             } else if (c == '\'') {
                 state = STATE_SQUOTE;
+                word.quoted = 1;
                 p++;
             } else if (c == '"') {
                 state = STATE_DQUOTE;
+                word.quoted = 1;
                 p++;
             } else {
                 /* Start of word */
                 state = STATE_WORD;
-                wordbuf[wordlen++] = c;
-                p++;
+                int n = c == '$' ? word_ref(&word, p) : 0;
+                if (n == 0) word_putc(&word, c, 0);
+                p += n ? n : 1;
             }
             break;
 
         case STATE_WORD:
-            if (c == '\0' || isspace(c) || c == '|' || c == '<' || c == '>') {
+            if (c == '\0' || isspace(c) || c == '|' || c == '<' || c == '>' ||
+                c == ';' || (c == '&' && *(p + 1) == '&')) {
                 /* End of word */
-                wordbuf[wordlen] = '\0';
-                if (tokenlist_add(list, TOK_WORD, wordbuf) < 0) goto error;
-                wordlen = 0;
+                int quoted = word.quoted;
+                if (word_finish(list, &word) < 0) goto error;
+                if (heredoc_note(list, heredocs, &pending, quoted) < 0) goto error;
                 state = STATE_START;
             } else if (c == '\'') {
                 state = STATE_SQUOTE;
+                word.quoted = 1;
                 p++;
             } else if (c == '"') {
                 state = STATE_DQUOTE;
+                word.quoted = 1;
                 p++;
             } else {
-                if (wordlen < (int)sizeof(wordbuf) - 1) {
-                    wordbuf[wordlen++] = c;
-                }
-                p++;
+                int n = c == '$' ? word_ref(&word, p) : 0;
+                if (n == 0) word_putc(&word, c, 0);
+                p += n ? n : 1;
             }
             break;
 
@@ -139,9 +499,7 @@ int lexer_tokenize(const char *input, TokenList *list) {
                 state = STATE_WORD;
                 p++;
             } else {
-                if (wordlen < (int)sizeof(wordbuf) - 1) {
-                    wordbuf[wordlen++] = c;
-                }
+                word_putc(&word, c, 1);
                 p++;
             }
             break;
@@ -154,10 +512,9 @@ int lexer_tokenize(const char *input, TokenList *list) {
                 state = STATE_WORD;
                 p++;
             } else {
-                if (wordlen < (int)sizeof(wordbuf) - 1) {
-                    wordbuf[wordlen++] = c;
-                }
-                p++;
+                int n = c == '$' ? word_ref(&word, p) : 0;
+                if (n == 0) word_putc(&word, c, 1);
+                p += n ? n : 1;
             }
             break;
         }
@@ -165,17 +522,24 @@ int lexer_tokenize(const char *input, TokenList *list) {
 
 done:
     /* Finish any pending word */
-    if (wordlen > 0) {
-        wordbuf[wordlen] = '\0';
-        if (tokenlist_add(list, TOK_WORD, wordbuf) < 0) goto error;
+    if (state == STATE_WORD) {
+        if (word_finish(list, &word) < 0) goto error;
+    }
+
+    /* A heredoc needs at least its delimiter line */
+    if (pending > 0) {
+        rc = LEXER_INCOMPLETE;
+        goto error;
     }
 
     /* Add EOF token */
     if (tokenlist_add(list, TOK_EOF, NULL) < 0) goto error;
 
+    word_free(&word);
     return 0;
 
 error:
+    word_free(&word);
     tokenlist_free(list);
-    return -1;
+    return rc;
 }
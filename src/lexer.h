@@ -12,12 +12,27 @@ typedef enum {
     TOK_REDIR_IN,   /* < */
     TOK_REDIR_OUT,  /* > */
     TOK_REDIR_APP,  /* >> */
+    TOK_HEREDOC,    /* << (the next word is the body) */
+    TOK_HEREDOC_TAB, /* <<- (leading tabs stripped from the body) */
+    TOK_HERESTRING, /* <<< */
+    TOK_SEMI,       /* ; */
+    TOK_AND,        /* && */
+    TOK_OR,         /* || */
     TOK_EOF         /* End of input */
 } TokenType;
 
+/* Token flags */
+#define TOKEN_GLOB 0x1  /* Word has unquoted *, ? or [ (value is a pattern:
+                           quoted metacharacters are escaped with \) */
+#define TOKEN_VAR  0x2  /* Word has $NAME, ${NAME} or $? references (value is
+                           the source form: the references as written, other
+                           literal $ and \ escaped with \) */
+#define TOKEN_QUOTED 0x4 /* Word had quotes: kept even if it expands empty */
+
 typedef struct {
     TokenType type;
     char *value;    /* Dynamically allocated, NULL for operators */
+    int flags;      /* TOKEN_* */
 } Token;
 
 typedef struct {
@@ -32,9 +47,31 @@ void tokenlist_init(TokenList *list);
 /* Free all tokens and the list */
 void tokenlist_free(TokenList *list);
 
-/* Tokenize input string, returns 0 on success, -1 on error */
+/* lexer_tokenize result when a heredoc's delimiter line is missing */
+#define LEXER_INCOMPLETE -2
+
+/*
+ * Tokenize input string, returns 0 on success, -1 on error or
+ * LEXER_INCOMPLETE. A heredoc's body is read from the lines after the
+ * one holding its operator and replaces the delimiter word. A newline
+ * after a word ends the command like ';'.
+ */
 int lexer_tokenize(const char *input, TokenList *list);
 
+/* Replace every TOKEN_VAR word with its expansion from the variables'
+ * current values; an unquoted word that expands to nothing is removed.
+ * Runs just before the words are used, ahead of glob_expand_tokens.
+ * Returns 0 on success, -1 if out of memory. */
+int lexer_expand(TokenList *list);
+
+/* Copy tokens [start, end) into out, plus a TOK_EOF.
+ * Returns 0 on success, -1 if out of memory. */
+int tokenlist_copy(const TokenList *list, int start, int end, TokenList *out);
+
+/* Check whether any word depends on run-time state (globs, variables),
+ * so it must be expanded again each time it runs */
+int tokenlist_is_dynamic(const TokenList *list);
+
 /* Get string representation of token type */
 const char *token_type_str(TokenType type);
 
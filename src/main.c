@@ -7,44 +7,198 @@
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <unistd.h>
 #include "tui/tui.h"
 #include "lexer.h"
 #include "parser.h"
 #include "executor.h"
 #include "builtins.h"
+#include "plancache.h"
+#include "bytecode.h"
+#include "vars.h"
+#include "outbuf.h"
+#include "execevent.h"
 
 static volatile sig_atomic_t interrupted = 0;
 
+/* Time from main() to an interactive prompt that --startup-profile
+ * (and make bench-startup) holds startup to */
+#define STARTUP_BUDGET_MS 5.0
+#define STARTUP_PHASES    8
+
+static struct timespec startup_t0;
+static const char *startup_phase[STARTUP_PHASES];
+static double startup_ms[STARTUP_PHASES];
+static int startup_count = 0;
+
+/*
+ * Record that a startup phase has finished
+ */
+static void startup_mark(const char *phase) {
+    struct timespec now;
+
+    if (startup_count == STARTUP_PHASES) return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    startup_phase[startup_count] = phase;
+    startup_ms[startup_count++] = (now.tv_sec - startup_t0.tv_sec) * 1000.0 +
+                                  (now.tv_nsec - startup_t0.tv_nsec) / 1e6;
+}
+
+/*
+ * Print the phases (cumulative ms) to stderr; returns 0 within budget
+ */
+static int startup_report(void) {
+    double total = startup_count ? startup_ms[startup_count - 1] : 0.0;
+
+    fprintf(stderr, "startup:");
+    for (int i = 0; i < startup_count; i++) {
+        fprintf(stderr, " %s %.2f ms%s", startup_phase[i], startup_ms[i],
+                i < startup_count - 1 ? "," : "");
+    }
+    fprintf(stderr, " (budget %.1f ms%s)\n", STARTUP_BUDGET_MS,
+            total > STARTUP_BUDGET_MS ? ", OVER" : "");
+    return total > STARTUP_BUDGET_MS;
+}
+
 static void handle_sigint(int sig) {
     (void)sig;
     interrupted = 1;
 }
 
-static void exec_logger(const char *message) {
-    tui_log_exec(message);
+static void exec_trace(const ExecEvent *ev) {
+    tui_log_event(ev);
+}
+
+static void exec_progress(const char *label, long done, long total) {
+    tui_show_progress(label, done, total);
+}
+
+static void exec_output(OutBuf *output) {
+    tui_follow_output(output);
+}
+
+/* What the renderer builtin reports: the backend, plus how the full
+ * screen has adapted to the terminal */
+static const char *renderer_status(void) {
+    static char status[160];
+    char pace[128];
+
+    if (strcmp(tui_renderer_name(), "full") != 0) return tui_renderer_name();
+    pace_describe(pace, sizeof(pace));
+    snprintf(status, sizeof(status), "full (%s)", pace);
+    return status;
 }
 
 static void print_usage(const char *prog) {
     printf("Usage: %s [OPTIONS]\n", prog);
+    printf("       %s -c COMMAND\n", prog);
+    printf("       %s SCRIPT\n", prog);
     printf("\n");
     printf("Options:\n");
+    printf("  -c CMD     Run CMD without the TUI and exit with its status\n");
+    printf("  SCRIPT     Run each line of SCRIPT without the TUI\n");
     printf("  --debug    Enable step-by-step execution mode\n");
+    printf("  --pty      Run commands on a pseudo-terminal (see the pty builtin)\n");
+    printf("  --renderer NAME\n");
+    printf("             Display with NAME: full (default), line or null\n");
+    printf("  --startup-profile\n");
+    printf("             Start up to the first prompt, then exit and print the\n");
+    printf("             time each phase took (status 1 if over %.0f ms)\n", STARTUP_BUDGET_MS);
     printf("  --help     Show this help message\n");
     printf("\n");
     printf("shelli is an educational shell that visualizes how shells work.\n");
 }
 
+/*
+ * Look up or build the plan for a line. Returns NULL on error (message in
+ * error) or empty input. *owned is set when the caller must free the plan
+ * because it could not be cached.
+ */
+static CommandList *batch_plan(const char *line, int *owned, char *error, int error_size) {
+    *owned = 0;
+
+    CommandList *list = plancache_lookup(line);
+    if (list) return list;
+
+    TokenList tokens;
+    int ret = lexer_tokenize(line, &tokens);
+    if (ret < 0) {
+        snprintf(error, error_size, ret == LEXER_INCOMPLETE ? "heredoc delimiter not found"
+                                                            : "tokenization error (unterminated quote?)");
+        return NULL;
+    }
+
+    int dynamic = tokenlist_is_dynamic(&tokens);
+    list = parser_parse_list(&tokens, error, error_size);
+    tokenlist_free(&tokens);
+
+    /* A plan with words to expand is not cached (bytecode compiles cached
+     * plans as they are) */
+    if (list && (dynamic || plancache_insert(line, list) < 0)) {
+        *owned = 1;
+    }
+    return list;
+}
+
+/*
+ * Batch mode: run a command line directly, no TUI and no tracing
+ */
+static int run_batch(const char *line) {
+    char error[256] = "";
+    int owned;
+    CommandList *list = batch_plan(line, &owned, error, sizeof(error));
+
+    if (!list) {
+        if (error[0]) {
+            fprintf(stderr, "shelli: %s\n", error);
+            return 2;
+        }
+        return 0;
+    }
+
+    int status = executor_run_list(list);
+    if (owned) commandlist_free(list);
+    return status;
+}
+
 int main(int argc, char *argv[]) {
     int debug_mode = 0;
     int show_splash = 1;
+    int profile_startup = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &startup_t0);
 
     /* Parse arguments */
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--debug") == 0) {
+        if (strcmp(argv[i], "-c") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "shelli: -c: option requires an argument\n");
+                return 2;
+            }
+            return run_batch(argv[i + 1]);
+        } else if (argv[i][0] != '-') {
+            /* Script mode: compiled to bytecode, cached on disk */
+            return bytecode_run_file(argv[i]);
+        } else if (strcmp(argv[i], "--debug") == 0) {
             debug_mode = 1;
+        } else if (strcmp(argv[i], "--pty") == 0) {
+            executor_set_pty(1);
+        } else if (strcmp(argv[i], "--renderer") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "shelli: --renderer: option requires an argument\n");
+                return 2;
+            }
+            if (tui_set_renderer(argv[++i]) < 0) {
+                fprintf(stderr, "shelli: --renderer: unknown renderer '%s' (%s)\n",
+                        argv[i], tui_renderer_names());
+                return 2;
+            }
         } else if (strcmp(argv[i], "--no-splash") == 0) {
             show_splash = 0;
+        } else if (strcmp(argv[i], "--startup-profile") == 0) {
+            profile_startup = 1;
+            show_splash = 0;    /* It waits for a key */
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -60,6 +214,7 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Failed to initialize TUI\n");
         return 1;
     }
+    startup_mark("init");
 
     /* Set up signal handling (after TUI init to ensure cleanup works) */
     struct sigaction sa;
@@ -69,7 +224,10 @@ int main(int argc, char *argv[]) {
     sigaction(SIGINT, &sa, NULL);
 
     tui_set_debug(debug_mode);
-    executor_set_logger(exec_logger);
+    exec_events_set_sink(exec_trace);
+    executor_set_progress(exec_progress);
+    executor_set_output_callback(exec_output);
+    builtins_set_renderer(tui_set_renderer, renderer_status);
 
     /* Show splash screen */
     if (show_splash) {
@@ -78,6 +236,23 @@ int main(int argc, char *argv[]) {
 
     /* Draw initial frame */
     tui_draw_frame();
+    startup_mark("frame");
+
+    if (profile_startup) {
+        tui_stage_begin(STAGE_INPUT);
+        tui_draw_prompt();
+        startup_mark("prompt");
+        tui_cleanup();
+        return startup_report();
+    }
+
+    /* Output of the last command, shown in RESULT until the next one runs */
+    OutBuf *output = outbuf_new();
+    if (!output) {
+        tui_cleanup();
+        fprintf(stderr, "shelli: out of memory\n");
+        return 1;
+    }
 
     /* Main REPL loop */
     int last_exit = 0;
@@ -115,61 +290,81 @@ int main(int argc, char *argv[]) {
             tui_wait_step("Input received");
         }
 
-        /* Tokenize */
+        /* Reuse the plan if this exact line was parsed before */
         TokenList tokens;
-        if (lexer_tokenize(line, &tokens) < 0) {
-            tui_show_error("Tokenization error (unterminated quote?)");
-            free(line);
-            continue;
-        }
+        tokenlist_init(&tokens);
+        int list_owned = 0;
+        int dynamic = 0;
+        CommandList *list = plancache_lookup(line);
+
+        if (list) {
+            tui_stage_begin(STAGE_TOKENIZE);
+            tui_update_panel(PANEL_TOKENIZE, "plan cache hit: lexer and parser skipped");
+            tui_stage_end(STAGE_TOKENIZE);
+        } else {
+            /* Tokenize */
+            int ret = lexer_tokenize(line, &tokens);
+            if (ret < 0) {
+                /* The prompt reads one line, so a heredoc body cannot follow */
+                tui_show_error(ret == LEXER_INCOMPLETE
+                                   ? "Heredoc needs a script or -c (use <<< here)"
+                                   : "Tokenization error (unterminated quote?)");
+                free(line);
+                continue;
+            }
 
-        tui_show_tokens(&tokens);
+            /* Variables and globs are expanded as each list entry runs;
+             * the panel shows the words as written */
+            dynamic = tokenlist_is_dynamic(&tokens);
+            tui_show_tokens(&tokens);
 
-        if (tui_is_debug()) {
-            tui_wait_step("Tokenization complete");
-        }
+            if (tui_is_debug()) {
+                tui_wait_step("Tokenization complete");
+            }
 
-        /* Parse */
-        char error[256] = "";
-        Pipeline *pipeline = parser_parse(&tokens, error, sizeof(error));
+            /* Parse */
+            char error[256] = "";
+            list = parser_parse_list(&tokens, error, sizeof(error));
 
-        if (!pipeline && error[0]) {
-            tui_show_error(error);
-            tokenlist_free(&tokens);
-            free(line);
-            continue;
+            if (!list && error[0]) {
+                tui_show_error(error);
+                tokenlist_free(&tokens);
+                free(line);
+                continue;
+            }
+
+            /* A plan with words to expand is not cached (bytecode compiles
+             * cached plans as they are) */
+            if (list && (dynamic || plancache_insert(line, list) < 0)) {
+                list_owned = 1;
+            }
         }
 
-        if (pipeline) {
-            tui_show_pipeline(pipeline);
+        if (list) {
+            tui_show_list(list);
 
             if (tui_is_debug()) {
                 tui_wait_step("Parsing complete");
             }
 
-            /* Check if first command is exit (only for single command) */
-            if (pipeline->cmd_count == 1 &&
-                pipeline->first->argc > 0 &&
-                strcmp(pipeline->first->argv[0], "exit") == 0) {
+            /* Execute with output capture (exit runs in-process and stops the list) */
+            tui_stage_begin(STAGE_EXECUTE);
+            outbuf_reset(output);
+            last_exit = executor_run_list_capture(list, output);
+            vars_set_status(last_exit);
 
-                int dummy;
-                last_exit = builtin_execute(pipeline->first, &dummy);
+            if (executor_exit_requested()) {
                 should_exit = 1;
-                tui_log_exec("builtin: exit");
                 tui_show_result(last_exit, "Goodbye!");
             } else {
-                /* Execute with output capture */
-                tui_stage_begin(STAGE_EXECUTE);
-                char output_buf[1024] = "";
-                last_exit = executor_run_capture(pipeline, output_buf, sizeof(output_buf));
-                tui_show_result(last_exit, output_buf[0] ? output_buf : NULL);
+                tui_show_output(last_exit, output);
             }
 
             if (tui_is_debug()) {
                 tui_wait_step("Execution complete");
             }
 
-            pipeline_free(pipeline);
+            if (list_owned) commandlist_free(list);
         }
 
         tokenlist_free(&tokens);
@@ -178,6 +373,7 @@ int main(int argc, char *argv[]) {
 
     /* Cleanup TUI (restores terminal) */
     tui_cleanup();
+    outbuf_free(output);
 
     return last_exit;
 }
@@ -0,0 +1,436 @@
+/*
+ * shelli - Educational Shell
+ * memo.c - Content-addressed command output cache (the memo builtin)
+ *
+ * memo runs a command and, when it exits 0, stores its stdout on disk,
+ * keyed by everything the result is assumed to depend on: argv, a few
+ * environment variables, the working directory and the identity (inode,
+ * size, mtime) of each declared input. The key text is hashed with
+ * FNV-1a (hash.c) to name the entry and stored in it, so a hash collision
+ * is a miss rather than wrong output. A hit replays the stored output
+ * without spawning anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "memo.h"
+#include "executor.h"
+#include "execevent.h"
+#include "hash.h"
+#include "fsutil.h"
+
+#define MEMO_MAGIC   "SHMO"
+#define MEMO_VERSION 1
+
+#define MEMO_MAX_OUTPUT (64L * 1024 * 1024)  /* Larger outputs are not stored */
+#define MEMO_MAX_DECL   32                   /* -i / -e options per command */
+
+/* Environment variables every key includes */
+static const char *const memo_default_env[] = {"PATH", "LANG", "LC_ALL"};
+
+/* On-disk header, followed by the key text and the captured stdout */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t status;         /* Exit status of the run that was stored */
+    uint32_t key_len;
+    uint64_t out_len;
+    uint64_t out_hash;      /* Hash of the stdout bytes */
+} MemoHeader;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} MemoBuffer;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long hit_count = 0;
+static unsigned long miss_count = 0;
+static unsigned long store_count = 0;
+
+static void count(unsigned long *counter) {
+    pthread_mutex_lock(&stats_lock);
+    (*counter)++;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static double memo_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int buffer_add(MemoBuffer *b, const void *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (cap < b->len + len) cap *= 2;
+        char *p = realloc(b->data, cap);
+        if (!p) return -1;
+        b->data = p;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+/* Append a NUL-terminated field to the key */
+static int key_add(MemoBuffer *key, const char *text) {
+    return buffer_add(key, text, strlen(text) + 1);
+}
+
+/*
+ * Build the key text: argv, environment, cwd and declared inputs, each
+ * field NUL-terminated. Returns 0 on success.
+ */
+static int build_key(MemoBuffer *key, char **argv, const char **env, int env_count,
+                     const char **inputs, int input_count) {
+    char field[PATH_MAX + 128];
+    int rc = 0;
+
+    rc |= key_add(key, "argv");
+    for (int i = 0; argv[i]; i++) {
+        rc |= key_add(key, argv[i]);
+    }
+
+    for (int i = 0; i < env_count; i++) {
+        const char *value = getenv(env[i]);
+        snprintf(field, sizeof(field), "env %s%s%s", env[i], value ? "=" : "", value ? value : "");
+        rc |= key_add(key, field);
+    }
+
+    if (!getcwd(field, sizeof(field))) return -1;
+    rc |= key_add(key, "cwd");
+    rc |= key_add(key, field);
+
+    for (int i = 0; i < input_count; i++) {
+        struct stat st;
+        rc |= key_add(key, "input");
+        rc |= key_add(key, inputs[i]);
+        if (stat(inputs[i], &st) < 0) {
+            rc |= key_add(key, "missing");
+            continue;
+        }
+#ifdef __APPLE__
+        long nsec = (long)st.st_mtimespec.tv_nsec;
+#else
+        long nsec = (long)st.st_mtim.tv_nsec;
+#endif
+        snprintf(field, sizeof(field), "%llu %lld %lld.%09ld",
+                 (unsigned long long)st.st_ino, (long long)st.st_size,
+                 (long long)st.st_mtime, nsec);
+        rc |= key_add(key, field);
+    }
+
+    return rc ? -1 : 0;
+}
+
+/*
+ * Replay a stored entry if it matches the key. Returns 0 on a hit
+ * (status set), -1 on a miss. The entry is mapped, checked and written
+ * out from the mapping.
+ */
+static int memo_replay(const char *path, const MemoBuffer *key, BuiltinIO *io, int *status) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(MemoHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    MemoHeader h;
+    memcpy(&h, map, sizeof(h));
+    const char *stored_key = map + sizeof(h);
+    const char *out = stored_key + h.key_len;
+
+    int hit = memcmp(h.magic, MEMO_MAGIC, 4) == 0 && h.version == MEMO_VERSION &&
+              h.key_len == key->len &&
+              sizeof(h) + (uint64_t)h.key_len + h.out_len == size &&
+              memcmp(stored_key, key->data, key->len) == 0 &&
+              hash_bytes(out, h.out_len, HASH_SEED) == h.out_hash;
+
+    if (hit) {
+        if (h.out_len > 0 && builtin_io_write(io, out, h.out_len) < 0 && errno != EPIPE) {
+            perror("memo");
+        }
+        *status = h.status;
+    }
+
+    munmap(map, size);
+    return hit ? 0 : -1;
+}
+
+/*
+ * Store an entry atomically (write to a temp file, then rename)
+ */
+static void memo_store(const char *path, const MemoBuffer *key, const MemoBuffer *out, int status) {
+    char tmp[PATH_MAX + 96];
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+    /* memo runs as a pipeline thread, so the name must be unique per call */
+    int fd = mkstemp(tmp);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fchmod(fd, 0644);
+
+    MemoHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MEMO_MAGIC, 4);
+    h.version = MEMO_VERSION;
+    h.status = status;
+    h.key_len = (uint32_t)key->len;
+    h.out_len = out->len;
+    h.out_hash = hash_bytes(out->data, out->len, HASH_SEED);
+
+    int ok = write_full(fd, &h, sizeof(h)) == 0 &&
+             write_full(fd, key->data, key->len) == 0 &&
+             write_full(fd, out->data, out->len) == 0;
+
+    if (close(fd) < 0) ok = 0;
+    if (!ok || rename(tmp, path) < 0) {
+        unlink(tmp);
+        return;
+    }
+    count(&store_count);
+}
+
+/*
+ * Run the command, passing stdout through while keeping a copy and
+ * stderr straight through. Returns the exit status; *storable is
+ * cleared if the output can't be stored.
+ */
+static int memo_run(char **argv, BuiltinIO *io, MemoBuffer *out, int *storable) {
+    Command cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.argv = argv;
+    while (argv[cmd.argc]) cmd.argc++;
+
+    /* stdin isn't part of the key, so the command gets none */
+    int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    int fds[2] = {-1, -1};
+    double start_ms = memo_now_ms();
+    pid_t pid = executor_spawn_job(&cmd, null_fd, &fds[0], &fds[1]);
+    if (null_fd >= 0) close(null_fd);
+    if (pid < 0) {
+        fprintf(stderr, "memo: %s: cannot run\n", argv[0]);
+        *storable = 0;
+        return 127;
+    }
+
+    int write_failed = 0;
+    while (fds[0] >= 0 || fds[1] >= 0) {
+        struct pollfd pfd[2];
+        int n = 0;
+        for (int k = 0; k < 2; k++) {
+            if (fds[k] < 0) continue;
+            pfd[n].fd = fds[k];
+            pfd[n].events = POLLIN;
+            n++;
+        }
+        if (poll(pfd, n, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int k = 0; k < n; k++) {
+            if (!pfd[k].revents) continue;
+            int is_out = pfd[k].fd == fds[0];
+            char buf[65536];
+            ssize_t r = read(pfd[k].fd, buf, sizeof(buf));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                close(pfd[k].fd);
+                fds[is_out ? 0 : 1] = -1;
+                continue;
+            }
+
+            if (!is_out) {
+                write_full(STDERR_FILENO, buf, (size_t)r);
+                continue;
+            }
+            if (*storable && (out->len + (size_t)r > (size_t)MEMO_MAX_OUTPUT ||
+                              buffer_add(out, buf, (size_t)r) < 0)) {
+                *storable = 0;
+            }
+            if (!write_failed && builtin_io_write(io, buf, (size_t)r) < 0) {
+                write_failed = 1;
+            }
+        }
+    }
+    for (int k = 0; k < 2; k++) {
+        if (fds[k] >= 0) close(fds[k]);
+    }
+
+    int wstatus;
+    pid_t r;
+    while ((r = waitpid(pid, &wstatus, 0)) < 0 && errno == EINTR) {
+    }
+    int status = r < 0 ? 1 :
+                 WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) :
+                 WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : 1;
+    exec_event_emit(EXEC_EV_EXIT, 0, pid, status, 0, memo_now_ms() - start_ms, argv[0], NULL);
+
+    /*
+     * A killed command or a reader that went away leaves partial output.
+     * Failures are not stored either: their stderr isn't kept, so a
+     * replay would fail silently.
+     */
+    if (r < 0 || status != 0 || write_failed) *storable = 0;
+    return status;
+}
+
+/* Remove every cache entry, returns the number removed */
+static int memo_clear(void) {
+    char dir[PATH_MAX];
+    if (cache_dir("memo", dir, sizeof(dir)) < 0) return 0;
+
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+
+    int removed = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.') continue;
+        char path[PATH_MAX + 300];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (unlink(path) == 0) removed++;
+    }
+    closedir(d);
+    return removed;
+}
+
+void memo_stats(unsigned long *hits, unsigned long *misses, unsigned long *stores) {
+    pthread_mutex_lock(&stats_lock);
+    if (hits) *hits = hit_count;
+    if (misses) *misses = miss_count;
+    if (stores) *stores = store_count;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void memo_disk_usage(int *entries, long long *bytes) {
+    char dir[PATH_MAX];
+    *entries = 0;
+    *bytes = 0;
+    if (cache_dir("memo", dir, sizeof(dir)) < 0) return;
+
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        struct stat st;
+        char path[PATH_MAX + 300];
+        if (e->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            (*entries)++;
+            *bytes += st.st_size;
+        }
+    }
+    closedir(d);
+}
+
+static int memo_usage(void) {
+    fprintf(stderr, "usage: memo [-i input]... [-e VAR]... command [args...]\n"
+                    "       memo --clear\n");
+    return 2;
+}
+
+int builtin_memo(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+    const char *env[MEMO_MAX_DECL + 3];
+    const char *inputs[MEMO_MAX_DECL];
+    int env_count = 0;
+    int input_count = 0;
+
+    for (size_t k = 0; k < sizeof(memo_default_env) / sizeof(memo_default_env[0]); k++) {
+        env[env_count++] = memo_default_env[k];
+    }
+
+    if (cmd->argc == 2 && strcmp(cmd->argv[1], "--clear") == 0) {
+        builtin_io_printf(io, "memo: removed %d entries\n", memo_clear());
+        return 0;
+    }
+
+    /* Options: declared inputs and extra environment */
+    int i = 1;
+    for (; i < cmd->argc && cmd->argv[i][0] == '-'; i++) {
+        const char *arg = cmd->argv[i];
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        }
+
+        int is_input = strcmp(arg, "-i") == 0 || strcmp(arg, "--input") == 0;
+        int is_env = strcmp(arg, "-e") == 0 || strcmp(arg, "--env") == 0;
+        if (!is_input && !is_env) {
+            fprintf(stderr, "memo: unknown option '%s'\n", arg);
+            return memo_usage();
+        }
+        if (++i >= cmd->argc) return memo_usage();
+        if ((is_input ? input_count : env_count - 3) >= MEMO_MAX_DECL) {
+            fprintf(stderr, "memo: too many %s options (max %d)\n", arg, MEMO_MAX_DECL);
+            return 2;
+        }
+        if (is_input) {
+            inputs[input_count++] = cmd->argv[i];
+        } else {
+            env[env_count++] = cmd->argv[i];
+        }
+    }
+    if (i >= cmd->argc) return memo_usage();
+
+    char **argv = cmd->argv + i;
+    MemoBuffer key = {NULL, 0, 0};
+    char dir[PATH_MAX];
+    char path[PATH_MAX + 32] = "";
+    int cacheable = build_key(&key, argv, env, env_count, inputs, input_count) == 0 &&
+                    cache_dir("memo", dir, sizeof(dir)) == 0;
+
+    if (cacheable) {
+        snprintf(path, sizeof(path), "%s/%016llx", dir,
+                 (unsigned long long)hash_bytes(key.data, key.len, HASH_SEED));
+
+        int status;
+        if (memo_replay(path, &key, io, &status) == 0) {
+            count(&hit_count);
+            exec_event_emit(EXEC_EV_MEMO, 1, 0, 0, 0, 0, path + strlen(dir) + 1, argv[0]);
+            free(key.data);
+            return status;
+        }
+    }
+
+    count(&miss_count);
+    exec_event_emit(EXEC_EV_MEMO, 0, 0, 0, 0, 0, NULL, argv[0]);
+
+    MemoBuffer out = {NULL, 0, 0};
+    int storable = cacheable;
+    int status = memo_run(argv, io, &out, &storable);
+    if (storable) {
+        memo_store(path, &key, &out, status);
+    }
+
+    free(out.data);
+    free(key.data);
+    return status;
+}
@@ -0,0 +1,25 @@
+/*
+ * shelli - Educational Shell
+ * memo.h - Content-addressed command output cache
+ */
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "builtins.h"
+
+/* memo [-i input]... [-e VAR]... command [args...]
+ * Replays command's stored stdout and exit status if argv, the selected
+ * environment (PATH, LANG, LC_ALL and each -e VAR), the cwd and every -i
+ * input (inode, size, mtime) match a stored run; otherwise runs it and
+ * stores the result. The command gets no stdin. memo --clear empties
+ * the cache. */
+int builtin_memo(Command *cmd, BuiltinIO *io, int *should_exit);
+
+/* Get session counters (any pointer may be NULL) */
+void memo_stats(unsigned long *hits, unsigned long *misses, unsigned long *stores);
+
+/* Count the entries in the on-disk cache and their total size */
+void memo_disk_usage(int *entries, long long *bytes);
+
+#endif /* MEMO_H */
@@ -0,0 +1,283 @@
+/*
+ * shelli - Educational Shell
+ * outbuf.c - Captured output store with a line index
+ *
+ * Output is appended to one growable buffer until it passes
+ * OUTBUF_MEM_MAX. At that point the store spills: the bytes so far go to
+ * an unlinked temporary file, later appends are written after them, and
+ * reads go through a small mmap window. Lines are indexed as bytes
+ * arrive, but only every INDEX_STRIDE-th line start is recorded; a
+ * lookup starts from the nearest mark and skips the rest. Showing a few
+ * lines of a multi-gigabyte capture therefore needs only the marks and
+ * one window in memory.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* memmem() */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "outbuf.h"
+#include "fsutil.h"
+
+#define INDEX_STRIDE 64             /* Lines between index marks */
+#define WINDOW (1024 * 1024)        /* mmap granularity (a page multiple) */
+
+struct OutBuf {
+    char *mem;              /* Bytes, until spilled */
+    size_t mem_cap;
+    int fd;                 /* Unlinked temporary file once spilled, else -1 */
+    char *map;              /* Read window into the file */
+    uint64_t map_off;
+    size_t map_len;
+    uint64_t size;
+    uint64_t *marks;        /* marks[k]: offset of line k * INDEX_STRIDE */
+    size_t mark_count;
+    size_t mark_cap;
+    uint64_t newlines;
+    uint64_t last_start;    /* Offset just past the last newline */
+};
+
+OutBuf *outbuf_new(void) {
+    OutBuf *b = calloc(1, sizeof(OutBuf));
+    if (!b) return NULL;
+
+    b->fd = -1;
+    b->mark_cap = 64;
+    b->marks = malloc(b->mark_cap * sizeof(uint64_t));
+    if (!b->marks) {
+        free(b);
+        return NULL;
+    }
+    b->marks[0] = 0;
+    b->mark_count = 1;
+    return b;
+}
+
+static void drop_file(OutBuf *b) {
+    if (b->map) munmap(b->map, b->map_len);
+    b->map = NULL;
+    b->map_len = 0;
+    if (b->fd >= 0) close(b->fd);
+    b->fd = -1;
+}
+
+void outbuf_free(OutBuf *b) {
+    if (!b) return;
+    drop_file(b);
+    free(b->mem);
+    free(b->marks);
+    free(b);
+}
+
+void outbuf_reset(OutBuf *b) {
+    drop_file(b);
+    b->size = 0;
+    b->newlines = 0;
+    b->last_start = 0;
+    b->mark_count = 1;
+}
+
+/* Move the in-memory bytes to an unlinked temporary file */
+static int spill(OutBuf *b) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/shelli-out-XXXXXX", dir && dir[0] ? dir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (write_full(fd, b->mem, (size_t)b->size) < 0) {
+        close(fd);
+        return -1;
+    }
+    free(b->mem);
+    b->mem = NULL;
+    b->mem_cap = 0;
+    b->fd = fd;
+    return 0;
+}
+
+static int mark_push(OutBuf *b, uint64_t off) {
+    if (b->mark_count == b->mark_cap) {
+        uint64_t *marks = realloc(b->marks, b->mark_cap * 2 * sizeof(uint64_t));
+        if (!marks) return -1;
+        b->marks = marks;
+        b->mark_cap *= 2;
+    }
+    b->marks[b->mark_count++] = off;
+    return 0;
+}
+
+/* Index the newlines in bytes just stored at offset base */
+static int index_bytes(OutBuf *b, const char *data, size_t len, uint64_t base) {
+    const char *end = data + len;
+    for (const char *p = data; (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++) {
+        b->newlines++;
+        b->last_start = base + (uint64_t)(p - data) + 1;
+        if (b->newlines % INDEX_STRIDE == 0 && mark_push(b, b->last_start) < 0) return -1;
+    }
+    return 0;
+}
+
+int outbuf_append(OutBuf *b, const char *data, size_t len) {
+    if (len == 0) return 0;
+
+    if (b->fd < 0 && b->size + len > OUTBUF_MEM_MAX && spill(b) < 0) return -1;
+
+    if (b->fd >= 0) {
+        if (write_full(b->fd, data, len) < 0) return -1;
+    } else {
+        if (b->size + len > b->mem_cap) {
+            size_t cap = b->mem_cap ? b->mem_cap : 4096;
+            while (cap < b->size + len) cap *= 2;
+            char *mem = realloc(b->mem, cap);
+            if (!mem) return -1;
+            b->mem = mem;
+            b->mem_cap = cap;
+        }
+        memcpy(b->mem + b->size, data, len);
+    }
+
+    uint64_t base = b->size;
+    b->size += len;
+    return index_bytes(b, data, len, base);
+}
+
+int outbuf_puts(OutBuf *b, const char *s) {
+    return outbuf_append(b, s, strlen(s));
+}
+
+uint64_t outbuf_size(const OutBuf *b) {
+    return b->size;
+}
+
+uint64_t outbuf_line_count(const OutBuf *b) {
+    return b->newlines + (b->last_start < b->size ? 1 : 0);
+}
+
+int outbuf_at_line_start(const OutBuf *b) {
+    return b->last_start == b->size;
+}
+
+int outbuf_spilled(const OutBuf *b) {
+    return b->fd >= 0;
+}
+
+/*
+ * Get a pointer to up to want (at most WINDOW) bytes at off; *avail is
+ * how many are readable there. Spilled stores remap their window when
+ * the range falls outside it.
+ */
+static const char *view(OutBuf *b, uint64_t off, size_t want, size_t *avail) {
+    *avail = 0;
+    if (off >= b->size) return NULL;
+    if (want > WINDOW) want = WINDOW;
+    if (want > b->size - off) want = (size_t)(b->size - off);
+    if (b->fd < 0) {
+        *avail = want;
+        return b->mem + off;
+    }
+
+    if (!b->map || off < b->map_off || off + want > b->map_off + b->map_len) {
+        if (b->map) munmap(b->map, b->map_len);
+        b->map = NULL;
+
+        uint64_t start = off - off % WINDOW;
+        uint64_t len = b->size - start < 2 * WINDOW ? b->size - start : 2 * WINDOW;
+        void *m = mmap(NULL, (size_t)len, PROT_READ, MAP_SHARED, b->fd, (off_t)start);
+        if (m == MAP_FAILED) return NULL;
+        b->map = m;
+        b->map_off = start;
+        b->map_len = (size_t)len;
+    }
+    *avail = want;
+    return b->map + (off - b->map_off);
+}
+
+/* Offset of the newline ending the line at off (or the size) */
+static uint64_t line_end(OutBuf *b, uint64_t off) {
+    while (off < b->size) {
+        size_t avail;
+        const char *p = view(b, off, WINDOW, &avail);
+        if (!p) break;
+        const char *nl = memchr(p, '\n', avail);
+        if (nl) return off + (uint64_t)(nl - p);
+        off += avail;
+    }
+    return b->size;
+}
+
+static uint64_t line_start(OutBuf *b, uint64_t idx) {
+    uint64_t off = b->marks[idx / INDEX_STRIDE];
+    for (uint64_t k = idx % INDEX_STRIDE; k > 0; k--) {
+        off = line_end(b, off) + 1;
+    }
+    return off;
+}
+
+/* Index of the line holding byte pos */
+static uint64_t line_of(OutBuf *b, uint64_t pos) {
+    size_t lo = 0, hi = b->mark_count - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (b->marks[mid] <= pos) lo = mid;
+        else hi = mid - 1;
+    }
+
+    uint64_t idx = (uint64_t)lo * INDEX_STRIDE;
+    for (uint64_t off = b->marks[lo]; ; idx++) {
+        uint64_t end = line_end(b, off);
+        if (end >= pos) return idx;
+        off = end + 1;
+    }
+}
+
+const char *outbuf_line(OutBuf *b, uint64_t idx, size_t *len) {
+    *len = 0;
+    if (idx >= outbuf_line_count(b)) return NULL;
+
+    size_t avail;
+    const char *p = view(b, line_start(b, idx), OUTBUF_LINE_MAX, &avail);
+    if (!p) return "";
+    const char *nl = memchr(p, '\n', avail);
+    *len = nl ? (size_t)(nl - p) : avail;
+    return p;
+}
+
+int outbuf_line_span(OutBuf *b, uint64_t idx, uint64_t *off, uint64_t *len) {
+    if (idx >= outbuf_line_count(b)) return -1;
+    *off = line_start(b, idx);
+    *len = line_end(b, *off) - *off;
+    return 0;
+}
+
+const char *outbuf_read(OutBuf *b, uint64_t off, size_t want, size_t *avail) {
+    return view(b, off, want, avail);
+}
+
+int64_t outbuf_find(OutBuf *b, const char *needle, uint64_t from) {
+    size_t n = strlen(needle);
+    if (n == 0 || n > WINDOW / 2 || from >= outbuf_line_count(b)) return -1;
+
+    /* Scan window by window, overlapping so no match straddles a seam */
+    for (uint64_t off = line_start(b, from); off < b->size; ) {
+        size_t avail;
+        const char *p = view(b, off, WINDOW, &avail);
+        if (!p || avail < n) break;
+
+        const char *hit = memmem(p, avail, needle, n);
+        if (hit) return (int64_t)line_of(b, off + (uint64_t)(hit - p));
+        if (off + avail >= b->size) break;
+        off += avail - (n - 1);
+    }
+    return -1;
+}
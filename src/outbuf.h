@@ -0,0 +1,64 @@
+/*
+ * shelli - Educational Shell
+ * outbuf.h - Captured output store with a line index
+ */
+
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes kept in memory before the store spills to a temporary file */
+#define OUTBUF_MEM_MAX (8 * 1024 * 1024)
+
+/* Longest line prefix returned by outbuf_line */
+#define OUTBUF_LINE_MAX 4096
+
+typedef struct OutBuf OutBuf;
+
+/* Create an empty store, NULL on allocation failure */
+OutBuf *outbuf_new(void);
+
+/* Free a store and its temporary file */
+void outbuf_free(OutBuf *b);
+
+/* Empty the store (drops any temporary file) */
+void outbuf_reset(OutBuf *b);
+
+/* Append bytes, indexing lines as they arrive; returns 0 or -1 */
+int outbuf_append(OutBuf *b, const char *data, size_t len);
+
+/* Append a NUL-terminated string */
+int outbuf_puts(OutBuf *b, const char *s);
+
+/* Total bytes stored */
+uint64_t outbuf_size(const OutBuf *b);
+
+/* Number of lines (a final line without '\n' counts) */
+uint64_t outbuf_line_count(const OutBuf *b);
+
+/* Check whether the store is empty or ends with a newline */
+int outbuf_at_line_start(const OutBuf *b);
+
+/* Check whether the store has spilled to disk */
+int outbuf_spilled(const OutBuf *b);
+
+/* Get up to OUTBUF_LINE_MAX bytes of line idx, without its newline.
+ * Valid until the next call on b; NULL if idx is out of range. */
+const char *outbuf_line(OutBuf *b, uint64_t idx, size_t *len);
+
+/* Get where line idx starts and its whole length, without its newline.
+ * Returns 0, or -1 if idx is out of range. */
+int outbuf_line_span(OutBuf *b, uint64_t idx, uint64_t *off, uint64_t *len);
+
+/* Get a pointer to up to want bytes at off; *avail is how many can be
+ * read there (fewer than want near a window edge: read on from off +
+ * *avail). Valid until the next call on b; NULL past the end. */
+const char *outbuf_read(OutBuf *b, uint64_t off, size_t want, size_t *avail);
+
+/* Find the first line at or after from that contains needle,
+ * returns its index or -1 */
+int64_t outbuf_find(OutBuf *b, const char *needle, uint64_t from);
+
+#endif /* OUTBUF_H */
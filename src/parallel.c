@@ -0,0 +1,459 @@
+/*
+ * shelli - Educational Shell
+ * parallel.c - Parallel job runner (the parallel builtin)
+ *
+ * Runs a command template once per work item with up to N jobs at a
+ * time. Every job's stdout and stderr go into its own pipes and are
+ * buffered, then written out whole in input order, so output never
+ * interleaves. Job n is only started while it is within a window of 2N
+ * jobs of the oldest unwritten one, which bounds the buffered output
+ * when an early job is slow.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "parallel.h"
+#include "executor.h"
+#include "execevent.h"
+
+#define PARALLEL_MAX_JOBS    1024  /* Each job holds two pipes */
+#define PARALLEL_FAIL_CAP    101   /* Exit status caps the failure count here */
+#define PARALLEL_PROGRESS_MS 50    /* Minimum interval between progress reports */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} JobBuffer;
+
+/* One job slot; job n lives in slot n % window */
+typedef struct {
+    pid_t pid;          /* -1 if the job could not be started */
+    int out_fd;         /* Read ends, -1 at EOF */
+    int err_fd;
+    JobBuffer out;
+    JobBuffer err;
+    int finished;       /* Both pipes at EOF and the child reaped */
+    int status;
+    double start_ms;
+    char name[64];      /* argv[0], for the exit event */
+} Job;
+
+/* Work items: the words after :::, or lines of stdin */
+typedef struct {
+    char **words;
+    int count;
+    int next;
+    int fd;             /* -1 when reading words */
+    char buf[4096];
+    size_t pos;
+    size_t end;
+    int eof;
+    char *line;
+    size_t line_cap;
+} ItemSource;
+
+static double parallel_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int buffer_append(JobBuffer *b, const char *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + len) cap *= 2;
+        char *p = realloc(b->data, cap);
+        if (!p) return -1;
+        b->data = p;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static int line_push(ItemSource *src, size_t len, char c) {
+    if (len + 2 > src->line_cap) {
+        size_t cap = src->line_cap ? src->line_cap * 2 : 256;
+        char *p = realloc(src->line, cap);
+        if (!p) return -1;
+        src->line = p;
+        src->line_cap = cap;
+    }
+    src->line[len] = c;
+    return 0;
+}
+
+/*
+ * Get the next work item, NULL when there are no more. Lines are read
+ * as they are needed, so items can stream in while jobs run. Blank
+ * lines are skipped.
+ */
+static const char *next_item(ItemSource *src) {
+    if (src->fd < 0) {
+        return src->next < src->count ? src->words[src->next++] : NULL;
+    }
+
+    size_t len = 0;
+    for (;;) {
+        if (src->pos == src->end) {
+            if (src->eof) break;
+            ssize_t n = read(src->fd, src->buf, sizeof(src->buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                if (n < 0) perror("parallel: read");
+                src->eof = 1;
+                break;
+            }
+            src->pos = 0;
+            src->end = (size_t)n;
+        }
+
+        char c = src->buf[src->pos++];
+        if (c == '\n') {
+            if (len > 0) break;
+            continue;
+        }
+        if (line_push(src, len, c) < 0) return NULL;
+        len++;
+    }
+
+    if (len == 0) return NULL;
+    src->line[len] = '\0';
+    return src->line;
+}
+
+/* Copy arg with every {} replaced by item */
+static char *substitute(const char *arg, const char *item) {
+    size_t item_len = strlen(item);
+    size_t len = 0;
+    for (const char *p = arg; *p; p++) {
+        if (p[0] == '{' && p[1] == '}') {
+            len += item_len;
+            p++;
+        } else {
+            len++;
+        }
+    }
+
+    char *out = malloc(len + 1);
+    if (!out) return NULL;
+
+    char *o = out;
+    for (const char *p = arg; *p; p++) {
+        if (p[0] == '{' && p[1] == '}') {
+            memcpy(o, item, item_len);
+            o += item_len;
+            p++;
+        } else {
+            *o++ = *p;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+static void free_argv(char **argv) {
+    for (int i = 0; argv[i]; i++) {
+        free(argv[i]);
+    }
+    free(argv);
+}
+
+/*
+ * Build a job's argv from the template: {} in any word is replaced by
+ * the item, or the item is appended if no word has a {}
+ */
+static char **job_argv(char **tmpl, int count, int placeholder, const char *item) {
+    char **argv = calloc(count + 2, sizeof(char *));
+    if (!argv) return NULL;
+
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        argv[n] = substitute(tmpl[i], placeholder ? item : "");
+        if (!argv[n]) goto fail;
+        n++;
+    }
+    if (!placeholder) {
+        argv[n] = strdup(item);
+        if (!argv[n]) goto fail;
+    }
+    return argv;
+
+fail:
+    free_argv(argv);
+    return NULL;
+}
+
+static void job_start(Job *job, char **argv, int null_fd) {
+    Command cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.argv = argv;
+    while (argv[cmd.argc]) cmd.argc++;
+
+    memset(job, 0, sizeof(*job));
+    job->out_fd = job->err_fd = -1;
+    job->start_ms = parallel_now_ms();
+    snprintf(job->name, sizeof(job->name), "%s", argv[0]);
+    job->pid = executor_spawn_job(&cmd, null_fd, &job->out_fd, &job->err_fd);
+    if (job->pid < 0) {
+        fprintf(stderr, "parallel: %s: cannot start job\n", argv[0]);
+        job->finished = 1;
+        job->status = 127;
+    }
+}
+
+/* Read what is available on one of a job's pipes; reap it after both EOFs */
+static void job_read(Job *job, int *fd, JobBuffer *into) {
+    char buf[16384];
+    ssize_t n = read(*fd, buf, sizeof(buf));
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+
+    if (n > 0 && buffer_append(into, buf, (size_t)n) == 0) return;
+    if (n > 0) perror("parallel");
+
+    close(*fd);
+    *fd = -1;
+    if (job->out_fd >= 0 || job->err_fd >= 0) return;
+
+    int wstatus;
+    pid_t r;
+    while ((r = waitpid(job->pid, &wstatus, 0)) < 0 && errno == EINTR) {
+    }
+    job->status = r < 0 ? 1 :
+                  WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) :
+                  WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : 1;
+    job->finished = 1;
+    exec_event_emit(EXEC_EV_EXIT, 0, job->pid, job->status, 0,
+                    parallel_now_ms() - job->start_ms, job->name, NULL);
+}
+
+/* Write a finished job's output, returns -1 if stdout went away */
+static int job_flush(Job *job, BuiltinIO *io) {
+    int rc = 0;
+    if (job->out.len > 0 && builtin_io_write(io, job->out.data, job->out.len) < 0) {
+        rc = -1;
+    }
+    for (size_t off = 0; off < job->err.len; ) {
+        ssize_t w = write(STDERR_FILENO, job->err.data + off, job->err.len - off);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        off += (size_t)w;
+    }
+    free(job->out.data);
+    free(job->err.data);
+    job->out.data = job->err.data = NULL;
+    return rc;
+}
+
+/* Stop the jobs still running and drop unwritten output */
+static void jobs_abort(Job *slots, int window, long first, long end) {
+    for (long seq = first; seq < end; seq++) {
+        Job *job = &slots[seq % window];
+        if (!job->finished) kill(job->pid, SIGTERM);
+        while (!job->finished) {
+            job_read(job, job->out_fd >= 0 ? &job->out_fd : &job->err_fd,
+                     job->out_fd >= 0 ? &job->out : &job->err);
+        }
+        free(job->out.data);
+        free(job->err.data);
+    }
+}
+
+static int default_jobs(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static int parallel_usage(void) {
+    fprintf(stderr, "usage: parallel [-j jobs] command [args...] [::: items...]\n");
+    return 2;
+}
+
+int builtin_parallel(Command *cmd, BuiltinIO *io, int *should_exit) {
+    (void)should_exit;
+    int jobs = default_jobs();
+    int i = 1;
+
+    /* Options */
+    for (; i < cmd->argc && cmd->argv[i][0] == '-'; i++) {
+        const char *arg = cmd->argv[i];
+        const char *value = NULL;
+
+        if (strcmp(arg, "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--jobs") == 0) {
+            if (++i >= cmd->argc) return parallel_usage();
+            value = cmd->argv[i];
+        } else if (strncmp(arg, "-j", 2) == 0) {
+            value = arg + 2;
+        } else {
+            fprintf(stderr, "parallel: unknown option '%s'\n", arg);
+            return parallel_usage();
+        }
+
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (*value == '\0' || *end != '\0' || n < 1 || n > PARALLEL_MAX_JOBS) {
+            fprintf(stderr, "parallel: invalid job count '%s' (1-%d)\n", value, PARALLEL_MAX_JOBS);
+            return 2;
+        }
+        jobs = (int)n;
+    }
+
+    /* Template up to :::, items after it */
+    char **tmpl = cmd->argv + i;
+    int tmpl_count = 0;
+    while (i + tmpl_count < cmd->argc && strcmp(tmpl[tmpl_count], ":::") != 0) {
+        tmpl_count++;
+    }
+    if (tmpl_count == 0) return parallel_usage();
+
+    ItemSource src;
+    memset(&src, 0, sizeof(src));
+    src.fd = io->in_fd;
+    long total = 0;  /* 0 while items are still streaming in */
+    if (i + tmpl_count < cmd->argc) {
+        src.fd = -1;
+        src.words = tmpl + tmpl_count + 1;
+        src.count = cmd->argc - (i + tmpl_count + 1);
+        total = src.count;
+    } else if (isatty(src.fd)) {
+        /* Alone at the prompt stdin is the (raw mode) terminal */
+        fprintf(stderr, "parallel: no items: pipe them in or list them after :::\n");
+        return 2;
+    }
+
+    int placeholder = 0;
+    for (int k = 0; k < tmpl_count; k++) {
+        if (strstr(tmpl[k], "{}")) placeholder = 1;
+    }
+
+    int window = jobs * 2;
+    Job *slots = calloc(window, sizeof(Job));
+    struct pollfd *fds = malloc(2 * jobs * sizeof(struct pollfd));
+    Job **owner = malloc(2 * jobs * sizeof(Job *));
+    int null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (!slots || !fds || !owner || null_fd < 0) {
+        perror("parallel");
+        free(slots);
+        free(fds);
+        free(owner);
+        if (null_fd >= 0) close(null_fd);
+        free(src.line);
+        return 1;
+    }
+
+    long started = 0;   /* Jobs [flushed, started) occupy slots */
+    long flushed = 0;
+    int running = 0;
+    int input_done = 0;
+    int broken = 0;
+    long failed = 0;
+    double last_report = 0;
+
+    for (;;) {
+        /* Fill free workers, staying within the window */
+        while (!input_done && running < jobs && started - flushed < window) {
+            const char *item = next_item(&src);
+            if (!item) {
+                input_done = 1;
+                if (total == 0) total = started;
+                break;
+            }
+
+            Job *job = &slots[started % window];
+            char **argv = job_argv(tmpl, tmpl_count, placeholder, item);
+            if (!argv) {
+                memset(job, 0, sizeof(*job));
+                perror("parallel");
+                job->finished = 1;
+                job->status = 1;
+            } else {
+                job_start(job, argv, null_fd);
+                free_argv(argv);
+            }
+            if (!job->finished) running++;
+            started++;
+        }
+
+        /* Write finished jobs in input order */
+        while (flushed < started && slots[flushed % window].finished) {
+            Job *job = &slots[flushed % window];
+            if (job->status != 0) failed++;
+            if (job_flush(job, io) < 0) broken = 1;
+            flushed++;
+
+            double now = parallel_now_ms();
+            if (now - last_report >= PARALLEL_PROGRESS_MS) {
+                executor_progress("parallel", flushed, total);
+                last_report = now;
+            }
+            if (broken) break;
+        }
+
+        if (broken) {
+            jobs_abort(slots, window, flushed, started);
+            break;
+        }
+        if (input_done && flushed == started) break;
+
+        /* Wait for output from the running jobs */
+        int nfds = 0;
+        for (long seq = flushed; seq < started; seq++) {
+            Job *job = &slots[seq % window];
+            if (job->out_fd >= 0) {
+                fds[nfds].fd = job->out_fd;
+                fds[nfds].events = POLLIN;
+                owner[nfds++] = job;
+            }
+            if (job->err_fd >= 0) {
+                fds[nfds].fd = job->err_fd;
+                fds[nfds].events = POLLIN;
+                owner[nfds++] = job;
+            }
+        }
+        if (nfds == 0) continue;
+
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("parallel: poll");
+            jobs_abort(slots, window, flushed, started);
+            failed++;
+            break;
+        }
+
+        for (int k = 0; k < nfds; k++) {
+            if (!fds[k].revents) continue;
+            Job *job = owner[k];
+            int was_finished = job->finished;
+            if (fds[k].fd == job->out_fd) {
+                job_read(job, &job->out_fd, &job->out);
+            } else if (fds[k].fd == job->err_fd) {
+                job_read(job, &job->err_fd, &job->err);
+            }
+            if (job->finished && !was_finished) running--;
+        }
+    }
+
+    executor_progress("parallel", flushed, total ? total : flushed);
+
+    close(null_fd);
+    free(src.line);
+    free(slots);
+    free(fds);
+    free(owner);
+
+    if (broken) return 1;
+    return failed > PARALLEL_FAIL_CAP ? PARALLEL_FAIL_CAP : (int)failed;
+}
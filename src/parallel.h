@@ -0,0 +1,17 @@
+/*
+ * shelli - Educational Shell
+ * parallel.h - Parallel job runner
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "builtins.h"
+
+/* parallel [-j jobs] command [args...] [::: items...]
+ * Runs command once per item (stdin lines without :::), {} in an
+ * argument is replaced by the item, otherwise it is appended. Output is
+ * written per job in input order. Returns the number of failed jobs. */
+int builtin_parallel(Command *cmd, BuiltinIO *io, int *should_exit);
+
+#endif /* PARALLEL_H */
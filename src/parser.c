@@ -7,8 +7,11 @@
 #include <string.h>
 #include <stdio.h>
 #include "parser.h"
+#include "builtins.h"
+#include "glob.h"
 
-#define MAX_ARGS 256
+#define INITIAL_ARGS 256    /* argv slots to start with (power of two) */
+#define MAX_ARGS     65535  /* Fits the bytecode argc field */
 
 const char *redirect_type_str(int type) {
     switch (type) {
@@ -16,14 +19,36 @@ const char *redirect_type_str(int type) {
         case REDIR_IN:     return "<";
         case REDIR_OUT:    return ">";
         case REDIR_APPEND: return ">>";
+        case REDIR_HEREDOC: return "<<";
         default:           return "?";
     }
 }
 
+const char *list_op_str(int op) {
+    switch (op) {
+        case LIST_END: return "end";
+        case LIST_SEQ: return ";";
+        case LIST_AND: return "&&";
+        case LIST_OR:  return "||";
+        default:       return "?";
+    }
+}
+
+/* A here-string feeds its word plus a newline */
+static char *herestring_body(const char *word) {
+    size_t len = strlen(word);
+    char *body = malloc(len + 2);
+    if (!body) return NULL;
+    memcpy(body, word, len);
+    body[len] = '\n';
+    body[len + 1] = '\0';
+    return body;
+}
+
 static Command *command_new(void) {
     Command *cmd = calloc(1, sizeof(Command));
     if (!cmd) return NULL;
-    cmd->argv = calloc(MAX_ARGS + 1, sizeof(char *));
+    cmd->argv = calloc(INITIAL_ARGS + 1, sizeof(char *));
     if (!cmd->argv) {
         free(cmd);
         return NULL;
@@ -53,8 +78,27 @@ void pipeline_free(Pipeline *pipeline) {
     free(pipeline);
 }
 
+/*
+ * Finish a command: shrink argv from its spare slots to exactly argc + 1,
+ * so long-lived (cached) plans don't carry the spare slots, and resolve
+ * the builtin once so execution never looks the name up again
+ */
+static void command_finish(Command *cmd) {
+    char **argv = realloc(cmd->argv, (cmd->argc + 1) * sizeof(char *));
+    if (argv) cmd->argv = argv;
+    cmd->builtin = builtin_lookup(cmd->argv[0]);
+}
+
 static int command_add_arg(Command *cmd, const char *arg) {
     if (cmd->argc >= MAX_ARGS) return -1;
+
+    /* Slots run out at INITIAL_ARGS and each power of two after it */
+    if (cmd->argc >= INITIAL_ARGS && (cmd->argc & (cmd->argc - 1)) == 0) {
+        char **argv = realloc(cmd->argv, (2 * cmd->argc + 1) * sizeof(char *));
+        if (!argv) return -1;
+        cmd->argv = argv;
+    }
+
     cmd->argv[cmd->argc] = strdup(arg);
     if (!cmd->argv[cmd->argc]) return -1;
     cmd->argc++;
@@ -62,35 +106,107 @@ static int command_add_arg(Command *cmd, const char *arg) {
     return 0;
 }
 
-Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
+int parse_pipe_size(const char *text, int *size) {
+    if (strcmp(text, "auto") == 0) {
+        *size = PIPE_SIZE_AUTO;
+        return 0;
+    }
+    if (strcmp(text, "default") == 0) {
+        *size = PIPE_SIZE_DEFAULT;
+        return 0;
+    }
+
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value <= 0) return -1;
+    if (*end == 'k' || *end == 'K') {
+        value *= 1024;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        value *= 1024 * 1024;
+        end++;
+    }
+    if (*end || value > (1L << 30)) return -1;
+
+    *size = (int)value;
+    return 0;
+}
+
+/*
+ * Check whether a token separates pipelines in a list
+ */
+static int is_list_op(TokenType type) {
+    return type == TOK_SEMI || type == TOK_AND || type == TOK_OR;
+}
+
+/*
+ * Keep the tokens [start, end) of a list entry that has words to expand
+ */
+static int entry_keep_words(ListEntry *entry, const TokenList *tokens, int start, int end) {
+    TokenList slice = {tokens->tokens + start, end - start, end - start};
+    if (!tokenlist_is_dynamic(&slice)) return 0;
+
+    entry->words = malloc(sizeof(TokenList));
+    if (!entry->words) return -1;
+    if (tokenlist_copy(tokens, start, end, entry->words) < 0) {
+        free(entry->words);
+        entry->words = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Parse one pipeline starting at *pos, stopping at a list operator or EOF.
+ * Returns 0 on success (*out is NULL for an empty pipeline), -1 on error.
+ */
+static int parse_pipeline(TokenList *tokens, int *pos, Pipeline **out,
+                          char *error, int error_size) {
+    *out = NULL;
+
     Pipeline *pipeline = calloc(1, sizeof(Pipeline));
     if (!pipeline) {
         snprintf(error, error_size, "Memory allocation failed");
-        return NULL;
+        return -1;
     }
 
     Command *current = NULL;
     Command *last = NULL;
-    int i = 0;
+    int i = *pos;
     int expecting_filename = 0;
     int redirect_type = 0;
+    int here_string = 0;
+    int has_prefix = 0;
 
-    while (i < tokens->count && tokens->tokens[i].type != TOK_EOF) {
+    while (i < tokens->count && tokens->tokens[i].type != TOK_EOF &&
+           !is_list_op(tokens->tokens[i].type)) {
         Token *tok = &tokens->tokens[i];
 
         switch (tok->type) {
         case TOK_WORD:
             if (expecting_filename) {
                 /* This word is a redirect filename */
-                if (redirect_type == REDIR_IN) {
-                    current->redir_in.type = REDIR_IN;
-                    current->redir_in.filename = strdup(tok->value);
+                if (redirect_type == REDIR_IN || redirect_type == REDIR_HEREDOC) {
+                    free(current->redir_in.filename);
+                    current->redir_in.type = redirect_type;
+                    current->redir_in.filename = here_string ? herestring_body(tok->value)
+                                                             : strdup(tok->value);
                 } else {
                     current->redir_out.type = redirect_type;
                     current->redir_out.filename = strdup(tok->value);
                 }
                 expecting_filename = 0;
                 redirect_type = 0;
+                here_string = 0;
+            } else if (!pipeline->first && !current &&
+                       strncmp(tok->value, "PIPESIZE=", 9) == 0) {
+                /* Per-pipeline pipe buffer size prefix */
+                if (parse_pipe_size(tok->value + 9, &pipeline->pipe_size) < 0) {
+                    snprintf(error, error_size, "Invalid pipe size '%s'", tok->value + 9);
+                    pipeline_free(pipeline);
+                    return -1;
+                }
+                has_prefix = 1;
             } else {
                 /* Regular argument */
                 if (!current) {
@@ -98,7 +214,7 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
                     if (!current) {
                         snprintf(error, error_size, "Memory allocation failed");
                         pipeline_free(pipeline);
-                        return NULL;
+                        return -1;
                     }
                     if (!pipeline->first) {
                         pipeline->first = current;
@@ -111,7 +227,7 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
                 if (command_add_arg(current, tok->value) < 0) {
                     snprintf(error, error_size, "Too many arguments");
                     pipeline_free(pipeline);
-                    return NULL;
+                    return -1;
                 }
             }
             break;
@@ -120,12 +236,12 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
             if (!current || current->argc == 0) {
                 snprintf(error, error_size, "Syntax error: unexpected '|'");
                 pipeline_free(pipeline);
-                return NULL;
+                return -1;
             }
             if (expecting_filename) {
                 snprintf(error, error_size, "Syntax error: missing filename after redirect");
                 pipeline_free(pipeline);
-                return NULL;
+                return -1;
             }
             last = current;
             current = NULL;
@@ -135,7 +251,7 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
             if (!current) {
                 snprintf(error, error_size, "Syntax error: redirect without command");
                 pipeline_free(pipeline);
-                return NULL;
+                return -1;
             }
             expecting_filename = 1;
             redirect_type = REDIR_IN;
@@ -145,7 +261,7 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
             if (!current) {
                 snprintf(error, error_size, "Syntax error: redirect without command");
                 pipeline_free(pipeline);
-                return NULL;
+                return -1;
             }
             expecting_filename = 1;
             redirect_type = REDIR_OUT;
@@ -155,29 +271,209 @@ Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
             if (!current) {
                 snprintf(error, error_size, "Syntax error: redirect without command");
                 pipeline_free(pipeline);
-                return NULL;
+                return -1;
             }
             expecting_filename = 1;
             redirect_type = REDIR_APPEND;
             break;
 
+        case TOK_HEREDOC:
+        case TOK_HEREDOC_TAB:
+        case TOK_HERESTRING:
+            if (!current) {
+                snprintf(error, error_size, "Syntax error: redirect without command");
+                pipeline_free(pipeline);
+                return -1;
+            }
+            expecting_filename = 1;
+            redirect_type = REDIR_HEREDOC;
+            here_string = tok->type == TOK_HERESTRING;
+            break;
+
+        case TOK_SEMI:
+        case TOK_AND:
+        case TOK_OR:
         case TOK_EOF:
             break;
         }
         i++;
     }
 
+    *pos = i;
+
     if (expecting_filename) {
         snprintf(error, error_size, "Syntax error: missing filename after redirect");
         pipeline_free(pipeline);
-        return NULL;
+        return -1;
+    }
+
+    if (last && !current) {
+        snprintf(error, error_size, "Syntax error: missing command after '|'");
+        pipeline_free(pipeline);
+        return -1;
     }
 
     if (pipeline->cmd_count == 0) {
-        /* Empty input is valid */
+        if (has_prefix) {
+            snprintf(error, error_size, "Syntax error: PIPESIZE= without command");
+            pipeline_free(pipeline);
+            return -1;
+        }
+        /* Empty pipeline */
         free(pipeline);
+        return 0;
+    }
+
+    for (Command *cmd = pipeline->first; cmd; cmd = cmd->next) {
+        command_finish(cmd);
+    }
+
+    *out = pipeline;
+    return 0;
+}
+
+Pipeline *parser_parse(TokenList *tokens, char *error, int error_size) {
+    Pipeline *pipeline = NULL;
+    int pos = 0;
+
+    if (parse_pipeline(tokens, &pos, &pipeline, error, error_size) < 0) {
+        return NULL;
+    }
+
+    if (pos < tokens->count && is_list_op(tokens->tokens[pos].type)) {
+        snprintf(error, error_size, "Syntax error: unexpected '%s'",
+                 tokens->tokens[pos].value);
+        pipeline_free(pipeline);
+        return NULL;
+    }
+
+    /* Empty input is valid (returns NULL with no error) */
+    return pipeline;
+}
+
+Pipeline *parser_expand_entry(const ListEntry *entry, char *error, int error_size) {
+    error[0] = '\0';
+    if (!entry->words) return entry->pipeline;
+
+    TokenList tokens;
+    if (tokenlist_copy(entry->words, 0, entry->words->count - 1, &tokens) < 0 ||
+        lexer_expand(&tokens) < 0) {
+        snprintf(error, error_size, "Memory allocation failed");
+        tokenlist_free(&tokens);
+        return NULL;
+    }
+    if (glob_expand_tokens(&tokens) < 0) {
+        snprintf(error, error_size, "glob expansion failed");
+        tokenlist_free(&tokens);
         return NULL;
     }
 
+    Pipeline *pipeline = parser_parse(&tokens, error, error_size);
+    tokenlist_free(&tokens);
     return pipeline;
 }
+
+void commandlist_free(CommandList *list) {
+    if (!list) return;
+    for (int i = 0; i < list->count; i++) {
+        pipeline_free(list->entries[i].pipeline);
+        if (list->entries[i].words) {
+            tokenlist_free(list->entries[i].words);
+            free(list->entries[i].words);
+        }
+    }
+    free(list->entries);
+    free(list);
+}
+
+static int commandlist_add(CommandList *list, Pipeline *pipeline) {
+    if (list->count >= list->capacity) {
+        int new_cap = list->capacity == 0 ? 4 : list->capacity * 2;
+        ListEntry *entries = realloc(list->entries, new_cap * sizeof(ListEntry));
+        if (!entries) return -1;
+        list->entries = entries;
+        list->capacity = new_cap;
+    }
+    list->entries[list->count].pipeline = pipeline;
+    list->entries[list->count].op = LIST_END;
+    list->entries[list->count].words = NULL;
+    list->count++;
+    return 0;
+}
+
+static int list_op_from_token(TokenType type) {
+    switch (type) {
+        case TOK_SEMI: return LIST_SEQ;
+        case TOK_AND:  return LIST_AND;
+        case TOK_OR:   return LIST_OR;
+        default:       return LIST_END;
+    }
+}
+
+CommandList *parser_parse_list(TokenList *tokens, char *error, int error_size) {
+    CommandList *list = calloc(1, sizeof(CommandList));
+    if (!list) {
+        snprintf(error, error_size, "Memory allocation failed");
+        return NULL;
+    }
+
+    int pos = 0;
+    int pending_op = LIST_END;
+
+    while (1) {
+        Pipeline *pipeline = NULL;
+        int start = pos;
+        if (parse_pipeline(tokens, &pos, &pipeline, error, error_size) < 0) {
+            commandlist_free(list);
+            return NULL;
+        }
+
+        int at_end = pos >= tokens->count || tokens->tokens[pos].type == TOK_EOF;
+
+        if (!pipeline) {
+            /* A trailing ';' is allowed, anything else needs a command */
+            if (at_end && (list->count == 0 || pending_op == LIST_SEQ)) {
+                break;
+            }
+            if (at_end) {
+                snprintf(error, error_size, "Syntax error: missing command after '%s'",
+                         list_op_str(pending_op));
+            } else {
+                snprintf(error, error_size, "Syntax error: unexpected '%s'",
+                         tokens->tokens[pos].value);
+            }
+            commandlist_free(list);
+            return NULL;
+        }
+
+        if (commandlist_add(list, pipeline) < 0) {
+            snprintf(error, error_size, "Memory allocation failed");
+            pipeline_free(pipeline);
+            commandlist_free(list);
+            return NULL;
+        }
+        if (entry_keep_words(&list->entries[list->count - 1], tokens, start, pos) < 0) {
+            snprintf(error, error_size, "Memory allocation failed");
+            commandlist_free(list);
+            return NULL;
+        }
+
+        if (at_end) break;
+
+        /* Record the connector on the entry it follows */
+        pending_op = list_op_from_token(tokens->tokens[pos].type);
+        list->entries[list->count - 1].op = pending_op;
+        pos++;
+    }
+
+    if (list->count == 0) {
+        /* Empty input is valid */
+        commandlist_free(list);
+        return NULL;
+    }
+
+    /* A trailing ';' does not connect to anything */
+    list->entries[list->count - 1].op = LIST_END;
+
+    return list;
+}
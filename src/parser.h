@@ -13,32 +13,80 @@
 #define REDIR_IN     1  /* < */
 #define REDIR_OUT    2  /* > */
 #define REDIR_APPEND 3  /* >> */
+#define REDIR_HEREDOC 4 /* <<, <<- and <<< (filename holds the body) */
 
 typedef struct {
-    int type;           /* REDIR_NONE, REDIR_IN, REDIR_OUT, REDIR_APPEND */
+    int type;           /* REDIR_NONE, REDIR_IN, REDIR_OUT, REDIR_APPEND, REDIR_HEREDOC */
     char *filename;     /* Dynamically allocated */
 } Redirect;
 
+struct Builtin;
+
 typedef struct Command {
     char **argv;        /* NULL-terminated argument array */
     int argc;
+    const struct Builtin *builtin; /* Resolved at parse time, NULL if external */
     Redirect redir_in;  /* Input redirection */
     Redirect redir_out; /* Output redirection */
     struct Command *next; /* Next command in pipeline */
 } Command;
 
+/* Pipe buffer sizes (positive values are bytes) */
+#define PIPE_SIZE_DEFAULT  0   /* Use the session setting */
+#define PIPE_SIZE_AUTO    -1   /* Grow pipes whose writer is seen blocking */
+
 typedef struct {
     Command *first;     /* Head of pipeline linked list */
     int cmd_count;      /* Number of commands in pipeline */
+    int pipe_size;      /* From a PIPESIZE= prefix, PIPE_SIZE_DEFAULT if none */
 } Pipeline;
 
+/* List connectors (how an entry is joined to the one after it) */
+#define LIST_END  0  /* Last entry in the list */
+#define LIST_SEQ  1  /* ; */
+#define LIST_AND  2  /* && */
+#define LIST_OR   3  /* || */
+
+typedef struct {
+    Pipeline *pipeline; /* As written (variable references unexpanded) */
+    int op;             /* LIST_END, LIST_SEQ, LIST_AND, LIST_OR */
+    TokenList *words;   /* The entry's tokens if it has variables or globs
+                           to expand when it runs, else NULL */
+} ListEntry;
+
+typedef struct {
+    ListEntry *entries; /* Flat array of pipelines, in execution order */
+    int count;
+    int capacity;
+} CommandList;
+
 /* Parse tokens into a pipeline, returns NULL on error */
 Pipeline *parser_parse(TokenList *tokens, char *error, int error_size);
 
+/* Parse tokens into a command list (pipelines joined by ; && ||),
+ * returns NULL on error or empty input (error is empty then) */
+CommandList *parser_parse_list(TokenList *tokens, char *error, int error_size);
+
+/* Get the pipeline to run for a list entry: its own, or for an entry with
+ * words, a new one parsed after expanding them (the caller frees it).
+ * Returns NULL on error or if the entry expands to nothing (error is
+ * empty then). */
+Pipeline *parser_expand_entry(const ListEntry *entry, char *error, int error_size);
+
 /* Free a pipeline and all its commands */
 void pipeline_free(Pipeline *pipeline);
 
+/* Free a command list and all its pipelines */
+void commandlist_free(CommandList *list);
+
+/* Parse a pipe size: bytes with optional k/m suffix, "auto" or "default".
+ * Returns 0 on success, -1 if the text is not a valid size. */
+int parse_pipe_size(const char *text, int *size);
+
 /* Get string representation of redirect type */
 const char *redirect_type_str(int type);
 
+/* Get string representation of list connector */
+const char *list_op_str(int op);
+
 #endif /* PARSER_H */
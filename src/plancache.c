@@ -0,0 +1,131 @@
+/*
+ * shelli - Educational Shell
+ * plancache.c - LRU cache of parsed command lists keyed by input line
+ *
+ * Lines are hashed with FNV-1a (hash.c) into a chained hash table. Every
+ * entry is also on a doubly linked recency list, so a hit moves it to the
+ * front and an insert into a full cache evicts from the back, both in O(1).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "plancache.h"
+#include "hash.h"
+
+#define BUCKET_COUNT 128  /* Power of two, about 2x capacity */
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    char *line;                 /* Key, compared on hash match */
+    CommandList *list;          /* Owned, read-only plan */
+    struct CacheEntry *chain;   /* Next entry in the same bucket */
+    struct CacheEntry *prev;    /* More recently used */
+    struct CacheEntry *next;    /* Less recently used */
+} CacheEntry;
+
+static CacheEntry *buckets[BUCKET_COUNT];
+static CacheEntry *lru_head = NULL;  /* Most recently used */
+static CacheEntry *lru_tail = NULL;  /* Least recently used */
+static int entry_count = 0;
+
+static unsigned long hit_count = 0;
+static unsigned long miss_count = 0;
+
+static void lru_unlink(CacheEntry *e) {
+    if (e->prev) e->prev->next = e->next; else lru_head = e->next;
+    if (e->next) e->next->prev = e->prev; else lru_tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(CacheEntry *e) {
+    e->prev = NULL;
+    e->next = lru_head;
+    if (lru_head) lru_head->prev = e;
+    lru_head = e;
+    if (!lru_tail) lru_tail = e;
+}
+
+static void entry_remove(CacheEntry *e) {
+    CacheEntry **slot = &buckets[e->hash & (BUCKET_COUNT - 1)];
+    while (*slot && *slot != e) {
+        slot = &(*slot)->chain;
+    }
+    if (*slot) *slot = e->chain;
+
+    lru_unlink(e);
+    commandlist_free(e->list);
+    free(e->line);
+    free(e);
+    entry_count--;
+}
+
+static CacheEntry *entry_find(const char *line, uint64_t hash) {
+    CacheEntry *e = buckets[hash & (BUCKET_COUNT - 1)];
+    while (e) {
+        if (e->hash == hash && strcmp(e->line, line) == 0) {
+            return e;
+        }
+        e = e->chain;
+    }
+    return NULL;
+}
+
+CommandList *plancache_lookup(const char *line) {
+    CacheEntry *e = entry_find(line, hash_str(line, HASH_SEED));
+    if (!e) {
+        miss_count++;
+        return NULL;
+    }
+
+    hit_count++;
+    if (e != lru_head) {
+        lru_unlink(e);
+        lru_push_front(e);
+    }
+    return e->list;
+}
+
+int plancache_insert(const char *line, CommandList *list) {
+    uint64_t hash = hash_str(line, HASH_SEED);
+
+    /* Replace a stale entry for the same line */
+    CacheEntry *old = entry_find(line, hash);
+    if (old) {
+        entry_remove(old);
+    }
+
+    CacheEntry *e = calloc(1, sizeof(CacheEntry));
+    if (!e) return -1;
+    e->line = strdup(line);
+    if (!e->line) {
+        free(e);
+        return -1;
+    }
+
+    /* Evict the least recently used plan when full */
+    if (entry_count >= PLANCACHE_CAPACITY && lru_tail) {
+        entry_remove(lru_tail);
+    }
+
+    e->hash = hash;
+    e->list = list;
+    e->chain = buckets[hash & (BUCKET_COUNT - 1)];
+    buckets[hash & (BUCKET_COUNT - 1)] = e;
+    lru_push_front(e);
+    entry_count++;
+
+    return 0;
+}
+
+void plancache_clear(void) {
+    while (lru_head) {
+        entry_remove(lru_head);
+    }
+}
+
+void plancache_stats(unsigned long *hits, unsigned long *misses, int *entries) {
+    if (hits) *hits = hit_count;
+    if (misses) *misses = miss_count;
+    if (entries) *entries = entry_count;
+}
@@ -0,0 +1,28 @@
+/*
+ * shelli - Educational Shell
+ * plancache.h - LRU cache of parsed command lists keyed by input line
+ */
+
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include "parser.h"
+
+/* Maximum number of cached plans before the least recently used is evicted */
+#define PLANCACHE_CAPACITY 64
+
+/* Look up the plan for a line, returns NULL on miss.
+ * The plan is owned by the cache and must be treated as read-only. */
+CommandList *plancache_lookup(const char *line);
+
+/* Store a parsed plan for a line, returns 0 on success, -1 on error.
+ * On success the cache owns list; on error the caller still does. */
+int plancache_insert(const char *line, CommandList *list);
+
+/* Drop every cached plan (counters are kept) */
+void plancache_clear(void);
+
+/* Get cache counters (any pointer may be NULL) */
+void plancache_stats(unsigned long *hits, unsigned long *misses, int *entries);
+
+#endif /* PLANCACHE_H */
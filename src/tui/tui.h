@@ -10,6 +10,8 @@
 
 #include "../lexer.h"
 #include "../parser.h"
+#include "../outbuf.h"
+#include "../execevent.h"
 
 /*
  * ============================================================================
@@ -149,6 +151,9 @@ void tui_draw_frame(void);
 /* Read a line of input with full editing support */
 char *tui_read_line(void);
 
+/* Show the empty prompt without reading (for startup timing) */
+void tui_draw_prompt(void);
+
 /*
  * ============================================================================
  * Public API - Stage Visualization
@@ -167,12 +172,31 @@ void tui_show_tokens(TokenList *tokens);
 /* Display parse results in PARSE panel */
 void tui_show_pipeline(Pipeline *pipeline);
 
-/* Add a log line to EXECUTE panel */
-void tui_log_exec(const char *message);
+/* Display a command list (pipelines joined by ; && ||) in PARSE panel */
+void tui_show_list(CommandList *list);
+
+/* Add a trace event to EXECUTE panel (formatted only when drawn) */
+void tui_log_event(const ExecEvent *ev);
+
+/* Show a progress bar in the EXECUTE panel (total <= 0: unknown) */
+void tui_show_progress(const char *label, long done, long total);
 
 /* Show final result with exit code */
 void tui_show_result(int exit_code, const char *output);
 
+/* Show a command's output store (kept by the caller until the panels
+ * are cleared); only the visible lines are read */
+void tui_show_output(int exit_code, OutBuf *output);
+
+/* Follow a running command's output store in RESULT (throttled) */
+void tui_follow_output(OutBuf *output);
+
+/* Scroll the RESULT panel by pages (negative: up) */
+void tui_result_scroll(int pages);
+
+/* Jump to the next RESULT line containing needle, returns 0 or -1 */
+int tui_result_search(const char *needle);
+
 /* Show error message */
 void tui_show_error(const char *message);
 
@@ -206,6 +230,131 @@ int tui_is_debug(void);
 /* Set debug mode */
 void tui_set_debug(int enabled);
 
+/*
+ * ============================================================================
+ * Renderer Backends
+ * ============================================================================
+ */
+
+/*
+ * What the tui_* display functions forward to. "full" is the framed
+ * screen, "line" prints a summary line per stage inline (for slow
+ * links), "null" prints only command output (for batch use). A NULL
+ * entry does nothing.
+ */
+typedef struct TuiRenderer {
+    const char *name;
+    void (*enter)(void);        /* Take over the screen */
+    void (*leave)(void);        /* Hand it back (before exit or a switch) */
+    void (*splash)(void);
+    void (*draw_frame)(void);
+    void (*render_input)(const char *line, int cursor_pos);
+    void (*stage_begin)(TuiStage stage);
+    void (*stage_end)(TuiStage stage);
+    void (*show_tokens)(TokenList *tokens);
+    void (*show_pipeline)(Pipeline *pipeline);
+    void (*show_list)(CommandList *list);
+    void (*log_event)(const ExecEvent *ev);
+    void (*show_progress)(const char *label, long done, long total);
+    void (*follow_output)(OutBuf *output);
+    void (*show_output)(int exit_code, OutBuf *output);
+    void (*show_result)(int exit_code, const char *output);
+    void (*show_error)(const char *message);
+    void (*update_panel)(PanelId panel, const char *content);
+    void (*clear_panel)(PanelId panel);
+    void (*clear_all_panels)(void);
+    void (*result_scroll)(int pages);
+    int (*result_search)(const char *needle);
+    void (*wait_step)(const char *step_name);
+} TuiRenderer;
+
+extern const TuiRenderer tui_renderer_full;
+extern const TuiRenderer tui_renderer_line;
+extern const TuiRenderer tui_renderer_null;
+
+/* Select a backend by name, before tui_init or while running (the
+ * screen is handed over at once). Returns 0, or -1 for an unknown name. */
+int tui_set_renderer(const char *name);
+
+/* Name of the active backend */
+const char *tui_renderer_name(void);
+
+/* Names of all backends, separated by '|' */
+const char *tui_renderer_names(void);
+
+/*
+ * ============================================================================
+ * Public API - Adaptive Quality (tui_pace.c)
+ * ============================================================================
+ */
+
+/* Quality levels run from 0 (no animation, one colour) to PACE_LEVEL_MAX */
+#define PACE_LEVEL_MAX 3
+
+/* Start measuring the terminal (raw mode, full screen); does not wait */
+void pace_start(void);
+
+/* After a frame is flushed: collect or send a background measurement */
+void pace_frame(void);
+
+/* Check whether a measurement reply is awaited; pace_poll reads input
+ * for up to timeout_ms (-1: until it is overdue) and takes it out */
+int pace_waiting(void);
+void pace_poll(int timeout_ms);
+
+/* Sleep, timing a pending measurement reply meanwhile */
+void pace_pause(int us);
+
+/* Wait for a pending measurement reply before reading input directly */
+void pace_settle(void);
+
+/* Next key byte read while waiting for a reply, or -1 */
+int pace_pending_byte(void);
+
+/* A command starts; pace_output reports its output so far in bytes */
+void pace_command_begin(void);
+void pace_output(uint64_t bytes);
+
+/* Current level and the settings it implies */
+int pace_level(void);
+int pace_anim_delay_us(void);
+int pace_frame_ms(void);
+int pace_splash_frames(void);
+int pace_gradient_stride(void);
+
+/* Describe the level and measurements in buf */
+void pace_describe(char *buf, size_t size);
+
+/*
+ * ============================================================================
+ * Public API - Text Width (tui_width.c)
+ * ============================================================================
+ */
+
+/* Columns a code point takes on its own: 0, 1 or 2 */
+int uc_width(uint32_t cp);
+
+/* Decode the UTF-8 character at s (len > 0), returns its length in bytes
+ * (1 for a malformed byte, which decodes to U+FFFD) */
+int utf8_decode(const char *s, size_t len, uint32_t *cp);
+
+/* Length of the sequence a UTF-8 lead byte starts (1 if none) */
+int utf8_seq_len(unsigned char lead);
+
+/* Length of the grapheme cluster at s (len > 0); *cols (if not NULL)
+ * gets the columns it takes */
+size_t grapheme_next(const char *s, size_t len, int *cols);
+
+/* Start of the grapheme cluster ending at pos */
+size_t grapheme_prev(const char *s, size_t pos);
+
+/* Length of a CSI escape sequence at s, 0 if there is none */
+size_t text_escape_len(const char *s, size_t len);
+
+/* Columns text takes on the terminal, escape sequences take none */
+int text_columns(const char *s, size_t len);
+int text_width(const char *s);
+
 /*
  * ============================================================================
  * Public API - Animation
@@ -225,20 +374,41 @@ const char *tui_spinner_frame(int frame);
  */
 
 /* Easing functions for smooth animations */
+typedef float (*EaseFn)(float t);
 float ease_out_cubic(float t);
 float ease_in_out_quad(float t);
 float ease_out_elastic(float t);
 float ease_linear(float t);
 
-/* Animation lifecycle */
-int anim_create(int type, const char *content, int x, int y, int frames);
+/* Animation types (ANIM_NONE picks ANIM_FADE_IN) */
+typedef enum {
+    ANIM_NONE = 0,
+    ANIM_FADE_IN,      /* Glow: ░ -> ▒ -> ▓ -> █ */
+    ANIM_TYPEWRITER,   /* Character by character reveal */
+    ANIM_SLIDE_IN,     /* Slide in from direction */
+    ANIM_PULSE,        /* Brightness oscillation */
+    ANIM_GLOW,         /* Glow border effect */
+} AnimType;
+
+/* Animation lifecycle: animations are scheduled, never drawn one by one */
+int anim_create(int type, const char *content, int x, int y, int duration_ms);
+void anim_set_easing(int anim_id, EaseFn ease);
+void anim_set_delay(int anim_id, int delay_ms);
 void anim_start(int anim_id);
-int anim_tick(int anim_id);
-void anim_render(int anim_id);
 int anim_is_complete(int anim_id);
 void anim_destroy(int anim_id);
 void anim_clear_all(void);
 
+/* Scheduler: draw all running animations in one write, returns how
+ * many are still running */
+int anim_frame(void);
+
+/* Play running animations for ms (dropping late frames), or just wait */
+void anim_run_for(int ms);
+
+/* Play until one animation completes, the others advancing with it */
+void anim_wait(int anim_id);
+
 /* Convenience blocking animations */
 void anim_fade_in_blocking(int x, int y, const char *content, int duration_ms);
 void anim_typewriter_blocking(int x, int y, const char *content, int duration_ms);
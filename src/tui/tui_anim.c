@@ -1,27 +1,24 @@
 /*
  * shelli - Educational Shell
  * tui/tui_anim.c - Animation system with easing functions and effects
+ *
+ * Animations are retained tweens on a timeline: each has a start delay,
+ * a duration and an easing function, and its look is a function of the
+ * time since it started. The scheduler draws every running animation
+ * into one buffer and writes it once per frame; when a frame comes late
+ * the missed frame slots are skipped, since the next frame shows the
+ * state for the current time anyway.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <math.h>
+#include <time.h>
 #include <unistd.h>
 #include "tui.h"
 
-/*
- * Animation types
- */
-typedef enum {
-    ANIM_NONE = 0,
-    ANIM_FADE_IN,      /* Glow: ░ -> ▒ -> ▓ -> █ */
-    ANIM_TYPEWRITER,   /* Character by character reveal */
-    ANIM_SLIDE_IN,     /* Slide in from direction */
-    ANIM_PULSE,        /* Brightness oscillation */
-    ANIM_GLOW,         /* Glow border effect */
-} AnimType;
-
 /*
  * Glow effect characters
  */
@@ -39,21 +36,28 @@ static const char *GLOW_CHARS[] = {
  */
 typedef struct {
     AnimType type;
-    int frame;
-    int total_frames;
-    int complete;
+    EaseFn ease;
+    int delay_ms;       /* From anim_start to the first change */
+    int duration_ms;
+    double start_ms;    /* Scheduler time it starts, < 0: not started */
+    int complete;       /* Final state has been drawn */
     char *content;
-    int content_len;
+    int content_cols;   /* Columns the content takes */
     int x;
     int y;
 } Animation;
 
 /*
- * Global animation state for reuse
+ * All animations; a slot whose type is ANIM_NONE is free for reuse
  */
-#define MAX_ANIMATIONS 8
-static Animation animations[MAX_ANIMATIONS];
+static Animation *animations = NULL;
 static int anim_count = 0;
+static int anim_capacity = 0;
+
+/* The combined frame being built */
+static char *frame = NULL;
+static size_t frame_len = 0;
+static size_t frame_cap = 0;
 
 /*
  * Easing function: ease out cubic
@@ -102,178 +106,298 @@ float ease_linear(float t) {
 }
 
 /*
- * Create a new animation
- * type values: 0=NONE, 1=FADE_IN, 2=TYPEWRITER, 3=SLIDE_IN, 4=PULSE, 5=GLOW
+ * Milliseconds on the scheduler clock
  */
-int anim_create(int type, const char *content, int x, int y, int frames) {
-    if (anim_count >= MAX_ANIMATIONS) {
-        return -1;  /* No room for more animations */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static Animation *anim_get(int anim_id) {
+    if (anim_id < 0 || anim_id >= anim_count) return NULL;
+    if (animations[anim_id].type == ANIM_NONE) return NULL;
+    return &animations[anim_id];
+}
+
+/*
+ * Create a new animation (not running until anim_start)
+ */
+int anim_create(int type, const char *content, int x, int y, int duration_ms) {
+    int id = 0;
+    while (id < anim_count && animations[id].type != ANIM_NONE) id++;
+
+    if (id == anim_capacity) {
+        int capacity = anim_capacity ? anim_capacity * 2 : 8;
+        Animation *grown = realloc(animations, capacity * sizeof(Animation));
+        if (!grown) return -1;
+        animations = grown;
+        anim_capacity = capacity;
     }
 
-    Animation *a = &animations[anim_count];
-    a->type = type;
-    a->frame = 0;
-    a->total_frames = frames > 0 ? frames : 10;
+    Animation *a = &animations[id];
+    a->type = type != ANIM_NONE ? type : ANIM_FADE_IN;
+    a->ease = ease_out_cubic;
+    a->delay_ms = 0;
+    a->duration_ms = duration_ms > 0 ? duration_ms : 160;
+    a->start_ms = -1.0;
     a->complete = 0;
     a->x = x;
     a->y = y;
 
     if (content) {
         a->content = strdup(content);
-        a->content_len = (int)strlen(content);
+        a->content_cols = text_width(content);
     } else {
         a->content = NULL;
-        a->content_len = 0;
+        a->content_cols = 0;
     }
 
-    return anim_count++;
+    if (id == anim_count) anim_count++;
+    return id;
 }
 
 /*
- * Start/reset an animation
+ * Set the easing function (default ease_out_cubic)
  */
-void anim_start(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return;
-    animations[anim_id].frame = 0;
-    animations[anim_id].complete = 0;
+void anim_set_easing(int anim_id, EaseFn ease) {
+    Animation *a = anim_get(anim_id);
+    if (a && ease) a->ease = ease;
 }
 
 /*
- * Tick an animation forward one frame
- * Returns 1 when animation is complete
+ * Delay the animation's start relative to anim_start, to stagger it
+ * against others on the same timeline
  */
-int anim_tick(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return 1;
-
-    Animation *a = &animations[anim_id];
-    if (a->complete) return 1;
+void anim_set_delay(int anim_id, int delay_ms) {
+    Animation *a = anim_get(anim_id);
+    if (a) a->delay_ms = delay_ms > 0 ? delay_ms : 0;
+}
 
-    a->frame++;
-    if (a->frame >= a->total_frames) {
-        a->complete = 1;
-        return 1;
-    }
-    return 0;
+/*
+ * Start/restart an animation on the scheduler
+ */
+void anim_start(int anim_id) {
+    Animation *a = anim_get(anim_id);
+    if (!a) return;
+    a->start_ms = now_ms() + a->delay_ms;
+    a->complete = 0;
 }
 
 /*
- * Get animation progress (0.0 to 1.0)
+ * Append formatted text to the frame
  */
-float anim_progress(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return 1.0f;
-    Animation *a = &animations[anim_id];
-    if (a->total_frames <= 0) return 1.0f;
-    return (float)a->frame / (float)a->total_frames;
+static void frame_printf(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(frame ? frame + frame_len : NULL, frame_cap - frame_len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+
+    if (frame_len + n + 1 > frame_cap) {
+        size_t cap = frame_cap ? frame_cap : 4096;
+        while (cap < frame_len + n + 1) cap *= 2;
+        char *grown = realloc(frame, cap);
+        if (!grown) return;
+        frame = grown;
+        frame_cap = cap;
+
+        va_start(ap, fmt);
+        vsnprintf(frame + frame_len, frame_cap - frame_len, fmt, ap);
+        va_end(ap);
+    }
+    frame_len += n;
 }
 
 /*
- * Render fade-in animation at current frame
+ * Draw fade-in animation at eased progress p
  */
-static void render_fade_in(Animation *a) {
-    float progress = ease_out_cubic((float)a->frame / (float)a->total_frames);
-    int glow_level = (int)(progress * (GLOW_LEVELS - 1));
+static void render_fade_in(Animation *a, float p) {
+    int glow_level = (int)(p * (GLOW_LEVELS - 1));
     if (glow_level >= GLOW_LEVELS) glow_level = GLOW_LEVELS - 1;
 
-    printf(CSI "%d;%dH", a->y, a->x);
+    frame_printf(CSI "%d;%dH", a->y, a->x);
     if (a->content) {
         /* Reveal content based on glow level */
         if (glow_level == GLOW_LEVELS - 1) {
-            printf("%s", a->content);
+            frame_printf("%s", a->content);
         } else {
             /* Show glow placeholder */
-            for (int i = 0; i < a->content_len; i++) {
-                printf("%s", GLOW_CHARS[glow_level]);
+            for (int i = 0; i < a->content_cols; i++) {
+                frame_printf("%s", GLOW_CHARS[glow_level]);
             }
         }
     }
 }
 
 /*
- * Render typewriter animation at current frame
+ * Draw typewriter animation at eased progress p
  */
-static void render_typewriter(Animation *a) {
+static void render_typewriter(Animation *a, float p, double elapsed_ms) {
     if (!a->content) return;
 
-    float progress = ease_out_cubic((float)a->frame / (float)a->total_frames);
-    int chars_to_show = (int)(progress * a->content_len);
-    if (chars_to_show > a->content_len) chars_to_show = a->content_len;
-
-    printf(CSI "%d;%dH", a->y, a->x);
-    for (int i = 0; i < chars_to_show; i++) {
-        printf("%c", a->content[i]);
+    int cols_to_show = (int)(p * a->content_cols);
+    size_t len = strlen(a->content);
+    size_t shown = 0;
+    int cols = 0;
+
+    /* Whole characters only */
+    while (shown < len) {
+        int w;
+        size_t n = grapheme_next(a->content + shown, len - shown, &w);
+        if (cols + w > cols_to_show) break;
+        shown += n;
+        cols += w;
     }
 
-    /* Cursor effect at end */
-    if (chars_to_show < a->content_len && (a->frame % 2) == 0) {
-        printf("_");
+    frame_printf(CSI "%d;%dH%.*s", a->y, a->x, (int)shown, a->content);
+
+    /* Cursor effect at end, blinking every 100ms */
+    if (shown < len && ((int)(elapsed_ms / 100) % 2) == 0) {
+        frame_printf("_");
     }
 }
 
 /*
- * Render pulse animation (brightness oscillation)
+ * Draw pulse animation (brightness oscillation) at linear progress t
  */
-static void render_pulse(Animation *a) {
+static void render_pulse(Animation *a, float t) {
     if (!a->content) return;
 
     /* Create pulsing effect using sin wave */
-    float t = (float)a->frame / (float)a->total_frames;
     float pulse = (sinf(t * 3.14159265f * 4.0f) + 1.0f) / 2.0f;  /* 0 to 1 */
 
     /* Map pulse to color brightness (between dim and bright) */
     int color = 243 + (int)(pulse * 12);  /* Range 243-255 */
     if (color > 255) color = 255;
 
-    printf(CSI "%d;%dH", a->y, a->x);
-    printf(CSI "38;5;%dm%s" COL_RESET, color, a->content);
+    frame_printf(CSI "%d;%dH" CSI "38;5;%dm%s" COL_RESET, a->y, a->x, color, a->content);
 }
 
 /*
- * Render animation at current frame
+ * Draw one animation's state at time now into the frame
  */
-void anim_render(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return;
-
-    Animation *a = &animations[anim_id];
+static void render_at(Animation *a, double now) {
+    double elapsed = now - a->start_ms;
+    float t = elapsed >= a->duration_ms ? 1.0f : (float)(elapsed / a->duration_ms);
+    float p = a->ease(t);
 
     switch (a->type) {
         case ANIM_FADE_IN:
-            render_fade_in(a);
+            render_fade_in(a, p);
             break;
         case ANIM_TYPEWRITER:
-            render_typewriter(a);
+            render_typewriter(a, p, elapsed);
             break;
         case ANIM_PULSE:
-            render_pulse(a);
+            render_pulse(a, t);
             break;
         default:
             /* Unsupported animation type - just draw content */
             if (a->content) {
-                printf(CSI "%d;%dH%s", a->y, a->x, a->content);
+                frame_printf(CSI "%d;%dH%s", a->y, a->x, a->content);
             }
             break;
     }
-    fflush(stdout);
+}
+
+/*
+ * Draw every running animation's current state in one write. Returns
+ * the number of animations still running (started and not complete).
+ */
+int anim_frame(void) {
+    double now = now_ms();
+    int running = 0;
+
+    frame_len = 0;
+    for (int i = 0; i < anim_count; i++) {
+        Animation *a = &animations[i];
+        if (a->type == ANIM_NONE || a->start_ms < 0 || a->complete) continue;
+
+        running++;
+        if (now < a->start_ms) continue;  /* Still in its delay */
+
+        render_at(a, now);
+        if (now - a->start_ms >= a->duration_ms) {
+            a->complete = 1;
+            running--;
+        }
+    }
+
+    if (frame_len > 0) {
+        fwrite(frame, 1, frame_len, stdout);
+        fflush(stdout);
+        pace_frame();
+    }
+    return running;
+}
+
+/*
+ * Run the scheduler until until_ms, or until anim_id completes if it is
+ * a valid id. Frames fall on a fixed grid of pace_frame_ms(); slots that
+ * passed while a frame was being drawn are dropped, not caught up.
+ */
+static void run_until(double until_ms, int anim_id) {
+    double next = now_ms();
+
+    while (1) {
+        int running = anim_frame();
+        double now = now_ms();
+
+        if (anim_id >= 0 ? anim_is_complete(anim_id) : now >= until_ms) break;
+
+        if (running == 0) {
+            /* Nothing to draw: wait out the rest in one go */
+            if (anim_id < 0) pace_pause((int)((until_ms - now) * 1000.0));
+            break;
+        }
+
+        int frame_ms = pace_frame_ms();
+        next += frame_ms;
+        if (next <= now) {
+            next += ((int)((now - next) / frame_ms) + 1) * frame_ms;
+        }
+        double wake = anim_id < 0 && until_ms < next ? until_ms : next;
+        pace_pause((int)((wake - now) * 1000.0));
+    }
+}
+
+/*
+ * Let the running animations play for ms milliseconds (or just wait
+ * that long if none are running)
+ */
+void anim_run_for(int ms) {
+    if (ms <= 0) return;
+    run_until(now_ms() + ms, -1);
+}
+
+/*
+ * Play until anim_id has drawn its final state; other running
+ * animations advance in the same frames
+ */
+void anim_wait(int anim_id) {
+    if (!anim_get(anim_id) || animations[anim_id].start_ms < 0) return;
+    run_until(0, anim_id);
 }
 
 /*
  * Check if animation is complete
  */
 int anim_is_complete(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return 1;
-    return animations[anim_id].complete;
+    Animation *a = anim_get(anim_id);
+    return a ? a->complete : 1;
 }
 
 /*
  * Destroy an animation and free resources
  */
 void anim_destroy(int anim_id) {
-    if (anim_id < 0 || anim_id >= anim_count) return;
+    Animation *a = anim_get(anim_id);
+    if (!a) return;
 
-    Animation *a = &animations[anim_id];
-    if (a->content) {
-        free(a->content);
-        a->content = NULL;
-    }
+    free(a->content);
+    a->content = NULL;
     a->type = ANIM_NONE;
 }
 
@@ -292,10 +416,7 @@ void anim_clear_all(void) {
  * Convenience function for quick effects
  */
 void anim_fade_in_blocking(int x, int y, const char *content, int duration_ms) {
-    int frames = duration_ms / 16;  /* ~60fps */
-    if (frames < 5) frames = 5;
-
-    int anim_id = anim_create(ANIM_FADE_IN, content, x, y, frames);
+    int anim_id = anim_create(ANIM_FADE_IN, content, x, y, duration_ms);
     if (anim_id < 0) {
         /* Fallback: just print content */
         printf(CSI "%d;%dH%s", y, x, content);
@@ -303,16 +424,8 @@ void anim_fade_in_blocking(int x, int y, const char *content, int duration_ms) {
         return;
     }
 
-    while (!anim_is_complete(anim_id)) {
-        anim_render(anim_id);
-        anim_tick(anim_id);
-        usleep(16000);  /* ~60fps */
-    }
-
-    /* Final render */
-    printf(CSI "%d;%dH%s", y, x, content);
-    fflush(stdout);
-
+    anim_start(anim_id);
+    anim_wait(anim_id);
     anim_destroy(anim_id);
 }
 
@@ -320,25 +433,14 @@ void anim_fade_in_blocking(int x, int y, const char *content, int duration_ms) {
  * Run a typewriter animation blocking
  */
 void anim_typewriter_blocking(int x, int y, const char *content, int duration_ms) {
-    int frames = duration_ms / 16;
-    if (frames < 5) frames = 5;
-
-    int anim_id = anim_create(ANIM_TYPEWRITER, content, x, y, frames);
+    int anim_id = anim_create(ANIM_TYPEWRITER, content, x, y, duration_ms);
     if (anim_id < 0) {
         printf(CSI "%d;%dH%s", y, x, content);
         fflush(stdout);
         return;
     }
 
-    while (!anim_is_complete(anim_id)) {
-        anim_render(anim_id);
-        anim_tick(anim_id);
-        usleep(16000);
-    }
-
-    /* Final render */
-    printf(CSI "%d;%dH%s", y, x, content);
-    fflush(stdout);
-
+    anim_start(anim_id);
+    anim_wait(anim_id);
     anim_destroy(anim_id);
 }
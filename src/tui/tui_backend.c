@@ -0,0 +1,150 @@
+/*
+ * shelli - Educational Shell
+ * tui/tui_backend.c - Renderer selection and dispatch
+ *
+ * The public display functions forward to the active TuiRenderer, so the
+ * REPL and the line editor never know which backend is drawing.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "tui.h"
+
+static const TuiRenderer *const renderers[] = {
+    &tui_renderer_full,
+    &tui_renderer_line,
+    &tui_renderer_null,
+};
+
+#define RENDERER_COUNT (int)(sizeof(renderers) / sizeof(renderers[0]))
+
+static const TuiRenderer *active = &tui_renderer_full;
+static int entered = 0;     /* The active backend owns the screen */
+
+/*
+ * Called by tui_init / tui_cleanup around the session
+ */
+void renderer_enter(void) {
+    if (active->enter) active->enter();
+    entered = 1;
+}
+
+void renderer_leave(void) {
+    if (entered && active->leave) active->leave();
+    entered = 0;
+}
+
+int tui_set_renderer(const char *name) {
+    for (int i = 0; i < RENDERER_COUNT; i++) {
+        if (strcmp(renderers[i]->name, name) != 0) continue;
+        if (renderers[i] == active) return 0;
+
+        if (!entered) {
+            active = renderers[i];
+            return 0;
+        }
+        renderer_leave();
+        active = renderers[i];
+        renderer_enter();
+        if (active->draw_frame) active->draw_frame();
+        return 0;
+    }
+    return -1;
+}
+
+const char *tui_renderer_name(void) {
+    return active->name;
+}
+
+const char *tui_renderer_names(void) {
+    static char names[64];
+
+    if (!names[0]) {
+        for (int i = 0; i < RENDERER_COUNT; i++) {
+            if (i > 0) strcat(names, "|");
+            strcat(names, renderers[i]->name);
+        }
+    }
+    return names;
+}
+
+void tui_splash(void) {
+    if (active->splash) active->splash();
+}
+
+void tui_draw_frame(void) {
+    if (active->draw_frame) active->draw_frame();
+}
+
+/* Called by the line editor after every edit */
+void render_input_line(const char *line, int cursor_pos) {
+    if (active->render_input) active->render_input(line, cursor_pos);
+}
+
+void tui_stage_begin(TuiStage stage) {
+    if (active->stage_begin) active->stage_begin(stage);
+}
+
+void tui_stage_end(TuiStage stage) {
+    if (active->stage_end) active->stage_end(stage);
+}
+
+void tui_show_tokens(TokenList *tokens) {
+    if (active->show_tokens) active->show_tokens(tokens);
+}
+
+void tui_show_pipeline(Pipeline *pipeline) {
+    if (active->show_pipeline) active->show_pipeline(pipeline);
+}
+
+void tui_show_list(CommandList *list) {
+    if (active->show_list) active->show_list(list);
+}
+
+void tui_log_event(const ExecEvent *ev) {
+    if (active->log_event) active->log_event(ev);
+}
+
+void tui_show_progress(const char *label, long done, long total) {
+    if (active->show_progress) active->show_progress(label, done, total);
+}
+
+void tui_follow_output(OutBuf *output) {
+    if (active->follow_output) active->follow_output(output);
+}
+
+void tui_show_output(int exit_code, OutBuf *output) {
+    if (active->show_output) active->show_output(exit_code, output);
+}
+
+void tui_show_result(int exit_code, const char *output) {
+    if (active->show_result) active->show_result(exit_code, output);
+}
+
+void tui_show_error(const char *message) {
+    if (active->show_error) active->show_error(message);
+}
+
+void tui_update_panel(PanelId panel, const char *content) {
+    if (active->update_panel) active->update_panel(panel, content);
+}
+
+void tui_clear_panel(PanelId panel) {
+    if (active->clear_panel) active->clear_panel(panel);
+}
+
+void tui_clear_all_panels(void) {
+    if (active->clear_all_panels) active->clear_all_panels();
+}
+
+void tui_result_scroll(int pages) {
+    if (active->result_scroll) active->result_scroll(pages);
+}
+
+int tui_result_search(const char *needle) {
+    return active->result_search ? active->result_search(needle) : -1;
+}
+
+void tui_wait_step(const char *step_name) {
+    if (active->wait_step) active->wait_step(step_name);
+}
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
 #include <termios.h>
 #include <sys/ioctl.h>
 #include <signal.h>
@@ -24,6 +25,8 @@ static int term_height = 24;
 /* Forward declarations for internal functions */
 void splash_draw(int width, int height);
 void splash_animate(int width, int height, int frame);
+void renderer_enter(void);
+void renderer_leave(void);
 
 /*
  * Update terminal size from ioctl
@@ -93,29 +96,22 @@ static void exit_raw_mode(void) {
 }
 
 /*
- * Enter alternate screen buffer
+ * Internal: enter or leave the alternate screen buffer (for renderers
+ * that take over the whole screen)
  */
-static void enter_alt_screen(void) {
-    if (alt_screen_enabled) return;
-
-    printf(ALT_SCREEN_ON);
-    printf(CUR_HIDE);
-    fflush(stdout);
-
-    alt_screen_enabled = 1;
-}
-
-/*
- * Exit alternate screen buffer
- */
-static void exit_alt_screen(void) {
-    if (!alt_screen_enabled) return;
-
-    printf(CUR_SHOW);
-    printf(ALT_SCREEN_OFF);
+void term_alt_screen(int on) {
+    if (on == alt_screen_enabled) return;
+
+    if (on) {
+        printf(ALT_SCREEN_ON);
+        printf(CUR_HIDE);
+    } else {
+        printf(CUR_SHOW);
+        printf(ALT_SCREEN_OFF);
+    }
     fflush(stdout);
 
-    alt_screen_enabled = 0;
+    alt_screen_enabled = on;
 }
 
 /*
@@ -125,12 +121,8 @@ int tui_init(void) {
     /* Get initial terminal size */
     update_size();
 
-    /* Enter alternate screen first (before raw mode) */
-    enter_alt_screen();
-
-    /* Enter raw mode for input handling */
-    if (enter_raw_mode() < 0) {
-        exit_alt_screen();
+    /* Enter raw mode for input handling (piped input is read by line) */
+    if (isatty(STDIN_FILENO) && enter_raw_mode() < 0) {
         return -1;
     }
 
@@ -141,11 +133,8 @@ int tui_init(void) {
     sa.sa_flags = 0;
     sigaction(SIGWINCH, &sa, NULL);
 
-    /* Clear screen */
-    printf(BG_BASE);
-    printf(SCR_CLEAR);
-    printf(CUR_HOME);
-    fflush(stdout);
+    /* The renderer sets up the screen */
+    renderer_enter();
 
     return 0;
 }
@@ -157,11 +146,11 @@ void tui_cleanup(void) {
     /* Exit raw mode first */
     exit_raw_mode();
 
-    /* Exit alternate screen */
-    exit_alt_screen();
+    /* Hand the screen back */
+    renderer_leave();
 
     /* Reset colors */
-    printf(COL_RESET);
+    if (isatty(STDOUT_FILENO)) printf(COL_RESET);
     fflush(stdout);
 }
 
@@ -189,13 +178,41 @@ int term_get_height(void) {
 }
 
 /*
- * Show splash screen with animation
+ * Internal: read one typed byte, waiting up to timeout_ms (-1: no
+ * limit). Replies to the terminal measurement (tui_pace.c) are taken
+ * out. Returns the byte, -1 if nothing was typed in time, or -2 at end
+ * of input.
+ */
+int term_read_byte(int timeout_ms) {
+    int c = pace_pending_byte();
+    if (c >= 0) return c;
+
+    if (pace_waiting()) {
+        pace_poll(timeout_ms);
+        c = pace_pending_byte();
+        return c >= 0 ? c : -1;
+    }
+
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) return -1;
+
+    unsigned char b;
+    ssize_t n = read(STDIN_FILENO, &b, 1);
+    if (n == 1) return b;
+    return n == 0 ? -2 : -1;
+}
+
+/*
+ * Internal: show the splash screen with animation (full renderer)
  */
-void tui_splash(void) {
-    /* Simple animation: fade in over a few frames */
-    for (int frame = 0; frame < 5; frame++) {
-        splash_animate(term_width, term_height, frame);
-        usleep(50000);  /* 50ms per frame */
+void splash_run(void) {
+    /* Simple animation: fade in over a few frames (fewer on a slow
+     * terminal, always ending on the full splash); a key skips the rest */
+    int frames = pace_splash_frames();
+    int key = -1;
+    for (int i = 0; i < frames && key == -1; i++) {
+        splash_animate(term_width, term_height, (i + 1) * 5 / frames - 1);
+        key = term_read_byte(50);  /* 50ms per frame */
     }
 
     /* Wait for keypress */
@@ -203,9 +220,8 @@ void tui_splash(void) {
     fflush(stdout);
 
     /* Read any key */
-    char c;
-    while (read(STDIN_FILENO, &c, 1) != 1) {
-        /* Wait for input */
+    while (key == -1) {
+        key = term_read_byte(-1);
     }
 
     printf(CUR_HIDE);
@@ -35,6 +35,9 @@ typedef enum {
     KEY_CTRL_K,
     KEY_CTRL_U,
     KEY_CTRL_W,
+    KEY_CTRL_F,
+    KEY_PAGE_UP,
+    KEY_PAGE_DOWN,
 } KeyCode;
 
 /*
@@ -42,7 +45,8 @@ typedef enum {
  */
 typedef struct {
     KeyCode code;
-    char ch;           /* For KEY_CHAR */
+    char ch[4];        /* For KEY_CHAR: one UTF-8 character */
+    int len;
 } KeyEvent;
 
 /*
@@ -68,18 +72,18 @@ typedef struct {
 
 static LineEditor editor = {0};
 
-/* External functions from tui_render.c */
+/* External functions from tui_backend.c */
 void render_input_line(const char *line, int cursor_pos);
 
+/* External functions from tui_core.c */
+int term_read_byte(int timeout_ms);
+
 /*
  * Read a raw byte with timeout
  */
 static int read_byte(void) {
-    char c;
-    if (read(STDIN_FILENO, &c, 1) == 1) {
-        return (unsigned char)c;
-    }
-    return -1;
+    int c = term_read_byte(100);
+    return c >= 0 ? c : -1;
 }
 
 /*
@@ -150,6 +154,11 @@ static KeyEvent read_key(void) {
         return evt;
     }
 
+    if (c == 6) {  /* Ctrl+F */
+        evt.code = KEY_CTRL_F;
+        return evt;
+    }
+
     /* Escape sequences */
     if (c == 27) {
         int c2 = read_byte();
@@ -198,6 +207,15 @@ static KeyEvent read_key(void) {
                     }
                     break;
                 }
+                case '5':
+                case '6': {
+                    int c4 = read_byte();
+                    if (c4 == '~') {
+                        evt.code = c3 == '5' ? KEY_PAGE_UP : KEY_PAGE_DOWN;
+                        return evt;
+                    }
+                    break;
+                }
             }
         }
 
@@ -208,74 +226,85 @@ static KeyEvent read_key(void) {
     /* Regular printable character */
     if (c >= 32 && c < 127) {
         evt.code = KEY_CHAR;
-        evt.ch = (char)c;
+        evt.ch[0] = (char)c;
+        evt.len = 1;
         return evt;
     }
 
-    /* UTF-8 multibyte character - treat as char */
-    if ((c & 0xC0) == 0xC0) {
-        evt.code = KEY_CHAR;
-        evt.ch = (char)c;
-        return evt;
+    /* UTF-8 multibyte character: read the rest, drop it if malformed */
+    int n = utf8_seq_len((unsigned char)c);
+    if (n > 1) {
+        uint32_t cp;
+        evt.ch[0] = (char)c;
+        for (evt.len = 1; evt.len < n; evt.len++) {
+            int cc = read_byte();
+            if (cc < 0 || (cc & 0xC0) != 0x80) return evt;
+            evt.ch[evt.len] = (char)cc;
+        }
+        if (utf8_decode(evt.ch, (size_t)n, &cp) == n) evt.code = KEY_CHAR;
     }
 
     return evt;
 }
 
 /*
- * Insert character at cursor position
+ * Insert the n bytes of a character at cursor position
  */
-static void editor_insert(char c) {
-    if (editor.len >= LINE_BUFFER_SIZE - 1) return;
+static void editor_insert(const char *s, int n) {
+    if (editor.len + n > LINE_BUFFER_SIZE - 1) return;
 
     /* Shift characters after cursor */
-    memmove(&editor.buf[editor.cursor + 1],
+    memmove(&editor.buf[editor.cursor + n],
             &editor.buf[editor.cursor],
             editor.len - editor.cursor);
 
-    editor.buf[editor.cursor] = c;
-    editor.cursor++;
-    editor.len++;
+    memcpy(&editor.buf[editor.cursor], s, (size_t)n);
+    editor.cursor += n;
+    editor.len += n;
     editor.buf[editor.len] = '\0';
 }
 
 /*
- * Delete character before cursor (backspace)
+ * Remove bytes [from, to) of the line
+ */
+static void editor_erase(int from, int to) {
+    memmove(&editor.buf[from], &editor.buf[to], editor.len - to);
+    editor.len -= to - from;
+    editor.buf[editor.len] = '\0';
+}
+
+/*
+ * Delete the character (grapheme cluster) before cursor (backspace)
  */
 static void editor_backspace(void) {
     if (editor.cursor == 0) return;
 
-    memmove(&editor.buf[editor.cursor - 1],
-            &editor.buf[editor.cursor],
-            editor.len - editor.cursor);
-
-    editor.cursor--;
-    editor.len--;
-    editor.buf[editor.len] = '\0';
+    int start = (int)grapheme_prev(editor.buf, (size_t)editor.cursor);
+    editor_erase(start, editor.cursor);
+    editor.cursor = start;
 }
 
 /*
- * Delete character at cursor (delete key)
+ * Delete the character at cursor (delete key)
  */
 static void editor_delete(void) {
     if (editor.cursor >= editor.len) return;
 
-    memmove(&editor.buf[editor.cursor],
-            &editor.buf[editor.cursor + 1],
-            editor.len - editor.cursor - 1);
-
-    editor.len--;
-    editor.buf[editor.len] = '\0';
+    size_t n = grapheme_next(editor.buf + editor.cursor,
+                             (size_t)(editor.len - editor.cursor), NULL);
+    editor_erase(editor.cursor, editor.cursor + (int)n);
 }
 
 /*
- * Move cursor
+ * Move cursor one character left (-1) or right (1)
  */
-static void editor_move(int delta) {
-    int new_pos = editor.cursor + delta;
-    if (new_pos < 0) new_pos = 0;
-    if (new_pos > editor.len) new_pos = editor.len;
-    editor.cursor = new_pos;
+static void editor_move(int dir) {
+    if (dir < 0 && editor.cursor > 0) {
+        editor.cursor = (int)grapheme_prev(editor.buf, (size_t)editor.cursor);
+    } else if (dir > 0 && editor.cursor < editor.len) {
+        editor.cursor += (int)grapheme_next(editor.buf + editor.cursor,
+                                            (size_t)(editor.len - editor.cursor), NULL);
+    }
 }
 
 /*
@@ -413,10 +442,41 @@ static void history_down(void) {
     }
 }
 
+/*
+ * Read a line from piped input: no editing, no echo, EOF ends the session
+ */
+static char *read_plain_line(void) {
+    int c;
+
+    editor_clear();
+    while ((c = term_read_byte(-1)) != -2 && c != '\n') {
+        if (c < 0 || c == '\r' || editor.len >= LINE_BUFFER_SIZE - 1) continue;
+        editor.buf[editor.len++] = (char)c;
+    }
+    editor.buf[editor.len] = '\0';
+
+    if (c == -2 && editor.len == 0) return NULL;
+    return strdup(editor.buf);
+}
+
+/*
+ * Show the empty prompt, as tui_read_line does first
+ */
+void tui_draw_prompt(void) {
+    editor_clear();
+    printf(CUR_SHOW);
+    fflush(stdout);
+    render_input_line(editor.buf, editor.cursor);
+}
+
 /*
  * Read a line of input with editing support
  */
 char *tui_read_line(void) {
+    if (!isatty(STDIN_FILENO)) {
+        return read_plain_line();
+    }
+
     /* Reset editor state */
     editor_clear();
     editor.hist_pos = editor.hist_count;
@@ -460,7 +520,7 @@ char *tui_read_line(void) {
                 break;
 
             case KEY_CHAR:
-                editor_insert(key.ch);
+                editor_insert(key.ch, key.len);
                 break;
 
             case KEY_BACKSPACE:
@@ -514,6 +574,21 @@ char *tui_read_line(void) {
                 tui_draw_frame();
                 break;
 
+            case KEY_PAGE_UP:
+                tui_result_scroll(-1);
+                break;
+
+            case KEY_PAGE_DOWN:
+                tui_result_scroll(1);
+                break;
+
+            case KEY_CTRL_F:
+                /* Search the RESULT panel for the text typed so far */
+                if (tui_result_search(editor.buf) < 0) {
+                    printf("\a");
+                }
+                break;
+
             case KEY_TAB:
             case KEY_ESCAPE:
                 /* Ignore for now */
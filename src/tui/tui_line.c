@@ -0,0 +1,345 @@
+/*
+ * shelli - Educational Shell
+ * tui/tui_line.c - Line and null renderers
+ *
+ * "line" prints a prompt and one summary line per stage into the normal
+ * scrollback, followed by the command's output: a few hundred bytes per
+ * command instead of a repainted screen, for slow or high-latency links.
+ * "null" prints the command's output and nothing else.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tui.h"
+
+/* Unknown-total progress is redrawn at most this often */
+#define PROGRESS_INTERVAL_MS 100
+
+/* Raw mode turns off output processing, so a tty needs the CR itself */
+static const char *eol = "\n";
+static int color = 0;
+
+static int input_open = 0;      /* Cursor is still on the prompt line */
+static int progress_open = 0;   /* Cursor is on a progress line */
+
+/* Lines of the current output store already printed */
+static OutBuf *shown_src = NULL;
+static uint64_t shown = 0;
+
+/* Per-command summary */
+static int event_count[EXEC_EV_COUNT];
+static struct timespec exec_start;
+
+static const char *dim(void) {
+    return color ? FG_OVERLAY : "";
+}
+
+static const char *reset(void) {
+    return color ? COL_RESET : "";
+}
+
+/*
+ * Finish whatever line the cursor was left on
+ */
+static void close_line(void) {
+    if (input_open || progress_open) {
+        printf("%s", eol);
+        input_open = 0;
+        progress_open = 0;
+    }
+}
+
+/*
+ * Print a dimmed "  · stage  text" summary line
+ */
+static void summary(const char *stage, const char *fmt, ...) {
+    va_list ap;
+
+    close_line();
+    printf("%s  \302\267 %-6s ", dim(), stage);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("%s%s", reset(), eol);
+    fflush(stdout);
+}
+
+/*
+ * Print lines [shown, upto) of output
+ */
+static void print_lines(OutBuf *output, uint64_t upto) {
+    if (output != shown_src) {
+        shown_src = output;
+        shown = 0;
+    }
+    if (shown >= upto) return;
+
+    close_line();
+    for (; shown < upto; shown++) {
+        uint64_t off, len;
+        if (outbuf_line_span(output, shown, &off, &len) < 0) break;
+
+        /* Whole lines, however long: a pipe gets the output unclipped */
+        while (len > 0) {
+            size_t avail;
+            const char *text = outbuf_read(output, off, len < OUTBUF_LINE_MAX ? (size_t)len
+                                                                             : OUTBUF_LINE_MAX, &avail);
+            if (!text || avail == 0) break;
+            fwrite(text, 1, avail, stdout);
+            off += avail;
+            len -= avail;
+        }
+        printf("%s", eol);
+    }
+    fflush(stdout);
+}
+
+/*
+ * Print a running command's completed lines as they arrive
+ */
+static void stream_output(OutBuf *output) {
+    uint64_t lines = outbuf_line_count(output);
+    if (!outbuf_at_line_start(output) && lines > 0) lines--;
+    print_lines(output, lines);
+}
+
+static void line_enter(void) {
+    eol = isatty(STDOUT_FILENO) ? "\r\n" : "\n";
+    color = isatty(STDOUT_FILENO);
+    input_open = 0;
+    progress_open = 0;
+
+    /* Switched to while a command runs: summarize from here on */
+    memset(event_count, 0, sizeof(event_count));
+    clock_gettime(CLOCK_MONOTONIC, &exec_start);
+}
+
+static void line_leave(void) {
+    close_line();
+    fflush(stdout);
+}
+
+/*
+ * Redraw the prompt line in place
+ */
+static void line_render_input(const char *line, int cursor_pos) {
+    if (!input_open) close_line();
+
+    printf("\r" FG_PINK "\342\235\257 " COL_RESET "%s" CSI "K\r", line);
+    printf(CSI "%dC", 2 + text_columns(line, (size_t)cursor_pos));
+    fflush(stdout);
+    input_open = 1;
+}
+
+static void line_stage_begin(TuiStage stage) {
+    if (stage == STAGE_EXECUTE) {
+        clock_gettime(CLOCK_MONOTONIC, &exec_start);
+    }
+}
+
+static void line_show_tokens(TokenList *tokens) {
+    summary("lex", "%d token%s", tokens->count, tokens->count == 1 ? "" : "s");
+}
+
+static void line_show_list(CommandList *list) {
+    int commands = 0;
+
+    if (!list) return;
+    for (int i = 0; i < list->count; i++) {
+        commands += list->entries[i].pipeline->cmd_count;
+    }
+    summary("parse", "%d pipeline%s, %d command%s",
+            list->count, list->count == 1 ? "" : "s",
+            commands, commands == 1 ? "" : "s");
+}
+
+static void line_show_pipeline(Pipeline *pipeline) {
+    if (!pipeline) return;
+    summary("parse", "1 pipeline, %d command%s",
+            pipeline->cmd_count, pipeline->cmd_count == 1 ? "" : "s");
+}
+
+static void line_log_event(const ExecEvent *ev) {
+    if (ev->type < EXEC_EV_COUNT) event_count[ev->type]++;
+}
+
+/*
+ * One progress line, redrawn in place when the shown value changes
+ */
+static void line_show_progress(const char *label, long done, long total) {
+    static int last_pct = -1;
+    static struct timespec last;
+    struct timespec now;
+
+    if (total > 0) {
+        int pct = (int)(done * 100 / total);
+        if (progress_open && pct == last_pct) return;
+        last_pct = pct;
+    } else {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_ms = (now.tv_sec - last.tv_sec) * 1000 + (now.tv_nsec - last.tv_nsec) / 1000000;
+        if (progress_open && elapsed_ms < PROGRESS_INTERVAL_MS) return;
+        last = now;
+    }
+
+    if (input_open) close_line();
+    printf("\r%s  \302\267 %-6s ", dim(), label);
+    if (total > 0) {
+        printf("%ld/%ld (%d%%)", done, total, last_pct);
+    } else {
+        printf("%ld", done);
+    }
+    printf("%s%s", reset(), color ? CSI "K" : "");
+    fflush(stdout);
+    progress_open = 1;
+}
+
+/*
+ * Print the rest of the output and what it took to produce it
+ */
+static void line_show_output(int exit_code, OutBuf *output) {
+    struct timespec now;
+
+    print_lines(output, outbuf_line_count(output));
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double ms = (now.tv_sec - exec_start.tv_sec) * 1000.0 + (now.tv_nsec - exec_start.tv_nsec) / 1e6;
+    int builtins = event_count[EXEC_EV_BUILTIN] + event_count[EXEC_EV_THREAD];
+
+    summary("exec", "%d fork%s, %d pipe%s, %d builtin%s \342\206\222 exit %d (%.1f ms)",
+            event_count[EXEC_EV_FORK], event_count[EXEC_EV_FORK] == 1 ? "" : "s",
+            event_count[EXEC_EV_PIPE], event_count[EXEC_EV_PIPE] == 1 ? "" : "s",
+            builtins, builtins == 1 ? "" : "s", exit_code, ms);
+}
+
+static void line_show_result(int exit_code, const char *output) {
+    (void)exit_code;
+    close_line();
+    if (output && output[0]) printf("%s%s", output, eol);
+    fflush(stdout);
+}
+
+static void line_show_error(const char *message) {
+    close_line();
+    printf("%s\357\200\215 %s%s%s", color ? FG_RED : "", message, reset(), eol);
+    fflush(stdout);
+}
+
+/*
+ * The command is echoed only when it was not typed at the prompt; notes
+ * for the other panels become summary lines
+ */
+static void line_update_panel(PanelId panel, const char *content) {
+    if (panel == PANEL_INPUT) {
+        if (input_open) {
+            close_line();
+        } else {
+            printf("%s\342\235\257 %s%s%s", color ? FG_PINK : "", reset(), content, eol);
+        }
+        fflush(stdout);
+        return;
+    }
+    summary(panel == PANEL_TOKENIZE ? "lex" : panel == PANEL_PARSE ? "parse" : "exec",
+            "%s", content);
+}
+
+static void line_clear_all_panels(void) {
+    memset(event_count, 0, sizeof(event_count));
+    shown_src = NULL;
+    shown = 0;
+}
+
+static void line_wait_step(const char *step_name) {
+    if (!tui_is_debug()) return;
+
+    close_line();
+    printf("%s[debug] %s - press Enter%s", color ? FG_YELLOW : "", step_name, reset());
+    fflush(stdout);
+
+    char c;
+    while (read(STDIN_FILENO, &c, 1) == 1) {
+        if (c == '\r' || c == '\n') break;
+    }
+    printf("%s", eol);
+    fflush(stdout);
+}
+
+const TuiRenderer tui_renderer_line = {
+    "line",
+    line_enter,
+    line_leave,
+    NULL,                       /* splash */
+    NULL,                       /* draw_frame */
+    line_render_input,
+    line_stage_begin,
+    NULL,                       /* stage_end */
+    line_show_tokens,
+    line_show_pipeline,
+    line_show_list,
+    line_log_event,
+    line_show_progress,
+    stream_output,
+    line_show_output,
+    line_show_result,
+    line_show_error,
+    line_update_panel,
+    NULL,                       /* clear_panel */
+    line_clear_all_panels,
+    NULL,                       /* result_scroll */
+    NULL,                       /* result_search */
+    line_wait_step,
+};
+
+/*
+ * Null renderer: output goes to stdout as the command produced it (less
+ * anything the parser dropped), errors to stderr
+ */
+static void null_enter(void) {
+    eol = isatty(STDOUT_FILENO) ? "\r\n" : "\n";
+    color = 0;
+    input_open = 0;
+    progress_open = 0;
+}
+
+static void null_show_output(int exit_code, OutBuf *output) {
+    (void)exit_code;
+    print_lines(output, outbuf_line_count(output));
+}
+
+static void null_show_error(const char *message) {
+    fprintf(stderr, "shelli: %s%s", message, eol);
+}
+
+static void null_clear_all_panels(void) {
+    shown_src = NULL;
+    shown = 0;
+}
+
+const TuiRenderer tui_renderer_null = {
+    "null",
+    null_enter,
+    NULL,                       /* leave */
+    NULL,                       /* splash */
+    NULL,                       /* draw_frame */
+    NULL,                       /* render_input */
+    NULL,                       /* stage_begin */
+    NULL,                       /* stage_end */
+    NULL,                       /* show_tokens */
+    NULL,                       /* show_pipeline */
+    NULL,                       /* show_list */
+    NULL,                       /* log_event */
+    NULL,                       /* show_progress */
+    stream_output,
+    null_show_output,
+    NULL,                       /* show_result */
+    null_show_error,
+    NULL,                       /* update_panel */
+    NULL,                       /* clear_panel */
+    null_clear_all_panels,
+    NULL,                       /* result_scroll */
+    NULL,                       /* result_search */
+    NULL,                       /* wait_step */
+};
@@ -65,36 +65,11 @@ int logo_get_height(void) {
     return LOGO_HEIGHT;
 }
 
-/*
- * Calculate visible string length (excluding ANSI escape codes)
- */
-static int visible_length(const char *s) {
-    int len = 0;
-    int in_escape = 0;
-
-    while (*s) {
-        if (*s == '\033') {
-            in_escape = 1;
-        } else if (in_escape) {
-            if (*s == 'm') {
-                in_escape = 0;
-            }
-        } else {
-            /* Count UTF-8 characters correctly */
-            if ((*s & 0xC0) != 0x80) {
-                len++;
-            }
-        }
-        s++;
-    }
-    return len;
-}
-
 /*
  * Draw centered text
  */
 static void draw_centered(int row, int width, const char *text, const char *color) {
-    int text_len = visible_length(text);
+    int text_len = text_width(text);
     int col = (width - text_len) / 2;
     if (col < 1) col = 1;
 
@@ -154,14 +129,16 @@ void splash_draw(int width, int height) {
     int start_row = (height - total_height) / 2;
     if (start_row < 3) start_row = 3;
 
-    /* Draw glow border around logo */
+    /* Draw glow border around logo (skipped on a slow terminal) */
     int logo_width = 52;  /* Approximate visible width of logo */
-    draw_glow_border(start_row, width, LOGO_HEIGHT, logo_width);
+    if (pace_level() >= 2) {
+        draw_glow_border(start_row, width, LOGO_HEIGHT, logo_width);
+    }
 
     /* Draw logo */
     for (int i = 0; i < LOGO_HEIGHT && LOGO[i]; i++) {
         int row = start_row + i;
-        int logo_len = visible_length(LOGO[i]);
+        int logo_len = text_width(LOGO[i]);
         int col = (width - logo_len) / 2;
         if (col < 1) col = 1;
 
@@ -0,0 +1,320 @@
+/*
+ * shelli - Educational Shell
+ * tui/tui_pace.c - Adaptive animation quality from measured terminal speed
+ *
+ * A terminal answers a cursor position query (DSR, CSI 6n) only after it
+ * has consumed everything sent before it, so the round trip of a query
+ * sent right behind a frame is that frame's real cost: link latency plus
+ * drain time. The full renderer sends a first query when it takes the
+ * screen and one behind its first frame, then one behind a frame every
+ * PROBE_INTERVAL_MS. Nothing waits for a reply: it is picked out of the
+ * input by whoever reads next (the key reader, an animation pause or the
+ * next frame), so startup does not pay a round trip. The smoothed cost
+ * picks a quality level that sets animation delays, redraw interval,
+ * splash length and gradient detail. A command writing output faster
+ * than HEAVY_OUTPUT_BPS caps the level until the next command.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include "tui.h"
+
+#define PROBE_INTERVAL_MS   2000
+#define PROBE_TIMEOUT_MS    1000
+#define HEAVY_OUTPUT_BPS    (2 * 1024 * 1024)
+
+/* Frame cost (ms) below which each level is used, best first */
+static const double level_cost_ms[PACE_LEVEL_MAX] = {20.0, 60.0, 150.0};
+
+static const struct {
+    int anim_delay_us;      /* Pause between animated panel steps */
+    int frame_ms;           /* Redraw interval for following/animations */
+    int splash_frames;
+    int gradient_stride;    /* Characters per gradient colour, 0: one colour */
+} levels[PACE_LEVEL_MAX + 1] = {
+    {     0, 125, 1, 0},
+    { 30000,  66, 1, 4},
+    { 80000,  33, 3, 2},
+    {150000,  16, 5, 1},
+};
+
+static int probing = 0;             /* Queries are being sent */
+static int answered = 0;            /* Replies received so far */
+static double cost_ms = -1.0;       /* Smoothed frame cost, -1: unknown */
+static double rtt_ms = -1.0;        /* Round trip of the first, empty query */
+
+/* Outstanding query */
+static int outstanding = 0;
+static struct timespec sent_at;
+static struct timespec checked_at;  /* Last look for the reply */
+static struct timespec last_probe;
+static char reply[16];
+static int reply_len = 0;
+
+/* Input that arrived while a reply was awaited, for the line editor;
+ * grows so a paste during a long reveal is kept whole */
+static char *pending = NULL;
+static size_t pending_cap = 0, pending_head = 0, pending_len = 0;
+
+/* Output rate of the running command */
+static struct timespec command_start;
+static int heavy = 0;
+
+static double ms_since(const struct timespec *t) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - t->tv_sec) * 1000.0 + (now.tv_nsec - t->tv_nsec) / 1e6;
+}
+
+static void pending_push(const char *data, int len) {
+    if (len <= 0) return;
+    if (pending_head + pending_len + (size_t)len > pending_cap) {
+        memmove(pending, pending + pending_head, pending_len);
+        pending_head = 0;
+        if (pending_len + (size_t)len > pending_cap) {
+            size_t cap = pending_cap ? pending_cap : 64;
+            while (cap < pending_len + (size_t)len) cap *= 2;
+            char *grown = realloc(pending, cap);
+            if (!grown) return;     /* Out of memory: the keys are lost */
+            pending = grown;
+            pending_cap = cap;
+        }
+    }
+    memcpy(pending + pending_head + pending_len, data, (size_t)len);
+    pending_len += (size_t)len;
+}
+
+static void send_query(void) {
+    printf(CSI "6n");
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &sent_at);
+    checked_at = sent_at;
+    last_probe = sent_at;
+    outstanding = 1;
+    reply_len = 0;
+}
+
+/*
+ * Read what has arrived (waiting up to timeout_ms, or until something
+ * is typed) and pick the reply (ESC [ row ; col R) out of it. Returns
+ * the round trip in ms, or -1 if the reply is not complete yet.
+ */
+static double collect(int timeout_ms) {
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    struct timespec start;
+    char buf[64];
+    int wait = timeout_ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (outstanding && poll(&pfd, 1, wait) > 0) {
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n <= 0) break;
+
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buf[i];
+            int fits = reply_len == 0 ? c == '\033' :
+                       reply_len == 1 ? c == '[' :
+                       (c >= '0' && c <= '9') || c == ';' || c == 'R';
+
+            if (!fits || reply_len >= (int)sizeof(reply)) {
+                /* Not a reply after all: it was typed */
+                pending_push(reply, reply_len);
+                reply_len = 0;
+                if (c != '\033') {
+                    pending_push(&c, 1);
+                    continue;
+                }
+            }
+            reply[reply_len++] = c;
+
+            if (c == 'R' && reply_len > 3) {
+                outstanding = 0;
+                reply_len = 0;
+                pending_push(buf + i + 1, (int)(n - i - 1));
+                return ms_since(&sent_at);
+            }
+        }
+        if (pending_len > 0) break;     /* Typing is waiting */
+        wait = timeout_ms - (int)ms_since(&start);
+        if (wait < 0) wait = 0;
+    }
+    return -1.0;
+}
+
+static void add_sample(double ms) {
+    cost_ms = cost_ms < 0 ? ms : 0.7 * cost_ms + 0.3 * ms;
+}
+
+/*
+ * A reply took ms: the first one (sent with nothing ahead of it) is the
+ * bare round trip, the rest are frame costs
+ */
+static void got_reply(double ms) {
+    if (answered++ == 0) rtt_ms = ms;
+    add_sample(ms);
+}
+
+/*
+ * Give up on a reply that is overdue; a terminal that never answered
+ * does not support the query, so stop asking
+ */
+static void expire(void) {
+    if (outstanding && ms_since(&sent_at) > PROBE_TIMEOUT_MS) {
+        outstanding = 0;
+        if (answered == 0) probing = 0;
+    }
+}
+
+/*
+ * Start measuring the terminal (raw mode, full screen): sends the first
+ * query and returns at once
+ */
+void pace_start(void) {
+    if (probing || !isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) return;
+    probing = 1;
+    send_query();
+}
+
+/*
+ * Called after each frame is flushed: finish or start a query. A reply
+ * found here arrived some time since the last look, so it only counts
+ * when that look was recent enough to date it.
+ */
+void pace_frame(void) {
+    if (!probing) return;
+
+    if (outstanding) {
+        double window = ms_since(&checked_at);
+        double ms = collect(0);
+        clock_gettime(CLOCK_MONOTONIC, &checked_at);
+        if (ms >= 0) {
+            if (window <= 2.0 || window <= ms / 4) got_reply(ms);
+        } else {
+            expire();
+        }
+        return;
+    }
+    if (answered < 2 || ms_since(&last_probe) >= PROBE_INTERVAL_MS) {
+        send_query();
+    }
+}
+
+/*
+ * Check whether a reply is awaited
+ */
+int pace_waiting(void) {
+    return outstanding;
+}
+
+/*
+ * Read input for up to timeout_ms (-1: until the reply is overdue),
+ * timing the reply if it comes; typed bytes go to pace_pending_byte
+ */
+void pace_poll(int timeout_ms) {
+    if (!outstanding) return;
+
+    int left = (int)(PROBE_TIMEOUT_MS - ms_since(&sent_at));
+    if (left < 0) left = 0;
+    double ms = collect(timeout_ms >= 0 && timeout_ms < left ? timeout_ms : left);
+    clock_gettime(CLOCK_MONOTONIC, &checked_at);
+    if (ms >= 0) {
+        got_reply(ms);
+    } else {
+        expire();
+    }
+}
+
+/*
+ * Sleep for us microseconds, watching for the reply meanwhile so its
+ * arrival is timed exactly
+ */
+void pace_pause(int us) {
+    struct timespec start;
+
+    if (us <= 0) return;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pace_poll(us / 1000);
+
+    double left_us = us - ms_since(&start) * 1000.0;
+    if (left_us > 0) usleep((useconds_t)left_us);
+}
+
+/*
+ * Wait for an outstanding reply before reading input directly, so it is
+ * not taken for typing
+ */
+void pace_settle(void) {
+    while (outstanding) pace_poll(-1);
+}
+
+/*
+ * Next byte typed while a reply was awaited, or -1
+ */
+int pace_pending_byte(void) {
+    if (pending_len == 0) return -1;
+
+    unsigned char c = (unsigned char)pending[pending_head++];
+    if (--pending_len == 0) pending_head = 0;
+    return c;
+}
+
+void pace_command_begin(void) {
+    clock_gettime(CLOCK_MONOTONIC, &command_start);
+    heavy = 0;
+}
+
+/*
+ * Note how much the running command has written so far
+ */
+void pace_output(uint64_t bytes) {
+    double ms = ms_since(&command_start);
+    if (ms > 100.0 && bytes / ms * 1000.0 > HEAVY_OUTPUT_BPS) {
+        heavy = 1;
+    }
+}
+
+int pace_level(void) {
+    int level = PACE_LEVEL_MAX;
+
+    if (cost_ms >= 0) {
+        while (level > 0 && cost_ms >= level_cost_ms[PACE_LEVEL_MAX - level]) {
+            level--;
+        }
+    }
+    if (heavy && level > 1) level = 1;
+    return level;
+}
+
+int pace_anim_delay_us(void) {
+    return levels[pace_level()].anim_delay_us;
+}
+
+int pace_frame_ms(void) {
+    return levels[pace_level()].frame_ms;
+}
+
+int pace_splash_frames(void) {
+    return levels[pace_level()].splash_frames;
+}
+
+int pace_gradient_stride(void) {
+    return levels[pace_level()].gradient_stride;
+}
+
+/*
+ * Describe the measurements, e.g. for the renderer builtin
+ */
+void pace_describe(char *buf, size_t size) {
+    if (answered == 0) {
+        snprintf(buf, size, "quality %d/%d, terminal %s",
+                 pace_level(), PACE_LEVEL_MAX, probing ? "being measured" : "not measured");
+        return;
+    }
+    snprintf(buf, size, "quality %d/%d, frame %.1f ms, rtt %.1f ms%s",
+             pace_level(), PACE_LEVEL_MAX, cost_ms, rtt_ms,
+             heavy ? ", heavy output" : "");
+}
@@ -1,36 +1,150 @@
 /*
  * shelli - Educational Shell
- * tui/tui_render.c - Double-buffered rendering engine
+ * tui/tui_render.c - Full-screen renderer (the framed stage panels)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <unistd.h>
+#include <time.h>
 #include "tui.h"
 
+#define MAX_LINE_LEN 512    /* Longest formatted message line */
+
 /*
- * Panel content buffers
+ * Panel content: lines packed end to end in one byte arena and found
+ * through an offset/length array. Both grow on demand, so a panel has
+ * no line limit, and clearing just resets the counts.
  */
-#define MAX_PANEL_LINES 32
-#define MAX_LINE_LEN 512
-
-static char input_content[MAX_LINE_LEN] = "";
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} PanelSpan;
+
+typedef struct {
+    char *bytes;        /* Line text (not NUL-terminated) */
+    size_t used;
+    size_t cap;
+    PanelSpan *lines;
+    int count;
+    int line_cap;
+} PanelLines;
+
+static PanelLines input_line;
 static int input_cursor = 0;
 
-static char tokenize_lines[MAX_PANEL_LINES][MAX_LINE_LEN];
-static int tokenize_count = 0;
+static PanelLines tokenize_lines;
+static PanelLines parse_lines;
 
-static char parse_lines[MAX_PANEL_LINES][MAX_LINE_LEN];
-static int parse_count = 0;
-
-static char exec_lines[MAX_PANEL_LINES][MAX_LINE_LEN];
+/* EXECUTE keeps the trace events themselves; only drawn rows are formatted */
+static ExecEvent *exec_events = NULL;
 static int exec_count = 0;
+static int exec_cap = 0;
+
+/* The newest line of a panel (or EXECUTE event) while a tween reveals it:
+ * frames drawn meanwhile leave its row blank */
+static const PanelLines *reveal_panel = NULL;
+static int reveal_line = -1;
+static int reveal_event = -1;
+
+/* Progress of a long-running builtin, shown on the last EXECUTE row */
+static char progress_label[32] = "";
+static long progress_done = 0;
+static long progress_total = 0;
+static int progress_active = 0;
+
+/*
+ * RESULT shows a window of RESULT_ROWS lines over an output store, so
+ * output of any size costs only the lines on screen to draw
+ */
+#define RESULT_ROWS 4
 
-static char result_lines[MAX_PANEL_LINES][MAX_LINE_LEN];
-static int result_count = 0;
+static OutBuf *result_own = NULL;    /* Messages and errors */
+static OutBuf *result_src = NULL;    /* Store shown (NULL: empty panel) */
+static uint64_t result_top = 0;      /* First visible line */
+static int64_t result_match = -1;    /* Line of the last search hit */
 static int result_exit_code = 0;
 
+/*
+ * Make room for one more line of at least bytes bytes
+ */
+static int panel_reserve(PanelLines *p, size_t bytes) {
+    if (p->count == p->line_cap) {
+        int cap = p->line_cap ? p->line_cap * 2 : 16;
+        PanelSpan *lines = realloc(p->lines, (size_t)cap * sizeof(PanelSpan));
+        if (!lines) return -1;
+        p->lines = lines;
+        p->line_cap = cap;
+    }
+    if (p->used + bytes > p->cap) {
+        size_t cap = p->cap ? p->cap : 1024;
+        while (cap < p->used + bytes) cap *= 2;
+        char *b = realloc(p->bytes, cap);
+        if (!b) return -1;
+        p->bytes = b;
+        p->cap = cap;
+    }
+    return 0;
+}
+
+/*
+ * Append a formatted line, written straight into the arena
+ */
+static void panel_addf(PanelLines *p, const char *fmt, ...) {
+    va_list args;
+    char *dst = p->bytes ? p->bytes + p->used : NULL;
+
+    va_start(args, fmt);
+    int n = vsnprintf(dst, p->cap - p->used, fmt, args);
+    va_end(args);
+    if (n < 0) return;
+
+    if ((size_t)n >= p->cap - p->used || p->count == p->line_cap) {
+        /* Out of room: grow, then format again */
+        if (panel_reserve(p, (size_t)n + 1) < 0) return;
+        va_start(args, fmt);
+        vsnprintf(p->bytes + p->used, p->cap - p->used, fmt, args);
+        va_end(args);
+    }
+
+    p->lines[p->count].off = (uint32_t)p->used;
+    p->lines[p->count].len = (uint32_t)n;
+    p->count++;
+    p->used += (size_t)n;
+}
+
+static void panel_add(PanelLines *p, const char *text) {
+    panel_addf(p, "%s", text);
+}
+
+static void panel_clear(PanelLines *p) {
+    p->used = 0;
+    p->count = 0;
+}
+
+/*
+ * Print line idx of a panel showing its last rows lines (the newest
+ * stay in view), if there is one for that row
+ */
+static void print_panel_row(const PanelLines *p, int rows, int row) {
+    int first = p->count > rows ? p->count - rows : 0;
+    int idx = first + row;
+    if (idx < p->count && !(p == reveal_panel && idx == reveal_line)) {
+        printf("%.*s", (int)p->lines[idx].len, p->bytes + p->lines[idx].off);
+    }
+}
+
+/*
+ * Footer text counting the lines scrolled out of a panel (NULL if none)
+ */
+static const char *panel_hidden_text(int count, int rows, char *buf, size_t size) {
+    if (count <= rows) return NULL;
+    snprintf(buf, size, "+%d earlier", count - rows);
+    return buf;
+}
+
 /* Current stage */
 static TuiStage current_stage = STAGE_INPUT;
 static int stage_completed[STAGE_COUNT] = {0};
@@ -38,9 +152,14 @@ static int stage_completed[STAGE_COUNT] = {0};
 /* Debug mode */
 static int debug_mode = 0;
 
-/* External function from tui_core.c */
+/* External functions from tui_core.c */
 int term_get_width(void);
 int term_get_height(void);
+void term_alt_screen(int on);
+void splash_run(void);
+
+/* External function from tui_widgets.c */
+void widget_progress(int x, int y, int width, double percent, int color);
 
 /*
  * Box drawing characters - Light (for inner panels)
@@ -147,6 +266,29 @@ static void draw_heavy_empty_row(int row, int width) {
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 }
 
+/*
+ * Draw the progress row inside the EXECUTE panel: label, bar, counts
+ */
+static void draw_progress_row(int row, int width) {
+    char counts[48];
+    double percent = 0.0;
+
+    if (progress_total > 0) {
+        percent = (double)progress_done / progress_total;
+        snprintf(counts, sizeof(counts), "%ld/%ld", progress_done, progress_total);
+    } else {
+        snprintf(counts, sizeof(counts), "%ld done", progress_done);
+    }
+
+    int label_len = text_width(progress_label);
+    int bar_width = width - 12 - label_len - (int)strlen(counts);
+    if (bar_width < 4) bar_width = 4;
+
+    printf(FG_LAVENDER "%s" COL_RESET " ", progress_label);
+    widget_progress(8 + label_len, row, bar_width, percent, COL_NEON_PURPLE);
+    printf(" " FG_SUBTEXT "%s" COL_RESET, counts);
+}
+
 /*
  * Neon accent colors for enhanced visuals
  */
@@ -283,7 +425,7 @@ static void draw_box_header(int row, int col, int width, const char *label) {
     printf(CSI "38;5;%dm%s " COL_RESET, label_color, icon);
     printf(CSI "38;5;%dm%s" COL_RESET, label_color, label);
     printf(FG_OVERLAY " " COL_RESET);
-    int label_len = (int)strlen(label) + 3;  /* icon + space + label */
+    int label_len = text_width(label) + 3;  /* icon + space + label */
     int remaining = width - label_len - 5;
     if (remaining > 0) {
         print_hline(remaining);
@@ -291,6 +433,41 @@ static void draw_box_header(int row, int col, int width, const char *label) {
     printf(FG_OVERLAY "%s" COL_RESET, BOX_TR);
 }
 
+/*
+ * Print at most width columns of a line, returns the columns used. A
+ * character is never split: a wide one that does not fit is left out.
+ * Escape sequences pass through; other control bytes print as spaces.
+ */
+static int print_clipped(const char *s, size_t len, int width) {
+    int cols = 0;
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = (unsigned char)s[i];
+        size_t esc = text_escape_len(s + i, len - i);
+        if (esc > 0) {
+            fwrite(s + i, 1, esc, stdout);
+            i += esc;
+            continue;
+        }
+        if (c < 0x20 || c == 0x7f) {
+            if (cols == width) break;
+            putchar(' ');
+            cols++;
+            i++;
+            continue;
+        }
+
+        int w;
+        size_t n = grapheme_next(s + i, len - i, &w);
+        if (cols + w > width) break;
+        fwrite(s + i, 1, n, stdout);
+        cols += w;
+        i += n;
+    }
+    printf(COL_RESET);
+    return cols;
+}
+
 /*
  * Draw a box footer (optionally with right-aligned text)
  */
@@ -299,7 +476,7 @@ static void draw_box_footer(int row, int col, int width, const char *right_text)
     printf(FG_OVERLAY "%s" COL_RESET, BOX_BL);
 
     if (right_text && right_text[0]) {
-        int text_len = (int)strlen(right_text);
+        int text_len = text_width(right_text);
         int fill = width - text_len - 4;
         if (fill > 0) {
             print_hline(fill);
@@ -331,6 +508,12 @@ static void draw_glow_footer(int row, int width) {
     printf(CSI "38;5;%dm[\342\206\221\342\206\223]" COL_RESET " ", COL_NEON_PURPLE);
     printf(FG_SUBTEXT "history  " COL_RESET);
 
+    printf(CSI "38;5;%dm[PgUp/PgDn]" COL_RESET " ", COL_NEON_CYAN);
+    printf(FG_SUBTEXT "scroll  " COL_RESET);
+
+    printf(CSI "38;5;%dm[^F]" COL_RESET " ", COL_NEON_PURPLE);
+    printf(FG_SUBTEXT "find  " COL_RESET);
+
     printf(CSI "38;5;%dm[^L]" COL_RESET " ", COL_NEON_PINK);
     printf(FG_SUBTEXT "clear  " COL_RESET);
 
@@ -346,10 +529,105 @@ static void draw_glow_footer(int row, int width) {
     printf(CSI "38;5;%dm%s" COL_RESET, COL_OVERLAY, GLOW_1);
 }
 
+/*
+ * Format EXECUTE event idx as its row shows it
+ */
+static int format_exec_row(int idx, char *out, size_t size) {
+    /* Spinner prefix with neon lavender color */
+    char line[256];
+    exec_event_format(&exec_events[idx], line, sizeof(line));
+    return snprintf(out, size, CSI "38;5;%dm%s" COL_RESET " " CSI "38;5;%dm%s" COL_RESET " %s",
+                    COL_LAVENDER, tui_spinner_frame(idx), COL_NEON_PURPLE, TREE_RARROW, line);
+}
+
+/*
+ * Print row row of EXECUTE showing its last rows events, formatting
+ * just that event
+ */
+static void print_exec_row(int rows, int row) {
+    int first = exec_count > rows ? exec_count - rows : 0;
+    int idx = first + row;
+    if (idx >= exec_count || idx == reveal_event) return;
+
+    char text[512];
+    format_exec_row(idx, text, sizeof(text));
+    printf("%s", text);
+}
+
+/*
+ * Append a trace event to EXECUTE
+ */
+static void exec_push(const ExecEvent *ev) {
+    if (exec_count == exec_cap) {
+        int cap = exec_cap ? exec_cap * 2 : 32;
+        ExecEvent *events = realloc(exec_events, (size_t)cap * sizeof(ExecEvent));
+        if (!events) return;
+        exec_events = events;
+        exec_cap = cap;
+    }
+    exec_events[exec_count++] = *ev;
+}
+
+/*
+ * Draw the RESULT content rows and footer: the visible window of the
+ * output store, its position and the exit code. Rows are padded to the
+ * border, so this also redraws in place when scrolling.
+ */
+static void draw_result_panel(int w) {
+    uint64_t total = result_src ? outbuf_line_count(result_src) : 0;
+    int width = w - 9;
+
+    /* Rows 25-28: RESULT content */
+    for (int r = 0; r < RESULT_ROWS; r++) {
+        uint64_t idx = result_top + (uint64_t)r;
+        int used = 0;
+
+        move_to(25 + r, 1);
+        printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
+        printf("   " FG_OVERLAY "%s" COL_RESET " ", BOX_V);
+
+        if (idx < total) {
+            size_t len;
+            const char *line = outbuf_line(result_src, idx, &len);
+            if ((int64_t)idx == result_match) {
+                printf(CSI "48;5;%dm" FG_YELLOW, COL_SURFACE);
+            } else {
+                printf(FG_TEXT);
+            }
+            used = print_clipped(line, len, width);
+        }
+        if (width > used) printf("%*s", width - used, "");
+
+        move_to(25 + r, w - 3);
+        printf(FG_OVERLAY "%s" COL_RESET, BOX_V);
+        move_to(25 + r, w);
+        printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
+    }
+
+    /* Row 29: RESULT footer with the visible range and exit code */
+    char footer[128];
+    int n = 0;
+    if (total > RESULT_ROWS) {
+        uint64_t last = result_top + RESULT_ROWS < total ? result_top + RESULT_ROWS : total;
+        n = snprintf(footer, sizeof(footer), FG_SUBTEXT "lines %llu-%llu/%llu%s" COL_RESET "  ",
+                     (unsigned long long)result_top + 1, (unsigned long long)last,
+                     (unsigned long long)total, outbuf_spilled(result_src) ? " (disk)" : "");
+    }
+    int status_color = (result_exit_code == 0) ? COL_MATRIX_GREEN : COL_RED;
+    snprintf(footer + n, sizeof(footer) - (size_t)n, CSI "38;5;%dmexit: %d" COL_RESET,
+             status_color, result_exit_code);
+    move_to(29, 1);
+    printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
+    printf("   ");
+    draw_box_footer(29, 4, w - 6, footer);
+    move_to(29, w);
+    printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
+}
+
 /*
  * Draw the complete frame with ultra-aesthetic design
  */
-void tui_draw_frame(void) {
+static void full_draw_frame(void) {
     int w, h;
     tui_get_size(&w, &h);
 
@@ -386,13 +664,10 @@ void tui_draw_frame(void) {
     print_heavy_hline(3);
 
     /* Gradient "shelli" title */
+    static const int title_colors[] = {COL_NEON_PINK, COL_NEON_PURPLE, COL_LAVENDER,
+                                       COL_BLUE, COL_NEON_CYAN, COL_TEAL};
     printf(" ");
-    printf(CSI "38;5;%dms" COL_RESET, COL_NEON_PINK);
-    printf(CSI "38;5;%dmh" COL_RESET, COL_NEON_PURPLE);
-    printf(CSI "38;5;%dme" COL_RESET, COL_LAVENDER);
-    printf(CSI "38;5;%dml" COL_RESET, COL_BLUE);
-    printf(CSI "38;5;%dml" COL_RESET, COL_NEON_CYAN);
-    printf(CSI "38;5;%dmi" COL_RESET, COL_TEAL);
+    print_gradient_custom("shelli", title_colors, 6);
     printf(" ");
 
     /* Decorative diamond */
@@ -422,7 +697,9 @@ void tui_draw_frame(void) {
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
     printf("   " FG_OVERLAY "%s" COL_RESET, BOX_V);
     printf(" " CSI "38;5;%dm\342\235\257" COL_RESET " ", COL_NEON_CYAN);  /* ❯ prompt in neon cyan */
-    printf(FG_TEXT "%s" COL_RESET, input_content);
+    printf(FG_TEXT);
+    print_panel_row(&input_line, 1, 0);
+    printf(COL_RESET);
     move_to(5, w - 3);
     printf(FG_OVERLAY "%s" COL_RESET, BOX_V);
     move_to(5, w);
@@ -461,7 +738,7 @@ void tui_draw_frame(void) {
     move_to(11, w);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 
-    /* Rows 12-15: TOKENS / AST content */
+    /* Rows 12-15: TOKENS / AST content (the newest lines) */
     for (int r = 12; r <= 15; r++) {
         int line_idx = r - 12;
         move_to(r, 1);
@@ -469,18 +746,14 @@ void tui_draw_frame(void) {
         printf("   " FG_OVERLAY "%s" COL_RESET " ", BOX_V);
 
         /* TOKENS content */
-        if (line_idx < tokenize_count) {
-            printf("%s", tokenize_lines[line_idx]);
-        }
+        print_panel_row(&tokenize_lines, 4, line_idx);
 
         move_to(r, split_col - 1);
         printf(FG_OVERLAY "%s" COL_RESET, BOX_V);
         printf("  " FG_OVERLAY "%s" COL_RESET " ", BOX_V);
 
         /* AST/PARSE content */
-        if (line_idx < parse_count) {
-            printf("%s", parse_lines[line_idx]);
-        }
+        print_panel_row(&parse_lines, 4, line_idx);
 
         move_to(r, w - 3);
         printf(FG_OVERLAY "%s" COL_RESET, BOX_V);
@@ -489,12 +762,15 @@ void tui_draw_frame(void) {
     }
 
     /* Row 16: TOKENS / AST footers */
+    char hidden[32];
     move_to(16, 1);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
     printf("   ");
-    draw_box_footer(16, 4, tok_width, NULL);
+    draw_box_footer(16, 4, tok_width,
+                    panel_hidden_text(tokenize_lines.count, 4, hidden, sizeof(hidden)));
     printf("  ");
-    draw_box_footer(16, split_col + 1, parse_width, NULL);
+    draw_box_footer(16, split_col + 1, parse_width,
+                    panel_hidden_text(parse_lines.count, 4, hidden, sizeof(hidden)));
     move_to(16, w);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 
@@ -509,15 +785,18 @@ void tui_draw_frame(void) {
     move_to(18, w);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 
-    /* Rows 19-21: EXECUTION content */
+    /* Rows 19-21: EXECUTION content (the progress bar takes the last row) */
+    int exec_rows = progress_active ? 2 : 3;
     for (int r = 19; r <= 21; r++) {
         int line_idx = r - 19;
         move_to(r, 1);
         printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
         printf("   " FG_OVERLAY "%s" COL_RESET " ", BOX_V);
 
-        if (line_idx < exec_count) {
-            printf("%s", exec_lines[line_idx]);
+        if (progress_active && r == 21) {
+            draw_progress_row(r, w);
+        } else {
+            print_exec_row(exec_rows, line_idx);
         }
 
         move_to(r, w - 3);
@@ -530,7 +809,7 @@ void tui_draw_frame(void) {
     move_to(22, 1);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
     printf("   ");
-    draw_box_footer(22, 4, w - 6, NULL);
+    draw_box_footer(22, 4, w - 6, panel_hidden_text(exec_count, exec_rows, hidden, sizeof(hidden)));
     move_to(22, w);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 
@@ -545,33 +824,8 @@ void tui_draw_frame(void) {
     move_to(24, w);
     printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
 
-    /* Rows 25-28: RESULT content (4 lines for output) */
-    for (int r = 25; r <= 28; r++) {
-        int line_idx = r - 25;
-        move_to(r, 1);
-        printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
-        printf("   " FG_OVERLAY "%s" COL_RESET " ", BOX_V);
-
-        if (line_idx < result_count) {
-            printf(FG_TEXT "%s" COL_RESET, result_lines[line_idx]);
-        }
-
-        move_to(r, w - 3);
-        printf(FG_OVERLAY "%s" COL_RESET, BOX_V);
-        move_to(r, w);
-        printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
-    }
-
-    /* Row 29: RESULT footer with exit code */
-    char exit_str[32];
-    int status_color = (result_exit_code == 0) ? COL_MATRIX_GREEN : COL_RED;
-    snprintf(exit_str, sizeof(exit_str), CSI "38;5;%dmexit: %d" COL_RESET, status_color, result_exit_code);
-    move_to(29, 1);
-    printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
-    printf("   ");
-    draw_box_footer(29, 4, w - 6, exit_str);
-    move_to(29, w);
-    printf(FG_OVERLAY "%s" COL_RESET, HEAVY_V);
+    /* Rows 25-29: RESULT content and footer */
+    draw_result_panel(w);
 
     /* Row 30: Empty */
     if (h >= 30) {
@@ -591,15 +845,16 @@ void tui_draw_frame(void) {
     }
 
     fflush(stdout);
+    pace_frame();
 }
 
 /*
  * Render input line with cursor (adjusted for new layout)
  */
-void render_input_line(const char *line, int cursor_pos) {
+static void full_render_input(const char *line, int cursor_pos) {
     /* Update stored content */
-    strncpy(input_content, line, MAX_LINE_LEN - 1);
-    input_content[MAX_LINE_LEN - 1] = '\0';
+    panel_clear(&input_line);
+    panel_add(&input_line, line);
     input_cursor = cursor_pos;
 
     /* Render just the input line area (row 5 in new layout) */
@@ -610,8 +865,8 @@ void render_input_line(const char *line, int cursor_pos) {
     /* Clear rest of line */
     printf(CSI "K");
 
-    /* Position cursor (adjusted for new layout: col 8 + cursor_pos) */
-    move_to(5, 8 + cursor_pos);
+    /* Position cursor: col 8 + the columns before it */
+    move_to(5, 8 + text_columns(line, (size_t)cursor_pos));
 
     fflush(stdout);
 }
@@ -619,7 +874,7 @@ void render_input_line(const char *line, int cursor_pos) {
 /*
  * Set current stage
  */
-void tui_stage_begin(TuiStage stage) {
+static void full_stage_begin(TuiStage stage) {
     current_stage = stage;
     /* Redraw stage indicator */
     int w = term_get_width();
@@ -630,7 +885,7 @@ void tui_stage_begin(TuiStage stage) {
 /*
  * Mark stage as complete
  */
-void tui_stage_end(TuiStage stage) {
+static void full_stage_end(TuiStage stage) {
     stage_completed[stage] = 1;
     /* Redraw stage indicator */
     int w = term_get_width();
@@ -638,43 +893,56 @@ void tui_stage_end(TuiStage stage) {
     fflush(stdout);
 }
 
+/*
+ * Empty the RESULT panel (the store shown belongs to its owner)
+ */
+static void result_clear(void) {
+    result_src = NULL;
+    result_top = 0;
+    result_match = -1;
+    result_exit_code = 0;
+}
+
+/*
+ * Show the panel's own store, emptied for a new message (NULL if it
+ * can't be allocated)
+ */
+static OutBuf *result_message(void) {
+    if (!result_own) {
+        result_own = outbuf_new();
+    } else {
+        outbuf_reset(result_own);
+    }
+    result_clear();
+    result_src = result_own;
+    return result_own;
+}
+
 /*
  * Clear a panel
  */
-void tui_clear_panel(PanelId panel) {
+static void full_clear_panel(PanelId panel) {
     switch (panel) {
         case PANEL_INPUT:
-            input_content[0] = '\0';
+            panel_clear(&input_line);
             input_cursor = 0;
             break;
 
         case PANEL_TOKENIZE:
-            tokenize_count = 0;
-            for (int i = 0; i < MAX_PANEL_LINES; i++) {
-                tokenize_lines[i][0] = '\0';
-            }
+            panel_clear(&tokenize_lines);
             break;
 
         case PANEL_PARSE:
-            parse_count = 0;
-            for (int i = 0; i < MAX_PANEL_LINES; i++) {
-                parse_lines[i][0] = '\0';
-            }
+            panel_clear(&parse_lines);
             break;
 
         case PANEL_EXECUTE:
+            progress_active = 0;
             exec_count = 0;
-            for (int i = 0; i < MAX_PANEL_LINES; i++) {
-                exec_lines[i][0] = '\0';
-            }
             break;
 
         case PANEL_RESULT:
-            result_count = 0;
-            result_exit_code = 0;
-            for (int i = 0; i < MAX_PANEL_LINES; i++) {
-                result_lines[i][0] = '\0';
-            }
+            result_clear();
             break;
     }
 
@@ -687,38 +955,23 @@ void tui_clear_panel(PanelId panel) {
     }
 
     /* Redraw frame to show cleared panels */
-    tui_draw_frame();
+    full_draw_frame();
 }
 
 /*
  * Clear all processing panels (TOKENIZE, PARSE, EXECUTE, RESULT) at once
- * More efficient than calling tui_clear_panel 4 times
+ * More efficient than calling full_clear_panel 4 times
  */
-void tui_clear_all_panels(void) {
-    /* Clear TOKENIZE */
-    tokenize_count = 0;
-    for (int i = 0; i < MAX_PANEL_LINES; i++) {
-        tokenize_lines[i][0] = '\0';
-    }
-
-    /* Clear PARSE */
-    parse_count = 0;
-    for (int i = 0; i < MAX_PANEL_LINES; i++) {
-        parse_lines[i][0] = '\0';
-    }
-
-    /* Clear EXECUTE */
+static void full_clear_all_panels(void) {
+    /* Clear TOKENIZE, PARSE and EXECUTE (no per-line work) */
+    panel_clear(&tokenize_lines);
+    panel_clear(&parse_lines);
+    progress_active = 0;
     exec_count = 0;
-    for (int i = 0; i < MAX_PANEL_LINES; i++) {
-        exec_lines[i][0] = '\0';
-    }
 
     /* Clear RESULT */
-    result_count = 0;
-    result_exit_code = 0;
-    for (int i = 0; i < MAX_PANEL_LINES; i++) {
-        result_lines[i][0] = '\0';
-    }
+    result_clear();
+    pace_command_begin();
 
     /* Reset stages */
     for (int i = 0; i < STAGE_COUNT; i++) {
@@ -727,76 +980,148 @@ void tui_clear_all_panels(void) {
     current_stage = STAGE_INPUT;
 
     /* Single redraw */
-    tui_draw_frame();
+    full_draw_frame();
 
     /* Small pause so user sees the cleared state */
-    usleep(100000);  /* 100ms */
+    anim_run_for(pace_anim_delay_us() * 2 / 3000);
 }
 
 /*
  * Update panel content
  */
-void tui_update_panel(PanelId panel, const char *content) {
+static void full_update_panel(PanelId panel, const char *content) {
     switch (panel) {
         case PANEL_INPUT:
-            strncpy(input_content, content, MAX_LINE_LEN - 1);
-            input_content[MAX_LINE_LEN - 1] = '\0';
+            panel_clear(&input_line);
+            panel_add(&input_line, content);
             break;
 
         case PANEL_TOKENIZE:
-            if (tokenize_count < MAX_PANEL_LINES) {
-                strncpy(tokenize_lines[tokenize_count], content, MAX_LINE_LEN - 1);
-                tokenize_lines[tokenize_count][MAX_LINE_LEN - 1] = '\0';
-                tokenize_count++;
-            }
+            panel_add(&tokenize_lines, content);
             break;
 
         case PANEL_PARSE:
-            if (parse_count < MAX_PANEL_LINES) {
-                strncpy(parse_lines[parse_count], content, MAX_LINE_LEN - 1);
-                parse_lines[parse_count][MAX_LINE_LEN - 1] = '\0';
-                parse_count++;
-            }
+            panel_add(&parse_lines, content);
             break;
 
-        case PANEL_EXECUTE:
-            if (exec_count < MAX_PANEL_LINES) {
-                strncpy(exec_lines[exec_count], content, MAX_LINE_LEN - 1);
-                exec_lines[exec_count][MAX_LINE_LEN - 1] = '\0';
-                exec_count++;
-            }
+        case PANEL_EXECUTE: {
+            ExecEvent note = {EXEC_EV_NOTE, 0, 0, 0, 0, 0, ""};
+            snprintf(note.s, sizeof(note.s), "%s", content);
+            exec_push(&note);
             break;
+        }
 
-        case PANEL_RESULT:
-            if (result_count < MAX_PANEL_LINES) {
-                strncpy(result_lines[result_count], content, MAX_LINE_LEN - 1);
-                result_lines[result_count][MAX_LINE_LEN - 1] = '\0';
-                result_count++;
+        case PANEL_RESULT: {
+            /* Lines added here go to the panel's own store */
+            OutBuf *own = result_src && result_src == result_own ? result_own : result_message();
+            if (own) {
+                outbuf_puts(own, content);
+                outbuf_append(own, "\n", 1);
             }
             break;
+        }
     }
 
-    tui_draw_frame();
+    full_draw_frame();
+}
+
+/*
+ * Pause between animated steps; shorter (or none) when the terminal is
+ * slow to take frames, see tui_pace.c. Scheduled animations keep playing.
+ */
+static void anim_pause(void) {
+    anim_run_for(pace_anim_delay_us() / 1000);
+}
+
+/* Bytes of text that fit in cols columns (escape sequences take none) */
+static size_t clip_columns(const char *text, size_t len, int cols) {
+    size_t i = 0;
+    int used = 0;
+
+    while (i < len) {
+        size_t esc = text_escape_len(text + i, len - i);
+        if (esc > 0) {
+            i += esc;
+            continue;
+        }
+        int w;
+        size_t n = grapheme_next(text + i, len - i, &w);
+        if (used + w > cols) break;
+        used += w;
+        i += n;
+    }
+    return i;
 }
 
 /*
- * Animation delay in microseconds (150ms per item)
+ * Fade a new row in at (row, col) with a tween on the animation
+ * scheduler, clipped to cols columns. Without animation (or a free
+ * animation slot) the row is just drawn.
  */
-#define ANIM_DELAY_US 150000
+static void reveal_text(const char *text, size_t len, int row, int col, int cols) {
+    size_t n = clip_columns(text, len, cols);
+    char *content = malloc(n + sizeof(COL_RESET));
+    if (!content) return;
+    memcpy(content, text, n);
+    memcpy(content + n, COL_RESET, sizeof(COL_RESET));
+
+    int ms = pace_anim_delay_us() / 1000;
+    int id = ms > 0 ? anim_create(ANIM_FADE_IN, content, col, row, ms) : -1;
+    if (id < 0) {
+        move_to(row, col);
+        printf("%s", content);
+        fflush(stdout);
+    } else {
+        anim_start(id);
+        anim_wait(id);
+        anim_destroy(id);
+    }
+    free(content);
+}
+
+/*
+ * Reveal the line just added to a panel whose rows rows start at (top,
+ * col). If it scrolled the panel the frame is redrawn first, with the
+ * new row left for the tween.
+ */
+static void reveal_panel_line(PanelLines *p, int rows, int top, int col, int cols) {
+    int idx = p->count - 1;
+    if (idx < 0) return;
+
+    if (idx >= rows) {
+        reveal_panel = p;
+        reveal_line = idx;
+        full_draw_frame();
+        reveal_panel = NULL;
+        reveal_line = -1;
+    }
+    reveal_text(p->bytes + p->lines[idx].off, p->lines[idx].len,
+                top + (idx < rows ? idx : rows - 1), col, cols);
+}
+
+/* TOKENIZE and PARSE: rows 12-15, content after the box border */
+static void reveal_tokens_line(void) {
+    int w = term_get_width();
+    reveal_panel_line(&tokenize_lines, 4, 12, 7, w / 2 - 8);
+}
+
+static void reveal_parse_line(void) {
+    int w = term_get_width();
+    reveal_panel_line(&parse_lines, 4, 12, w / 2 + 4, w - w / 2 - 7);
+}
 
 /*
  * Display tokenization results with tree-style animation
  */
-void tui_show_tokens(TokenList *tokens) {
-    tokenize_count = 0;
+static void full_show_tokens(TokenList *tokens) {
+    panel_clear(&tokenize_lines);
 
-    tui_stage_begin(STAGE_TOKENIZE);
-    tui_draw_frame();
-    usleep(ANIM_DELAY_US);  /* Pause before starting */
+    full_stage_begin(STAGE_TOKENIZE);
+    full_draw_frame();
+    anim_pause();  /* Pause before starting */
 
-    for (int i = 0; i < tokens->count && tokenize_count < MAX_PANEL_LINES; i++) {
+    for (int i = 0; i < tokens->count; i++) {
         Token *tok = &tokens->tokens[i];
-        char buf[MAX_LINE_LEN];
         const char *tree_prefix;
         int is_last = (i == tokens->count - 1);
 
@@ -804,60 +1129,42 @@ void tui_show_tokens(TokenList *tokens) {
         tree_prefix = is_last ? TREE_LAST : TREE_BRANCH;
 
         if (tok->value) {
-            snprintf(buf, sizeof(buf), FG_OVERLAY "%s" COL_RESET CSI "38;5;%dm%s" COL_RESET " \"" FG_GREEN "%s" COL_RESET "\"",
-                     tree_prefix, COL_NEON_PINK, token_type_str(tok->type), tok->value);
+            panel_addf(&tokenize_lines, FG_OVERLAY "%s" COL_RESET CSI "38;5;%dm%s" COL_RESET " \"" FG_GREEN "%s" COL_RESET "\"",
+                       tree_prefix, COL_NEON_PINK, token_type_str(tok->type), tok->value);
         } else {
-            snprintf(buf, sizeof(buf), FG_OVERLAY "%s" COL_RESET CSI "38;5;%dm%s" COL_RESET,
-                     tree_prefix, COL_NEON_PINK, token_type_str(tok->type));
+            panel_addf(&tokenize_lines, FG_OVERLAY "%s" COL_RESET CSI "38;5;%dm%s" COL_RESET,
+                       tree_prefix, COL_NEON_PINK, token_type_str(tok->type));
         }
 
-        strncpy(tokenize_lines[tokenize_count], buf, MAX_LINE_LEN - 1);
-        tokenize_lines[tokenize_count][MAX_LINE_LEN - 1] = '\0';
-        tokenize_count++;
-
         /* Animate: show each token one by one */
-        tui_draw_frame();
-        usleep(ANIM_DELAY_US);
+        reveal_tokens_line();
     }
 
-    tui_stage_end(STAGE_TOKENIZE);
-    tui_draw_frame();
-    usleep(ANIM_DELAY_US);  /* Pause after completion */
+    full_stage_end(STAGE_TOKENIZE);
+    full_draw_frame();
+    anim_pause();  /* Pause after completion */
 }
 
 /*
- * Display parse results with tree-style AST animation
+ * Append one pipeline's AST lines to the PARSE panel, numbering commands
+ * from *cmd_idx so that lists keep a running index
  */
-void tui_show_pipeline(Pipeline *pipeline) {
-    parse_count = 0;
-
-    if (!pipeline) return;
-
-    tui_stage_begin(STAGE_PARSE);
-    tui_draw_frame();
-    usleep(ANIM_DELAY_US);  /* Pause before starting */
-
+static void append_pipeline_lines(Pipeline *pipeline, int *cmd_idx) {
     /* Count total commands for tree structure */
     int total_cmds = 0;
     Command *tmp = pipeline->first;
     while (tmp) { total_cmds++; tmp = tmp->next; }
 
     /* Draw Pipeline root if multiple commands */
-    if (total_cmds > 1 && parse_count < MAX_PANEL_LINES) {
-        char buf[MAX_LINE_LEN];
-        snprintf(buf, sizeof(buf), CSI "38;5;%dm%s Pipeline" COL_RESET,
-                 COL_NEON_PURPLE, DIAMOND);
-        strncpy(parse_lines[parse_count], buf, MAX_LINE_LEN - 1);
-        parse_count++;
-        tui_draw_frame();
-        usleep(ANIM_DELAY_US);
+    if (total_cmds > 1) {
+        panel_addf(&parse_lines, CSI "38;5;%dm%s Pipeline" COL_RESET, COL_NEON_PURPLE, DIAMOND);
+        reveal_parse_line();
     }
 
     Command *cmd = pipeline->first;
-    int idx = 0;
+    int idx = *cmd_idx;
 
-    while (cmd && parse_count < MAX_PANEL_LINES) {
-        char buf[MAX_LINE_LEN];
+    while (cmd) {
         char args[MAX_LINE_LEN] = "";
         int is_last_cmd = (cmd->next == NULL);
 
@@ -871,153 +1178,265 @@ void tui_show_pipeline(Pipeline *pipeline) {
         const char *prefix = (total_cmds > 1) ?
             (is_last_cmd ? TREE_LAST : TREE_BRANCH) : "";
 
-        snprintf(buf, sizeof(buf), FG_OVERLAY "%s" COL_RESET CSI "38;5;%dmcmd[%d]:" COL_RESET " %s",
-                 prefix, COL_PEACH, idx, args);
-
-        strncpy(parse_lines[parse_count], buf, MAX_LINE_LEN - 1);
-        parse_lines[parse_count][MAX_LINE_LEN - 1] = '\0';
-        parse_count++;
+        panel_addf(&parse_lines, FG_OVERLAY "%s" COL_RESET CSI "38;5;%dmcmd[%d]:" COL_RESET " %s",
+                   prefix, COL_PEACH, idx, args);
 
         /* Animate: show command */
-        tui_draw_frame();
-        usleep(ANIM_DELAY_US);
+        reveal_parse_line();
 
         /* Tree continuation for child items */
         const char *tree_cont = (total_cmds > 1 && !is_last_cmd) ? TREE_VERT "   " : "    ";
 
         /* Show redirects with tree structure */
-        if (cmd->redir_in.type && parse_count < MAX_PANEL_LINES) {
-            snprintf(buf, sizeof(buf), "%s" CSI "38;5;%dm%s" COL_RESET " %s",
-                     tree_cont, COL_YELLOW, "\342\227\204", cmd->redir_in.filename);
-            strncpy(parse_lines[parse_count], buf, MAX_LINE_LEN - 1);
-            parse_count++;
-
-            tui_draw_frame();
-            usleep(ANIM_DELAY_US);
+        if (cmd->redir_in.type) {
+            panel_addf(&parse_lines, "%s" CSI "38;5;%dm%s" COL_RESET " %s",
+                       tree_cont, COL_YELLOW, "\342\227\204", cmd->redir_in.filename);
+
+            reveal_parse_line();
         }
-        if (cmd->redir_out.type && parse_count < MAX_PANEL_LINES) {
-            snprintf(buf, sizeof(buf), "%s" CSI "38;5;%dm%s" COL_RESET " %s %s",
-                     tree_cont, COL_YELLOW, TREE_RARROW,
-                     cmd->redir_out.type == REDIR_APPEND ? ">>" : ">",
-                     cmd->redir_out.filename);
-            strncpy(parse_lines[parse_count], buf, MAX_LINE_LEN - 1);
-            parse_count++;
-
-            tui_draw_frame();
-            usleep(ANIM_DELAY_US);
+        if (cmd->redir_out.type) {
+            panel_addf(&parse_lines, "%s" CSI "38;5;%dm%s" COL_RESET " %s %s",
+                       tree_cont, COL_YELLOW, TREE_RARROW,
+                       cmd->redir_out.type == REDIR_APPEND ? ">>" : ">",
+                       cmd->redir_out.filename);
+
+            reveal_parse_line();
         }
 
         /* Show pipe indicator with arrow */
-        if (cmd->next && parse_count < MAX_PANEL_LINES) {
-            snprintf(buf, sizeof(buf), FG_OVERLAY "%s" COL_RESET "   " CSI "38;5;%dm%s" COL_RESET " pipe",
-                     TREE_VERT, COL_NEON_CYAN, TREE_ARROW);
-            strncpy(parse_lines[parse_count], buf, MAX_LINE_LEN - 1);
-            parse_count++;
-
-            tui_draw_frame();
-            usleep(ANIM_DELAY_US);
+        if (cmd->next) {
+            panel_addf(&parse_lines, FG_OVERLAY "%s" COL_RESET "   " CSI "38;5;%dm%s" COL_RESET " pipe",
+                       TREE_VERT, COL_NEON_CYAN, TREE_ARROW);
+
+            reveal_parse_line();
         }
 
         cmd = cmd->next;
         idx++;
     }
 
-    tui_stage_end(STAGE_PARSE);
-    tui_draw_frame();
-    usleep(ANIM_DELAY_US);  /* Pause after completion */
+    *cmd_idx = idx;
 }
 
 /*
- * Log execution message with enhanced animation
+ * Display parse results with tree-style AST animation
  */
-void tui_log_exec(const char *message) {
-    if (exec_count == 0) {
-        tui_stage_begin(STAGE_EXECUTE);
-        tui_draw_frame();
-        usleep(ANIM_DELAY_US);
+static void full_show_pipeline(Pipeline *pipeline) {
+    panel_clear(&parse_lines);
+
+    if (!pipeline) return;
+
+    full_stage_begin(STAGE_PARSE);
+    full_draw_frame();
+    anim_pause();  /* Pause before starting */
+
+    int idx = 0;
+    append_pipeline_lines(pipeline, &idx);
+
+    full_stage_end(STAGE_PARSE);
+    full_draw_frame();
+    anim_pause();  /* Pause after completion */
+}
+
+/*
+ * Display a command list: each pipeline followed by its connector
+ */
+static void full_show_list(CommandList *list) {
+    if (!list) {
+        panel_clear(&parse_lines);
+        return;
     }
 
-    if (exec_count < MAX_PANEL_LINES) {
-        /* Add spinner prefix with neon lavender color */
-        char buf[MAX_LINE_LEN];
-        snprintf(buf, sizeof(buf), CSI "38;5;%dm%s" COL_RESET " " CSI "38;5;%dm%s" COL_RESET " %s",
-                 COL_LAVENDER, tui_spinner_frame(exec_count),
-                 COL_NEON_PURPLE, TREE_RARROW,
-                 message);
-
-        strncpy(exec_lines[exec_count], buf, MAX_LINE_LEN - 1);
-        exec_lines[exec_count][MAX_LINE_LEN - 1] = '\0';
-        exec_count++;
+    if (list->count == 1) {
+        full_show_pipeline(list->entries[0].pipeline);
+        return;
+    }
+
+    panel_clear(&parse_lines);
+
+    full_stage_begin(STAGE_PARSE);
+    full_draw_frame();
+    anim_pause();  /* Pause before starting */
+
+    int idx = 0;
+    for (int i = 0; i < list->count; i++) {
+        append_pipeline_lines(list->entries[i].pipeline, &idx);
+
+        int op = list->entries[i].op;
+        if (op != LIST_END) {
+            const char *when = op == LIST_AND ? "if ok" :
+                               op == LIST_OR  ? "if failed" : "then";
+            panel_addf(&parse_lines, CSI "38;5;%dm%s %s" COL_RESET " " FG_OVERLAY "%s" COL_RESET,
+                       COL_NEON_PINK, DIAMOND_EMPTY, list_op_str(op), when);
+
+            reveal_parse_line();
+        }
     }
 
-    tui_draw_frame();
-    usleep(ANIM_DELAY_US);  /* Animate each log entry */
+    full_stage_end(STAGE_PARSE);
+    full_draw_frame();
+    anim_pause();  /* Pause after completion */
 }
 
 /*
- * Show result with full multi-line output display
+ * Log an execution event with enhanced animation
  */
-void tui_show_result(int exit_code, const char *output) {
-    tui_stage_begin(STAGE_RESULT);
-    tui_stage_end(STAGE_EXECUTE);
+static void full_log_event(const ExecEvent *ev) {
+    if (exec_count == 0) {
+        full_stage_begin(STAGE_EXECUTE);
+        full_draw_frame();
+        anim_pause();
+    }
 
-    /* Clear previous result */
-    result_count = 0;
-    result_exit_code = exit_code;
+    exec_push(ev);
+
+    /* Animate each log entry: EXECUTE rows 19-21, the last one is the
+     * progress bar's while it shows */
+    int rows = progress_active ? 2 : 3;
+    int idx = exec_count - 1;
+    if (idx < 0) return;
+    if (idx >= rows) {
+        reveal_event = idx;
+        full_draw_frame();
+        reveal_event = -1;
+    }
 
-    if (output && output[0]) {
-        /* Parse output into lines */
-        const char *line_start = output;
-        const char *p = output;
+    char text[512];
+    int n = format_exec_row(idx, text, sizeof(text));
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(text)) n = (int)sizeof(text) - 1;
+    reveal_text(text, (size_t)n, 19 + (idx < rows ? idx : rows - 1), 7, term_get_width() - 10);
+}
 
-        while (*p && result_count < MAX_PANEL_LINES - 1) {
-            if (*p == '\n') {
-                int line_len = (int)(p - line_start);
-                if (line_len > MAX_LINE_LEN - 1) line_len = MAX_LINE_LEN - 1;
+/*
+ * Show progress of a long-running builtin (total <= 0: not known yet)
+ */
+static void full_show_progress(const char *label, long done, long total) {
+    if (exec_count == 0 && !progress_active) {
+        full_stage_begin(STAGE_EXECUTE);
+    }
 
-                strncpy(result_lines[result_count], line_start, line_len);
-                result_lines[result_count][line_len] = '\0';
-                result_count++;
+    snprintf(progress_label, sizeof(progress_label), "%s", label);
+    progress_done = done;
+    progress_total = total;
+    progress_active = 1;
 
-                line_start = p + 1;
-            }
-            p++;
-        }
+    /* No animation delay: this is called many times per second */
+    full_draw_frame();
+}
 
-        /* Handle last line (if no trailing newline) */
-        if (*line_start && result_count < MAX_PANEL_LINES - 1) {
-            strncpy(result_lines[result_count], line_start, MAX_LINE_LEN - 1);
-            result_lines[result_count][MAX_LINE_LEN - 1] = '\0';
-            result_count++;
-        }
+/*
+ * Follow a running command's output in RESULT: show its newest lines,
+ * redrawing only the panel and at most once per pace_frame_ms()
+ */
+static void full_follow_output(OutBuf *output) {
+    static struct timespec last;
+    struct timespec now;
+
+    if (result_src != output) {
+        result_clear();
+        result_src = output;
+        last.tv_sec = 0;
     }
 
-    tui_stage_end(STAGE_RESULT);
-    tui_draw_frame();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed_ms = (now.tv_sec - last.tv_sec) * 1000 + (now.tv_nsec - last.tv_nsec) / 1000000;
+    if (elapsed_ms < pace_frame_ms()) return;
+    last = now;
+    pace_output(outbuf_size(output));
+
+    uint64_t total = outbuf_line_count(output);
+    result_top = total > RESULT_ROWS ? total - RESULT_ROWS : 0;
+    draw_result_panel(term_get_width());
+    fflush(stdout);
+    pace_frame();
+}
+
+/*
+ * Show a command's output store in the RESULT panel, scrolled to the top
+ */
+static void full_show_output(int exit_code, OutBuf *output) {
+    full_stage_begin(STAGE_RESULT);
+    full_stage_end(STAGE_EXECUTE);
+
+    result_clear();
+    result_src = output;
+    result_exit_code = exit_code;
+
+    full_stage_end(STAGE_RESULT);
+    full_draw_frame();
+}
+
+/*
+ * Show result with full multi-line output display
+ */
+static void full_show_result(int exit_code, const char *output) {
+    OutBuf *own = result_message();
+    if (own && output) outbuf_puts(own, output);
+    full_show_output(exit_code, own);
 }
 
 /*
  * Show error message with enhanced styling
  */
-void tui_show_error(const char *message) {
-    result_count = 0;
+static void full_show_error(const char *message) {
+    OutBuf *own = result_message();
+    if (own) {
+        char buf[MAX_LINE_LEN];
+        snprintf(buf, sizeof(buf), CSI "38;5;%dm\357\200\215" COL_RESET " " FG_RED "%s" COL_RESET,
+                 COL_RED, message);
+        outbuf_puts(own, buf);
+    }
     result_exit_code = 1;
 
-    char buf[MAX_LINE_LEN];
-    snprintf(buf, sizeof(buf), CSI "38;5;%dm\357\200\215" COL_RESET " " FG_RED "%s" COL_RESET,
-             COL_RED, message);
+    full_draw_frame();
+}
+
+/*
+ * Scroll the RESULT window by whole pages (negative: up), redrawing
+ * only the panel
+ */
+static void full_result_scroll(int pages) {
+    if (!result_src) return;
 
-    strncpy(result_lines[0], buf, MAX_LINE_LEN - 1);
-    result_lines[0][MAX_LINE_LEN - 1] = '\0';
-    result_count = 1;
+    uint64_t total = outbuf_line_count(result_src);
+    uint64_t max_top = total > RESULT_ROWS ? total - RESULT_ROWS : 0;
+    int64_t top = (int64_t)result_top + (int64_t)pages * RESULT_ROWS;
+    if (top < 0) top = 0;
+    result_top = (uint64_t)top > max_top ? max_top : (uint64_t)top;
 
-    tui_draw_frame();
+    draw_result_panel(term_get_width());
+    fflush(stdout);
+}
+
+/*
+ * Find the next RESULT line containing needle, wrapping to the top once,
+ * and scroll it into view. Returns 0, or -1 if no line matches.
+ */
+static int full_result_search(const char *needle) {
+    if (!result_src || !needle[0]) return -1;
+
+    uint64_t from = result_match >= 0 ? (uint64_t)result_match + 1 : result_top;
+    int64_t hit = outbuf_find(result_src, needle, from);
+    if (hit < 0 && from > 0) hit = outbuf_find(result_src, needle, 0);
+    if (hit < 0) return -1;
+
+    result_match = hit;
+    if ((uint64_t)hit < result_top || (uint64_t)hit >= result_top + RESULT_ROWS) {
+        uint64_t total = outbuf_line_count(result_src);
+        uint64_t max_top = total > RESULT_ROWS ? total - RESULT_ROWS : 0;
+        result_top = (uint64_t)hit > max_top ? max_top : (uint64_t)hit;
+    }
+
+    draw_result_panel(term_get_width());
+    fflush(stdout);
+    return 0;
 }
 
 /*
  * Wait for keypress in debug mode
  */
-void tui_wait_step(const char *step_name) {
+static void full_wait_step(const char *step_name) {
     if (!debug_mode) return;
 
     int h = term_get_height();
@@ -1025,6 +1444,7 @@ void tui_wait_step(const char *step_name) {
     move_to(h, 1);
     printf(FG_YELLOW "[DEBUG]" COL_RESET " %s - Press Enter to continue...", step_name);
     fflush(stdout);
+    pace_settle();
 
     /* Wait for Enter */
     char c;
@@ -1050,3 +1470,46 @@ int tui_is_debug(void) {
 void tui_set_debug(int enabled) {
     debug_mode = enabled;
 }
+
+/*
+ * Take over the alternate screen, start measuring the terminal and
+ * clear it
+ */
+static void full_enter(void) {
+    term_alt_screen(1);
+    pace_start();
+    printf(BG_BASE);
+    printf(SCR_CLEAR);
+    printf(CUR_HOME);
+    fflush(stdout);
+}
+
+static void full_leave(void) {
+    term_alt_screen(0);
+}
+
+const TuiRenderer tui_renderer_full = {
+    "full",
+    full_enter,
+    full_leave,
+    splash_run,
+    full_draw_frame,
+    full_render_input,
+    full_stage_begin,
+    full_stage_end,
+    full_show_tokens,
+    full_show_pipeline,
+    full_show_list,
+    full_log_event,
+    full_show_progress,
+    full_follow_output,
+    full_show_output,
+    full_show_result,
+    full_show_error,
+    full_update_panel,
+    full_clear_panel,
+    full_clear_all_panels,
+    full_result_scroll,
+    full_result_search,
+    full_wait_step,
+};
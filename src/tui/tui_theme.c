@@ -187,31 +187,54 @@ int gradient_color(float pos) {
 
 /*
  * Print text with horizontal gradient effect
- * Each character gets a different color from the gradient
+ * Each run of pace_gradient_stride() columns gets the next color
+ * from the gradient (one color when the terminal is slow)
  */
 void print_gradient_text(const char *text) {
-    int len = (int)strlen(text);
+    size_t bytes = strlen(text);
+    int len = text_columns(text, bytes);
     if (len == 0) return;
 
-    for (int i = 0; i < len; i++) {
-        float pos = (float)i / (float)(len - 1);
-        int color = gradient_color(pos);
-        printf(CSI "38;5;%dm%c" COL_RESET, color, text[i]);
+    int stride = pace_gradient_stride();
+    int col = 0, run = -1;
+    for (size_t i = 0; i < bytes; ) {
+        int cols;
+        size_t n = grapheme_next(text + i, bytes - i, &cols);
+        if ((stride == 0 ? 0 : col / stride) != run) {
+            run = stride == 0 ? 0 : col / stride;
+            float pos = len > 1 ? (float)col / (float)(len - 1) : 0.0f;
+            printf(CSI "38;5;%dm", gradient_color(pos));
+        }
+        fwrite(text + i, 1, n, stdout);
+        i += n;
+        col += cols;
     }
+    printf(COL_RESET);
 }
 
 /*
  * Print text with specified gradient colors
  */
 void print_gradient_custom(const char *text, const int *colors, int color_count) {
-    int len = (int)strlen(text);
+    size_t bytes = strlen(text);
+    int len = text_columns(text, bytes);
     if (len == 0 || color_count == 0) return;
 
-    for (int i = 0; i < len; i++) {
-        /* Map character position to color index */
-        int color_idx = (i * (color_count - 1)) / (len > 1 ? len - 1 : 1);
-        if (color_idx >= color_count) color_idx = color_count - 1;
-
-        printf(CSI "38;5;%dm%c" COL_RESET, colors[color_idx], text[i]);
+    int stride = pace_gradient_stride();
+    int col = 0, run = -1;
+    for (size_t i = 0; i < bytes; ) {
+        int cols;
+        size_t n = grapheme_next(text + i, bytes - i, &cols);
+        if ((stride == 0 ? 0 : col / stride) != run) {
+            run = stride == 0 ? 0 : col / stride;
+            /* Map column position to color index */
+            int color_idx = (col * (color_count - 1)) / (len > 1 ? len - 1 : 1);
+            if (color_idx >= color_count) color_idx = color_count - 1;
+            printf(CSI "38;5;%dm", colors[color_idx]);
+        }
+        fwrite(text + i, 1, n, stdout);
+        i += n;
+        col += cols;
     }
+    printf(COL_RESET);
 }
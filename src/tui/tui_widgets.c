@@ -99,7 +99,7 @@ void widget_box(int x, int y, int width, int height,
         printf(CSI "38;5;%dm%s", COL_BLUE, title);
         printf(CSI "38;5;%dm", color);
         printf(" ");
-        int title_len = (int)strlen(title);
+        int title_len = text_width(title);
         widget_hline(width - title_len - 5, BOX_H);
     } else {
         widget_hline(width - 2, BOX_H);
@@ -250,7 +250,7 @@ void widget_panel(int x, int y, int width, int height,
  * Draw centered text
  */
 void widget_centered_text(int y, int screen_width, const char *text, int color) {
-    int text_len = (int)strlen(text);
+    int text_len = text_width(text);
     int x = (screen_width - text_len) / 2;
     if (x < 1) x = 1;
 
@@ -393,16 +393,8 @@ void widget_stages_v2(int x, int y, int stages, int current, int completed,
  * Draw text with horizontal gradient
  */
 void widget_gradient_text(int x, int y, const char *text, const int *colors, int color_count) {
-    int len = (int)strlen(text);
-    if (len == 0 || color_count == 0) return;
+    if (!text[0] || color_count == 0) return;
 
     widget_move(y, x);
-
-    for (int i = 0; i < len; i++) {
-        /* Map character position to color index */
-        int color_idx = (i * (color_count - 1)) / (len > 1 ? len - 1 : 1);
-        if (color_idx >= color_count) color_idx = color_count - 1;
-
-        printf(CSI "38;5;%dm%c" COL_RESET, colors[color_idx], text[i]);
-    }
+    print_gradient_custom(text, colors, color_count);
 }
@@ -0,0 +1,251 @@
+/*
+ * shelli - Educational Shell
+ * tui/tui_width.c - Character widths and grapheme clusters
+ *
+ * Everything that lays out text on the grid asks here how many columns
+ * it takes. A code point's width and grapheme class come from one
+ * lookup in the two-level table of tui_width_table.h; runs of plain
+ * ASCII are counted without it. A grapheme cluster is what the terminal
+ * draws as one glyph (a base character and its combining marks, an
+ * emoji ZWJ sequence, a flag): the editor moves and deletes by cluster,
+ * and a cluster is never split when text is clipped.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "tui.h"
+#include "tui_width_table.h"
+
+/* Grapheme classes, the high bits of a table entry */
+enum {
+    GB_OTHER,
+    GB_CONTROL,
+    GB_EXTEND,
+    GB_ZWJ,
+    GB_REGIONAL,
+    GB_SPACING,
+};
+
+#define VS16 0xFE0F     /* Emoji presentation selector */
+
+static unsigned props(uint32_t cp) {
+    if (cp >= 0x110000) return 1;
+    return width_stage2[(unsigned)width_stage1[cp >> 8] << 8 | (cp & 0xff)];
+}
+
+static int props_class(unsigned p) {
+    return (int)(p >> 2);
+}
+
+int uc_width(uint32_t cp) {
+    if (cp < 0x7f) return cp >= 0x20;
+    return (int)(props(cp) & 3);
+}
+
+/*
+ * Decode the character at s (len > 0) into *cp, returns its length. A
+ * malformed or truncated sequence is one byte long and decodes to U+FFFD.
+ */
+int utf8_decode(const char *s, size_t len, uint32_t *cp) {
+    const unsigned char *u = (const unsigned char *)s;
+    int n;
+    uint32_t c;
+
+    if (u[0] < 0x80) {
+        *cp = u[0];
+        return 1;
+    }
+    if (u[0] >= 0xC2 && u[0] <= 0xDF) {
+        n = 2;
+        c = u[0] & 0x1F;
+    } else if (u[0] >= 0xE0 && u[0] <= 0xEF) {
+        n = 3;
+        c = u[0] & 0x0F;
+    } else if (u[0] >= 0xF0 && u[0] <= 0xF4) {
+        n = 4;
+        c = u[0] & 0x07;
+    } else {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    if ((size_t)n > len) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    for (int i = 1; i < n; i++) {
+        if ((u[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return 1;
+        }
+        c = c << 6 | (u[i] & 0x3F);
+    }
+    /* Overlong forms, surrogates and values past U+10FFFF */
+    if ((n == 3 && c < 0x800) || (n == 4 && (c < 0x10000 || c > 0x10FFFF)) ||
+        (c >= 0xD800 && c <= 0xDFFF)) {
+        *cp = 0xFFFD;
+        return 1;
+    }
+    *cp = c;
+    return n;
+}
+
+/*
+ * Length of the UTF-8 sequence a lead byte starts (1 if it starts none)
+ */
+int utf8_seq_len(unsigned char lead) {
+    if (lead >= 0xC2 && lead <= 0xDF) return 2;
+    if (lead >= 0xE0 && lead <= 0xEF) return 3;
+    if (lead >= 0xF0 && lead <= 0xF4) return 4;
+    return 1;
+}
+
+/*
+ * Whether a code point of class cls continues a cluster whose last code
+ * point has class prev; ri is the number of regional indicators in a row
+ * ending at prev. Emoji ZWJ sequences are approximated: anything drawable
+ * after a ZWJ joins, as most terminals do.
+ */
+static int joins(int prev, int cls, int ri) {
+    if (prev == GB_CONTROL || cls == GB_CONTROL) return 0;
+    if (cls == GB_EXTEND || cls == GB_ZWJ || cls == GB_SPACING) return 1;
+    if (prev == GB_ZWJ) return 1;
+    if (prev == GB_REGIONAL && cls == GB_REGIONAL) return ri % 2 == 1;
+    return 0;
+}
+
+/*
+ * Length in bytes of the grapheme cluster at s (len > 0); *cols gets the
+ * columns it takes: its base character's width, widened by VS16 or a
+ * second regional indicator, plus any spacing marks
+ */
+size_t grapheme_next(const char *s, size_t len, int *cols) {
+    const unsigned char *u = (const unsigned char *)s;
+    uint32_t cp;
+
+    /* ASCII followed by ASCII (or nothing) is a cluster of its own */
+    if (u[0] < 0x80 && (len == 1 || u[1] < 0x80)) {
+        if (cols) *cols = u[0] >= 0x20 && u[0] < 0x7f;
+        return 1;
+    }
+
+    size_t pos = (size_t)utf8_decode(s, len, &cp);
+    unsigned p = props(cp);
+    int width = (int)(p & 3);
+    int prev = props_class(p);
+    int ri = prev == GB_REGIONAL;
+
+    while (pos < len) {
+        int n = utf8_decode(s + pos, len - pos, &cp);
+        unsigned q = props(cp);
+        int cls = props_class(q);
+
+        if (!joins(prev, cls, ri)) break;
+        if (cls == GB_SPACING) {
+            width += (int)(q & 3);
+        } else if (cp == VS16 || cls == GB_REGIONAL) {
+            if (width == 1) width = 2;
+        } else if (cls == GB_OTHER && (int)(q & 3) > width) {
+            width = (int)(q & 3);
+        }
+        ri = cls == GB_REGIONAL ? ri + 1 : 0;
+        prev = cls;
+        pos += (size_t)n;
+    }
+    if (cols) *cols = width;
+    return pos;
+}
+
+/*
+ * Start of the code point that ends at pos (pos > 0)
+ */
+static size_t cp_start(const char *s, size_t pos) {
+    size_t start = pos - 1;
+    while (start > 0 && pos - start < 4 && ((unsigned char)s[start] & 0xC0) == 0x80) {
+        start--;
+    }
+    /* Stray continuation bytes each count as a character */
+    uint32_t cp;
+    if ((size_t)utf8_decode(s + start, pos - start, &cp) != pos - start) return pos - 1;
+    return start;
+}
+
+static int class_at(const char *s, size_t pos, size_t end) {
+    uint32_t cp;
+    utf8_decode(s + pos, end - pos, &cp);
+    return props_class(props(cp));
+}
+
+/*
+ * Start of the grapheme cluster that ends at pos (0 if pos is 0)
+ */
+size_t grapheme_prev(const char *s, size_t pos) {
+    if (pos == 0) return 0;
+
+    const unsigned char *u = (const unsigned char *)s;
+    /* ASCII preceded by ASCII (or nothing) */
+    if (u[pos - 1] < 0x80 && (pos == 1 || u[pos - 2] < 0x80)) return pos - 1;
+
+    size_t start = cp_start(s, pos);
+    int cls = class_at(s, start, pos);
+
+    while (start > 0) {
+        size_t before = cp_start(s, start);
+        int prev = class_at(s, before, start);
+        int ri = 0;
+
+        if (prev == GB_REGIONAL && cls == GB_REGIONAL) {
+            /* Pair flags from the start of the run */
+            for (size_t p = start; p > 0; ri++) {
+                size_t q = cp_start(s, p);
+                if (class_at(s, q, p) != GB_REGIONAL) break;
+                p = q;
+            }
+        }
+        if (!joins(prev, cls, ri)) break;
+        start = before;
+        cls = prev;
+    }
+    return start;
+}
+
+/*
+ * Length of a CSI escape sequence at s (0 if there is none)
+ */
+size_t text_escape_len(const char *s, size_t len) {
+    if (len < 2 || s[0] != '\033' || s[1] != '[') return 0;
+    for (size_t j = 2; j < len; j++) {
+        unsigned char c = (unsigned char)s[j];
+        if (c >= 0x40 && c <= 0x7e) return j + 1;
+    }
+    return len;
+}
+
+/*
+ * Columns text takes on the terminal; escape sequences take none
+ */
+int text_columns(const char *s, size_t len) {
+    const unsigned char *u = (const unsigned char *)s;
+    int cols = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (u[i] >= 0x20 && u[i] < 0x7f && (i + 1 == len || u[i + 1] < 0x80)) {
+            cols++;
+            i++;
+            continue;
+        }
+        size_t esc = text_escape_len(s + i, len - i);
+        if (esc > 0) {
+            i += esc;
+            continue;
+        }
+        int w;
+        i += grapheme_next(s + i, len - i, &w);
+        cols += w;
+    }
+    return cols;
+}
+
+int text_width(const char *s) {
+    return text_columns(s, strlen(s));
+}
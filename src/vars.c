@@ -0,0 +1,291 @@
+/*
+ * shelli - Educational Shell
+ * vars.c - Shell variables and the exported environment
+ *
+ * Variables live in an open-addressing hash table (linear probing,
+ * tombstones on unset) keyed by name. Each entry holds one "NAME=value"
+ * string, so the exported environment is just an array of pointers to
+ * the exported entries' strings. That array is rebuilt only after an
+ * exported variable changes, and is installed as environ, which is what
+ * execvp hands to every child: spawning never copies or scans the
+ * environment.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "vars.h"
+#include "hash.h"
+
+extern char **environ;
+
+#define VARS_INITIAL_SLOTS 128  /* Power of two */
+
+typedef struct {
+    char *str;          /* "NAME=value", NULL for an empty slot */
+    uint64_t hash;
+    uint32_t name_len;
+    uint8_t exported;
+    uint8_t deleted;    /* Tombstone: keeps probe chains intact */
+} VarSlot;
+
+static VarSlot *slots = NULL;
+static uint32_t slot_count = 0;     /* Power of two */
+static uint32_t used = 0;           /* Live entries plus tombstones */
+static uint32_t live = 0;
+
+static char **envp = NULL;          /* Cached exported environment */
+static int envp_dirty = 1;
+static unsigned long envp_builds = 0;
+
+/* Strings replaced or removed while envp (and so environ) still pointed
+ * at them, freed once vars_sync_environ installs a new envp */
+static char **retired = NULL;
+static size_t retired_count = 0;
+static size_t retired_cap = 0;
+
+static char status_text[16] = "0";  /* $? */
+
+static uint64_t name_hash(const char *name, size_t len) {
+    return hash_bytes(name, len, HASH_SEED);
+}
+
+/* Find the slot for name: its entry, or the slot to insert into */
+static VarSlot *slot_find(const char *name, size_t len, uint64_t hash) {
+    uint32_t mask = slot_count - 1;
+    VarSlot *reuse = NULL;
+
+    for (uint32_t i = (uint32_t)hash & mask; ; i = (i + 1) & mask) {
+        VarSlot *s = &slots[i];
+        if (!s->str) {
+            if (!s->deleted) return reuse ? reuse : s;
+            if (!reuse) reuse = s;
+            continue;
+        }
+        if (s->hash == hash && s->name_len == len && memcmp(s->str, name, len) == 0) {
+            return s;
+        }
+    }
+}
+
+/* Double the table (or drop tombstones) once it is 70% used */
+static int table_grow(void) {
+    uint32_t new_count = live * 2 >= slot_count ? slot_count * 2 : slot_count;
+    VarSlot *old = slots;
+    uint32_t old_count = slot_count;
+
+    VarSlot *fresh = calloc(new_count, sizeof(VarSlot));
+    if (!fresh) return -1;
+    slots = fresh;
+    slot_count = new_count;
+    used = live;
+
+    for (uint32_t i = 0; i < old_count; i++) {
+        if (!old[i].str) continue;
+        VarSlot *s = slot_find(old[i].str, old[i].name_len, old[i].hash);
+        *s = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/* Free str now, or once environ no longer points at it */
+static void entry_release(char *str, int exported) {
+    if (!exported || !envp) {
+        free(str);
+        return;
+    }
+    if (retired_count == retired_cap) {
+        size_t cap = retired_cap ? retired_cap * 2 : 16;
+        char **grown = realloc(retired, cap * sizeof(char *));
+        if (!grown) return;     /* Leak it rather than free it under environ */
+        retired = grown;
+        retired_cap = cap;
+    }
+    retired[retired_count++] = str;
+}
+
+static int vars_init(void) {
+    if (slots) return 0;
+
+    slot_count = VARS_INITIAL_SLOTS;
+    slots = calloc(slot_count, sizeof(VarSlot));
+    if (!slots) return -1;
+
+    /* Import the inherited environment, all exported */
+    for (char **e = environ; e && *e; e++) {
+        const char *eq = strchr(*e, '=');
+        if (!eq || eq == *e) continue;
+
+        char *name = strndup(*e, (size_t)(eq - *e));
+        if (name) vars_set(name, eq + 1, VARS_EXPORT);
+        free(name);
+    }
+    return 0;
+}
+
+int vars_valid_name(const char *name, size_t len) {
+    if (len == 0 || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return 0;
+    for (size_t i = 1; i < len; i++) {
+        if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) return 0;
+    }
+    return 1;
+}
+
+int vars_is_assignment(const char *word) {
+    const char *eq = strchr(word, '=');
+    return eq && vars_valid_name(word, (size_t)(eq - word));
+}
+
+const char *vars_get(const char *name) {
+    return vars_get_n(name, strlen(name));
+}
+
+const char *vars_get_n(const char *name, size_t len) {
+    if (len == 1 && name[0] == '?') return status_text;
+    if (vars_init() < 0) return NULL;
+
+    VarSlot *s = slot_find(name, len, name_hash(name, len));
+    return s->str ? s->str + len + 1 : NULL;
+}
+
+int vars_set(const char *name, const char *value, int export) {
+    size_t len = strlen(name);
+    if (!vars_valid_name(name, len)) return -1;
+    if (vars_init() < 0) return -1;
+
+    uint64_t hash = name_hash(name, len);
+    VarSlot *s = slot_find(name, len, hash);
+
+    size_t value_len = strlen(value);
+    char *str = malloc(len + 1 + value_len + 1);
+    if (!str) return -1;
+    memcpy(str, name, len);
+    str[len] = '=';
+    memcpy(str + len + 1, value, value_len + 1);
+
+    if (s->str) {
+        /* Only a change to an exported variable invalidates envp */
+        int was_exported = s->exported;
+        if (export != VARS_KEEP) s->exported = (uint8_t)(export == VARS_EXPORT);
+        if (was_exported || s->exported) envp_dirty = 1;
+        entry_release(s->str, was_exported);
+        s->str = str;
+        return 0;
+    }
+
+    if (!s->deleted) used++;
+    s->str = str;
+    s->hash = hash;
+    s->name_len = (uint32_t)len;
+    s->exported = export == VARS_EXPORT;
+    s->deleted = 0;
+    live++;
+    if (s->exported) envp_dirty = 1;
+
+    if (used * 10 >= slot_count * 7 && table_grow() < 0) return -1;
+    return 0;
+}
+
+int vars_export(const char *name) {
+    size_t len = strlen(name);
+    if (!vars_valid_name(name, len)) return -1;
+    if (vars_init() < 0) return -1;
+
+    VarSlot *s = slot_find(name, len, name_hash(name, len));
+    if (!s->str) return vars_set(name, "", VARS_EXPORT);
+    if (!s->exported) {
+        s->exported = 1;
+        envp_dirty = 1;
+    }
+    return 0;
+}
+
+int vars_unset(const char *name) {
+    size_t len = strlen(name);
+    if (!vars_valid_name(name, len)) return -1;
+    if (vars_init() < 0) return -1;
+
+    VarSlot *s = slot_find(name, len, name_hash(name, len));
+    if (!s->str) return 0;
+
+    if (s->exported) envp_dirty = 1;
+    entry_release(s->str, s->exported);
+    s->str = NULL;
+    s->exported = 0;
+    s->deleted = 1;
+    live--;
+    return 0;
+}
+
+char **vars_envp(void) {
+    if (vars_init() < 0) return environ;
+    if (!envp_dirty && envp) return envp;
+
+    char **fresh = malloc((live + 1) * sizeof(char *));
+    if (!fresh) return envp ? envp : environ;
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (slots[i].str && slots[i].exported) fresh[n++] = slots[i].str;
+    }
+    fresh[n] = NULL;
+
+    /* Entries own the strings; the old array only held pointers */
+    free(envp);
+    envp = fresh;
+    envp_dirty = 0;
+    envp_builds++;
+    return envp;
+}
+
+void vars_sync_environ(void) {
+    environ = vars_envp();
+    if (envp_dirty) return;     /* Rebuild failed: the old envp is still in use */
+
+    for (size_t i = 0; i < retired_count; i++) {
+        free(retired[i]);
+    }
+    retired_count = 0;
+}
+
+void vars_set_status(int status) {
+    snprintf(status_text, sizeof(status_text), "%d", status);
+}
+
+/* qsort helper: order slots by their "NAME=value" string */
+static int compare_slots(const void *a, const void *b) {
+    return strcmp((*(VarSlot *const *)a)->str, (*(VarSlot *const *)b)->str);
+}
+
+int vars_list(int exported_only, VarsListFn fn, void *ctx) {
+    if (vars_init() < 0) return -1;
+
+    VarSlot **all = malloc((live + 1) * sizeof(VarSlot *));
+    if (!all) return -1;
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < slot_count; i++) {
+        if (slots[i].str && (!exported_only || slots[i].exported)) all[n++] = &slots[i];
+    }
+    qsort(all, n, sizeof(VarSlot *), compare_slots);
+
+    for (size_t i = 0; i < n; i++) {
+        fn(all[i]->str, all[i]->name_len, all[i]->exported, ctx);
+    }
+    free(all);
+    return 0;
+}
+
+void vars_stats(int *count, int *exported, unsigned long *envp_rebuilds) {
+    int exp = 0;
+    if (vars_init() == 0) {
+        for (uint32_t i = 0; i < slot_count; i++) {
+            if (slots[i].str && slots[i].exported) exp++;
+        }
+    }
+    if (count) *count = (int)live;
+    if (exported) *exported = exp;
+    if (envp_rebuilds) *envp_rebuilds = envp_builds;
+}
@@ -0,0 +1,55 @@
+/*
+ * shelli - Educational Shell
+ * vars.h - Shell variables and the exported environment
+ */
+
+#ifndef VARS_H
+#define VARS_H
+
+#include <stddef.h>
+
+/* Export mode for vars_set */
+#define VARS_LOCAL  0   /* Shell-only (not passed to children) */
+#define VARS_EXPORT 1   /* Passed to children */
+#define VARS_KEEP   2   /* Leave an existing variable's mode alone */
+
+/* Callback for vars_list: name_value is "NAME=value" */
+typedef void (*VarsListFn)(const char *name_value, size_t name_len, int exported, void *ctx);
+
+/* Get a variable's value ("?" is the last exit status), or NULL */
+const char *vars_get(const char *name);
+const char *vars_get_n(const char *name, size_t len);
+
+/* Set a variable; returns -1 for an invalid name */
+int vars_set(const char *name, const char *value, int export);
+
+/* Mark a variable exported, creating it empty if unset */
+int vars_export(const char *name);
+
+/* Remove a variable; returns -1 for an invalid name */
+int vars_unset(const char *name);
+
+/* Check for [A-Za-z_][A-Za-z0-9_]* */
+int vars_valid_name(const char *name, size_t len);
+
+/* Check whether word has the NAME=value form */
+int vars_is_assignment(const char *word);
+
+/* Get the exported environment, rebuilt only after an exported
+ * variable changed. Valid until the next change; the strings it held
+ * stay valid until vars_sync_environ installs the rebuilt one. */
+char **vars_envp(void);
+
+/* Point environ at vars_envp(), so exec and getenv see it */
+void vars_sync_environ(void);
+
+/* Record the exit status reported by $? */
+void vars_set_status(int status);
+
+/* Call fn for each variable in name order */
+int vars_list(int exported_only, VarsListFn fn, void *ctx);
+
+/* Get counts and the number of envp rebuilds (any pointer may be NULL) */
+void vars_stats(int *count, int *exported, unsigned long *envp_rebuilds);
+
+#endif /* VARS_H */
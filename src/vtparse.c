@@ -0,0 +1,639 @@
+/*
+ * shelli - Educational Shell
+ * vtparse.c - VT100/xterm output parser for captured output
+ *
+ * The parser is the state machine from Paul Williams' DEC-compatible
+ * parser: every (state, byte) pair maps to an action and a next state.
+ * The table is built once from the byte ranges of his diagram, so the
+ * inner loop is one lookup per byte, and runs of printable text in the
+ * ground state skip the table altogether.
+ *
+ * Text lands in a line of cells (one UTF-8 character and its style
+ * each), which CR, BS, HT, cursor motion and EL edit in place, so a
+ * progress bar redrawn with \r leaves only its final state. Captured
+ * output is append-only, which rules out moving to earlier lines; those
+ * sequences, like DCS and OSC strings, are parsed and dropped. Lines
+ * are stored with SGR sequences only, each starting from the default
+ * style, so any stored line can be drawn on its own.
+ *
+ * Unlike a VT100, bytes 0x80-0xFF are UTF-8 text, never C1 controls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "vtparse.h"
+#include "outbuf.h"
+
+typedef enum {
+    ST_GROUND,
+    ST_ESCAPE,
+    ST_ESCAPE_INTERMEDIATE,
+    ST_CSI_ENTRY,
+    ST_CSI_PARAM,
+    ST_CSI_INTERMEDIATE,
+    ST_CSI_IGNORE,
+    ST_DCS_ENTRY,
+    ST_DCS_PARAM,
+    ST_DCS_INTERMEDIATE,
+    ST_DCS_PASSTHROUGH,
+    ST_DCS_IGNORE,
+    ST_OSC_STRING,
+    ST_SOS_PM_APC_STRING,
+    ST_COUNT,
+    ST_SAME = 15            /* Table value: no transition */
+} VtState;
+
+/* DCS and OSC payloads (hook/put/unhook, osc_put) are ignored here */
+typedef enum {
+    ACT_NONE,
+    ACT_IGNORE,
+    ACT_PRINT,
+    ACT_EXECUTE,
+    ACT_COLLECT,
+    ACT_PARAM,
+    ACT_ESC_DISPATCH,
+    ACT_CSI_DISPATCH
+} VtAction;
+
+#define ENTRY(action, state) ((uint8_t)((action) | ((state) << 4)))
+
+static uint8_t table[ST_COUNT][256];
+static int table_ready = 0;
+
+#define MAX_PARAMS 16
+#define MAX_INTERMEDIATES 2
+#define TAB_WIDTH 8
+
+/* Cell colours: 0 default, 1 + n for palette entry n, or RGB */
+#define COLOR_RGB 0x1000000u
+
+#define ATTR_BOLD      0x01
+#define ATTR_DIM       0x02
+#define ATTR_ITALIC    0x04
+#define ATTR_UNDERLINE 0x08
+#define ATTR_REVERSE   0x10
+#define ATTR_STRIKE    0x20
+
+typedef struct {
+    uint32_t fg;
+    uint32_t bg;
+    uint8_t attrs;
+} VtStyle;
+
+typedef struct {
+    char ch[4];             /* UTF-8 bytes */
+    uint8_t len;
+    uint8_t attrs;
+    uint32_t fg;
+    uint32_t bg;
+} VtCell;
+
+struct VtParse {
+    OutBuf *out;
+    uint8_t state;
+
+    int params[MAX_PARAMS];
+    int param_count;
+    char intermediates[MAX_INTERMEDIATES];
+    int intermediate_count;
+    int ignoring;           /* Too many intermediates: dispatch nothing */
+
+    VtStyle style;
+    VtCell *cells;          /* Current line */
+    size_t count;           /* Cells in use */
+    size_t cap;
+    size_t col;             /* Cursor column */
+    int utf8_need;          /* Continuation bytes still due for cells[utf8_cell] */
+    size_t utf8_cell;
+
+    char *text;             /* Finished lines, stored once per chunk */
+    size_t text_len;
+    size_t text_cap;
+};
+
+static void set_range(VtState state, int from, int to, VtAction action, VtState next) {
+    for (int c = from; c <= to; c++) table[state][c] = ENTRY(action, next);
+}
+
+/* C0 controls other than the "anywhere" ones (CAN, SUB, ESC) */
+static void set_c0(VtState state, VtAction action) {
+    set_range(state, 0x00, 0x17, action, ST_SAME);
+    set_range(state, 0x19, 0x19, action, ST_SAME);
+    set_range(state, 0x1c, 0x1f, action, ST_SAME);
+}
+
+/*
+ * Fill the transition table from the state diagram. Ranges that a state
+ * does not list stay ACT_IGNORE (set first).
+ */
+static void build_table(void) {
+    for (int s = 0; s < ST_COUNT; s++) {
+        set_range(s, 0x00, 0xff, ACT_IGNORE, ST_SAME);
+    }
+
+    set_c0(ST_GROUND, ACT_EXECUTE);
+    set_range(ST_GROUND, 0x20, 0x7e, ACT_PRINT, ST_SAME);
+    set_range(ST_GROUND, 0x80, 0xff, ACT_PRINT, ST_SAME);
+
+    set_c0(ST_ESCAPE, ACT_EXECUTE);
+    set_range(ST_ESCAPE, 0x20, 0x2f, ACT_COLLECT, ST_ESCAPE_INTERMEDIATE);
+    set_range(ST_ESCAPE, 0x30, 0x7e, ACT_ESC_DISPATCH, ST_GROUND);
+    set_range(ST_ESCAPE, 0x50, 0x50, ACT_NONE, ST_DCS_ENTRY);
+    set_range(ST_ESCAPE, 0x58, 0x58, ACT_NONE, ST_SOS_PM_APC_STRING);
+    set_range(ST_ESCAPE, 0x5b, 0x5b, ACT_NONE, ST_CSI_ENTRY);
+    set_range(ST_ESCAPE, 0x5d, 0x5d, ACT_NONE, ST_OSC_STRING);
+    set_range(ST_ESCAPE, 0x5e, 0x5f, ACT_NONE, ST_SOS_PM_APC_STRING);
+
+    set_c0(ST_ESCAPE_INTERMEDIATE, ACT_EXECUTE);
+    set_range(ST_ESCAPE_INTERMEDIATE, 0x20, 0x2f, ACT_COLLECT, ST_SAME);
+    set_range(ST_ESCAPE_INTERMEDIATE, 0x30, 0x7e, ACT_ESC_DISPATCH, ST_GROUND);
+
+    /* ':' (sub-parameters, as in 38:5:n) is read as a separator here
+     * rather than sending the sequence to csi_ignore */
+    set_c0(ST_CSI_ENTRY, ACT_EXECUTE);
+    set_range(ST_CSI_ENTRY, 0x20, 0x2f, ACT_COLLECT, ST_CSI_INTERMEDIATE);
+    set_range(ST_CSI_ENTRY, 0x30, 0x3b, ACT_PARAM, ST_CSI_PARAM);
+    set_range(ST_CSI_ENTRY, 0x3c, 0x3f, ACT_COLLECT, ST_CSI_PARAM);
+    set_range(ST_CSI_ENTRY, 0x40, 0x7e, ACT_CSI_DISPATCH, ST_GROUND);
+
+    set_c0(ST_CSI_PARAM, ACT_EXECUTE);
+    set_range(ST_CSI_PARAM, 0x20, 0x2f, ACT_COLLECT, ST_CSI_INTERMEDIATE);
+    set_range(ST_CSI_PARAM, 0x30, 0x3b, ACT_PARAM, ST_SAME);
+    set_range(ST_CSI_PARAM, 0x3c, 0x3f, ACT_NONE, ST_CSI_IGNORE);
+    set_range(ST_CSI_PARAM, 0x40, 0x7e, ACT_CSI_DISPATCH, ST_GROUND);
+
+    set_c0(ST_CSI_INTERMEDIATE, ACT_EXECUTE);
+    set_range(ST_CSI_INTERMEDIATE, 0x20, 0x2f, ACT_COLLECT, ST_SAME);
+    set_range(ST_CSI_INTERMEDIATE, 0x30, 0x3f, ACT_NONE, ST_CSI_IGNORE);
+    set_range(ST_CSI_INTERMEDIATE, 0x40, 0x7e, ACT_CSI_DISPATCH, ST_GROUND);
+
+    set_c0(ST_CSI_IGNORE, ACT_EXECUTE);
+    set_range(ST_CSI_IGNORE, 0x40, 0x7e, ACT_NONE, ST_GROUND);
+
+    set_range(ST_DCS_ENTRY, 0x20, 0x2f, ACT_COLLECT, ST_DCS_INTERMEDIATE);
+    set_range(ST_DCS_ENTRY, 0x30, 0x3b, ACT_PARAM, ST_DCS_PARAM);
+    set_range(ST_DCS_ENTRY, 0x3c, 0x3f, ACT_COLLECT, ST_DCS_PARAM);
+    set_range(ST_DCS_ENTRY, 0x40, 0x7e, ACT_NONE, ST_DCS_PASSTHROUGH);
+
+    set_range(ST_DCS_PARAM, 0x20, 0x2f, ACT_COLLECT, ST_DCS_INTERMEDIATE);
+    set_range(ST_DCS_PARAM, 0x30, 0x3b, ACT_PARAM, ST_SAME);
+    set_range(ST_DCS_PARAM, 0x3c, 0x3f, ACT_NONE, ST_DCS_IGNORE);
+    set_range(ST_DCS_PARAM, 0x40, 0x7e, ACT_NONE, ST_DCS_PASSTHROUGH);
+
+    set_range(ST_DCS_INTERMEDIATE, 0x20, 0x2f, ACT_COLLECT, ST_SAME);
+    set_range(ST_DCS_INTERMEDIATE, 0x30, 0x3f, ACT_NONE, ST_DCS_IGNORE);
+    set_range(ST_DCS_INTERMEDIATE, 0x40, 0x7e, ACT_NONE, ST_DCS_PASSTHROUGH);
+
+    /* xterm also ends OSC with BEL */
+    set_range(ST_OSC_STRING, 0x07, 0x07, ACT_NONE, ST_GROUND);
+
+    /* Anywhere: CAN and SUB abort a sequence, ESC starts a new one */
+    for (int s = 0; s < ST_COUNT; s++) {
+        table[s][0x18] = ENTRY(ACT_EXECUTE, ST_GROUND);
+        table[s][0x1a] = ENTRY(ACT_EXECUTE, ST_GROUND);
+        table[s][0x1b] = ENTRY(ACT_NONE, ST_ESCAPE);
+    }
+    table_ready = 1;
+}
+
+VtParse *vtparse_new(OutBuf *out) {
+    if (!table_ready) build_table();
+
+    VtParse *vt = calloc(1, sizeof(VtParse));
+    if (!vt) return NULL;
+    vt->out = out;
+    vt->state = ST_GROUND;
+    return vt;
+}
+
+void vtparse_free(VtParse *vt) {
+    if (!vt) return;
+    free(vt->cells);
+    free(vt->text);
+    free(vt);
+}
+
+/* Entry action of escape, csi_entry and dcs_entry */
+static void clear_sequence(VtParse *vt) {
+    vt->param_count = 0;
+    vt->intermediate_count = 0;
+    vt->ignoring = 0;
+}
+
+/* Make room for more bytes of finished lines */
+static int text_reserve(VtParse *vt, size_t more) {
+    size_t need = vt->text_len + more;
+    if (need <= vt->text_cap) return 0;
+    size_t cap = vt->text_cap ? vt->text_cap : 256;
+    while (cap < need) cap *= 2;
+    char *text = realloc(vt->text, cap);
+    if (!text) return -1;
+    vt->text = text;
+    vt->text_cap = cap;
+    return 0;
+}
+
+static int put_color(char *p, int base, uint32_t color) {
+    if (color & COLOR_RGB) {
+        return sprintf(p, ";%d;2;%u;%u;%u", base + 8, (color >> 16) & 0xff,
+                       (color >> 8) & 0xff, color & 0xff);
+    }
+    unsigned n = color - 1;
+    if (n < 8) return sprintf(p, ";%u", base + n);
+    if (n < 16) return sprintf(p, ";%u", base + 60 + n - 8);
+    return sprintf(p, ";%d;5;%u", base + 8, n);
+}
+
+static size_t put_sgr(char *p, const VtCell *c) {
+    static const char codes[] = {'1', '2', '3', '4', '7', '9'};
+    char *start = p;
+
+    p += sprintf(p, "\033[0");
+    for (int i = 0; i < 6; i++) {
+        if (c->attrs & (1 << i)) {
+            *p++ = ';';
+            *p++ = codes[i];
+        }
+    }
+    if (c->fg) p += put_color(p, 30, c->fg);
+    if (c->bg) p += put_color(p, 40, c->bg);
+    *p++ = 'm';
+    return (size_t)(p - start);
+}
+
+#define SGR_MAX 64      /* "\033[0;1;2;3;4;7;9;38;2;255;255;255;48;2;255;255;255m" */
+
+/*
+ * Finish the current line: serialize it after the lines already pending,
+ * with an SGR sequence wherever the style changes (each a full reset plus
+ * attributes) and a reset at the end
+ */
+static int emit_line(VtParse *vt, int newline) {
+    /* Worst case: a style change before every cell */
+    if (text_reserve(vt, vt->count * (SGR_MAX + 4) + SGR_MAX + 2) < 0) return -1;
+
+    char *p = vt->text + vt->text_len;
+    uint32_t fg = 0, bg = 0;
+    uint8_t attrs = 0;
+    for (size_t i = 0; i < vt->count; i++) {
+        const VtCell *c = &vt->cells[i];
+        if (c->fg != fg || c->bg != bg || c->attrs != attrs) {
+            p += put_sgr(p, c);
+            fg = c->fg;
+            bg = c->bg;
+            attrs = c->attrs;
+        }
+        if (c->len == 1) {
+            *p++ = c->ch[0];
+        } else {
+            memcpy(p, c->ch, c->len);
+            p += c->len;
+        }
+    }
+    if (fg || bg || attrs) p += sprintf(p, "\033[0m");
+    if (newline) *p++ = '\n';
+
+    vt->text_len = (size_t)(p - vt->text);
+    vt->count = 0;
+    vt->col = 0;
+    vt->utf8_need = 0;
+    return 0;
+}
+
+/* Store the lines finished so far with one append */
+static int flush_lines(VtParse *vt) {
+    if (vt->text_len == 0) return 0;
+    int ret = outbuf_append(vt->out, vt->text, vt->text_len);
+    vt->text_len = 0;
+    return ret;
+}
+
+/*
+ * Make cells [0, n) exist for a write at the cursor: cells between the
+ * old end of the line and the cursor become blanks, the rest of [0, n)
+ * is about to be written
+ */
+static int line_extend(VtParse *vt, size_t n) {
+    if (n > vt->cap) {
+        size_t cap = vt->cap ? vt->cap : 128;
+        while (cap < n) cap *= 2;
+        VtCell *cells = realloc(vt->cells, cap * sizeof(VtCell));
+        if (!cells) return -1;
+        vt->cells = cells;
+        vt->cap = cap;
+    }
+    for (; vt->count < vt->col; vt->count++) {
+        VtCell *c = &vt->cells[vt->count];
+        memset(c, 0, sizeof(*c));
+        c->ch[0] = ' ';
+        c->len = 1;
+    }
+    vt->count = n;
+    return 0;
+}
+
+/* Write one byte of text at the cursor */
+static int print_byte(VtParse *vt, unsigned char b) {
+    /* A continuation byte completes the character just printed */
+    if ((b & 0xc0) == 0x80 && vt->utf8_need > 0) {
+        VtCell *c = &vt->cells[vt->utf8_cell];
+        c->ch[c->len++] = (char)b;
+        vt->utf8_need--;
+        return 0;
+    }
+
+    if (vt->col >= VTPARSE_COLS_MAX && emit_line(vt, 1) < 0) return -1;
+    if (vt->col >= vt->count && line_extend(vt, vt->col + 1) < 0) return -1;
+
+    VtCell *c = &vt->cells[vt->col];
+    c->ch[0] = (char)b;
+    c->len = 1;
+    c->fg = vt->style.fg;
+    c->bg = vt->style.bg;
+    c->attrs = vt->style.attrs;
+
+    vt->utf8_need = b >= 0xf0 ? 3 : b >= 0xe0 ? 2 : b >= 0xc0 ? 1 : 0;
+    vt->utf8_cell = vt->col;
+    vt->col++;
+    return 0;
+}
+
+/*
+ * Write a run of ASCII text at the cursor: the common case, done without
+ * the per-byte UTF-8 bookkeeping
+ */
+static int print_ascii(VtParse *vt, const unsigned char *s, size_t n) {
+    while (n > 0) {
+        if (vt->col >= VTPARSE_COLS_MAX && emit_line(vt, 1) < 0) return -1;
+
+        size_t run = VTPARSE_COLS_MAX - vt->col < n ? VTPARSE_COLS_MAX - vt->col : n;
+        if (vt->col + run > vt->count && line_extend(vt, vt->col + run) < 0) return -1;
+
+        VtCell cell;
+        memset(&cell, 0, sizeof(cell));
+        cell.len = 1;
+        cell.fg = vt->style.fg;
+        cell.bg = vt->style.bg;
+        cell.attrs = vt->style.attrs;
+
+        VtCell *c = vt->cells + vt->col;
+        for (size_t k = 0; k < run; k++) {
+            c[k] = cell;
+            c[k].ch[0] = (char)s[k];
+        }
+        vt->col += run;
+        s += run;
+        n -= run;
+    }
+    vt->utf8_need = 0;
+    return 0;
+}
+
+/* C0 controls that move on the line; the rest (BEL, ...) do nothing */
+static int execute(VtParse *vt, unsigned char c) {
+    vt->utf8_need = 0;
+    switch (c) {
+        case '\n':
+        case '\v':
+        case '\f':
+            return emit_line(vt, 1);
+        case '\r':
+            vt->col = 0;
+            break;
+        case '\b':
+            if (vt->col > 0) vt->col--;
+            break;
+        case '\t':
+            vt->col = (vt->col / TAB_WIDTH + 1) * TAB_WIDTH;
+            if (vt->col >= VTPARSE_COLS_MAX) vt->col = VTPARSE_COLS_MAX - 1;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void param_digit(VtParse *vt, unsigned char c) {
+    if (vt->param_count == 0) {
+        vt->params[0] = 0;
+        vt->param_count = 1;
+    }
+    if (c == ';' || c == ':') {
+        if (vt->param_count < MAX_PARAMS) vt->params[vt->param_count] = 0;
+        vt->param_count++;
+        return;
+    }
+    if (vt->param_count > MAX_PARAMS) return;
+    int *p = &vt->params[vt->param_count - 1];
+    if (*p < 65535) *p = *p * 10 + (c - '0');
+}
+
+/* Parameter i, or def when it is missing or 0 */
+static int param(const VtParse *vt, int i, int def) {
+    if (i >= vt->param_count || i >= MAX_PARAMS || vt->params[i] == 0) return def;
+    return vt->params[i];
+}
+
+/* 38/48 colour: ;5;n or ;2;r;g;b starting at params[i], returns the
+ * number of parameters used */
+static int sgr_color(const VtParse *vt, int i, uint32_t *color) {
+    int count = vt->param_count < MAX_PARAMS ? vt->param_count : MAX_PARAMS;
+    if (i + 1 < count && vt->params[i] == 5) {
+        *color = 1 + (uint32_t)(vt->params[i + 1] & 0xff);
+        return 2;
+    }
+    if (i + 3 < count && vt->params[i] == 2) {
+        *color = COLOR_RGB | (uint32_t)(vt->params[i + 1] & 0xff) << 16 |
+                 (uint32_t)(vt->params[i + 2] & 0xff) << 8 | (uint32_t)(vt->params[i + 3] & 0xff);
+        return 4;
+    }
+    return count - i;
+}
+
+static void sgr(VtParse *vt) {
+    VtStyle *s = &vt->style;
+    int count = vt->param_count < MAX_PARAMS ? vt->param_count : MAX_PARAMS;
+    if (count == 0) count = 1;      /* CSI m is CSI 0 m */
+
+    for (int i = 0; i < count; i++) {
+        int p = vt->param_count > 0 ? vt->params[i] : 0;
+
+        if (p == 0) {
+            memset(s, 0, sizeof(*s));
+        } else if (p == 1) {
+            s->attrs |= ATTR_BOLD;
+        } else if (p == 2) {
+            s->attrs |= ATTR_DIM;
+        } else if (p == 3) {
+            s->attrs |= ATTR_ITALIC;
+        } else if (p == 4) {
+            s->attrs |= ATTR_UNDERLINE;
+        } else if (p == 7) {
+            s->attrs |= ATTR_REVERSE;
+        } else if (p == 9) {
+            s->attrs |= ATTR_STRIKE;
+        } else if (p == 22) {
+            s->attrs &= (uint8_t)~(ATTR_BOLD | ATTR_DIM);
+        } else if (p == 23) {
+            s->attrs &= (uint8_t)~ATTR_ITALIC;
+        } else if (p == 24) {
+            s->attrs &= (uint8_t)~ATTR_UNDERLINE;
+        } else if (p == 27) {
+            s->attrs &= (uint8_t)~ATTR_REVERSE;
+        } else if (p == 29) {
+            s->attrs &= (uint8_t)~ATTR_STRIKE;
+        } else if (p >= 30 && p <= 37) {
+            s->fg = 1 + (uint32_t)(p - 30);
+        } else if (p == 38) {
+            i += sgr_color(vt, i + 1, &s->fg);
+        } else if (p == 39) {
+            s->fg = 0;
+        } else if (p >= 40 && p <= 47) {
+            s->bg = 1 + (uint32_t)(p - 40);
+        } else if (p == 48) {
+            i += sgr_color(vt, i + 1, &s->bg);
+        } else if (p == 49) {
+            s->bg = 0;
+        } else if (p >= 90 && p <= 97) {
+            s->fg = 1 + (uint32_t)(p - 90 + 8);
+        } else if (p >= 100 && p <= 107) {
+            s->bg = 1 + (uint32_t)(p - 100 + 8);
+        }
+    }
+}
+
+/* Blank cells [from, to) of the line in the current background */
+static void erase_cells(VtParse *vt, size_t from, size_t to) {
+    for (size_t i = from; i < to && i < vt->count; i++) {
+        VtCell *c = &vt->cells[i];
+        memset(c, 0, sizeof(*c));
+        c->ch[0] = ' ';
+        c->len = 1;
+        c->bg = vt->style.bg;
+    }
+}
+
+static void csi_dispatch(VtParse *vt, unsigned char final) {
+    /* Private (?, >, ...) and intermediate forms set modes: nothing to do */
+    if (vt->ignoring || vt->intermediate_count > 0) return;
+
+    size_t n = (size_t)param(vt, 0, 1);
+    switch (final) {
+        case 'm':
+            sgr(vt);
+            break;
+        case 'C':       /* CUF */
+            vt->col = vt->col + n < VTPARSE_COLS_MAX ? vt->col + n : VTPARSE_COLS_MAX - 1;
+            break;
+        case 'D':       /* CUB */
+            vt->col = vt->col > n ? vt->col - n : 0;
+            break;
+        case 'G':       /* CHA */
+        case '`':       /* HPA */
+            vt->col = n - 1 < VTPARSE_COLS_MAX ? n - 1 : VTPARSE_COLS_MAX - 1;
+            break;
+        case 'K':       /* EL */
+            switch (param(vt, 0, 0)) {
+                case 0:
+                    if (vt->style.bg) erase_cells(vt, vt->col, vt->count);
+                    else if (vt->col < vt->count) vt->count = vt->col;
+                    break;
+                case 1:
+                    erase_cells(vt, 0, vt->col + 1);
+                    break;
+                case 2:
+                    if (vt->style.bg) erase_cells(vt, 0, vt->count);
+                    else vt->count = 0;
+                    break;
+            }
+            break;
+        case 'X':       /* ECH */
+            erase_cells(vt, vt->col, vt->col + n);
+            break;
+        default:
+            /* Cursor addressing, scrolling, screen erase: not in an
+             * append-only log */
+            break;
+    }
+}
+
+static void esc_dispatch(VtParse *vt, unsigned char final) {
+    /* RIS (ESC c) resets the style; charset selection and the rest have
+     * no effect on stored text */
+    if (vt->intermediate_count == 0 && final == 'c') {
+        memset(&vt->style, 0, sizeof(vt->style));
+    }
+}
+
+int vtparse_feed(VtParse *vt, const char *data, size_t len) {
+    const unsigned char *s = (const unsigned char *)data;
+    size_t i = 0;
+
+    /* Lines finished by this chunk are stored together at the end */
+
+    while (i < len) {
+        /* Fast path: a run of text goes straight into cells */
+        if (vt->state == ST_GROUND && s[i] >= 0x20 && s[i] != 0x7f) {
+            size_t end = i;
+            while (end < len && s[end] >= 0x20 && s[end] < 0x7f) end++;
+            if (end > i && vt->utf8_need == 0) {
+                if (print_ascii(vt, s + i, end - i) < 0) return -1;
+                i = end;
+                continue;
+            }
+            do {
+                if (print_byte(vt, s[i]) < 0) return -1;
+                i++;
+            } while (i < len && s[i] >= 0x20 && s[i] != 0x7f);
+            continue;
+        }
+
+        unsigned char c = s[i++];
+        uint8_t entry = table[vt->state][c];
+        int next = entry >> 4;
+
+        switch ((VtAction)(entry & 0x0f)) {
+            case ACT_PRINT:
+                if (print_byte(vt, c) < 0) return -1;
+                break;
+            case ACT_EXECUTE:
+                if (execute(vt, c) < 0) return -1;
+                break;
+            case ACT_COLLECT:
+                if (vt->intermediate_count < MAX_INTERMEDIATES) {
+                    vt->intermediates[vt->intermediate_count++] = (char)c;
+                } else {
+                    vt->ignoring = 1;
+                }
+                break;
+            case ACT_PARAM:
+                param_digit(vt, c);
+                break;
+            case ACT_ESC_DISPATCH:
+                esc_dispatch(vt, c);
+                break;
+            case ACT_CSI_DISPATCH:
+                csi_dispatch(vt, c);
+                break;
+            case ACT_NONE:
+            case ACT_IGNORE:
+                break;
+        }
+
+        if (next != ST_SAME) {
+            vt->state = (uint8_t)next;
+            if (next == ST_ESCAPE || next == ST_CSI_ENTRY || next == ST_DCS_ENTRY) {
+                clear_sequence(vt);
+            }
+        }
+    }
+    return flush_lines(vt);
+}
+
+int vtparse_finish(VtParse *vt) {
+    vt->state = ST_GROUND;
+    if (vt->count > 0 && emit_line(vt, 0) < 0) return -1;
+    return flush_lines(vt);
+}
@@ -0,0 +1,39 @@
+/*
+ * shelli - Educational Shell
+ * vtparse.h - VT100/xterm output parser for captured output
+ */
+
+#ifndef VTPARSE_H
+#define VTPARSE_H
+
+#include <stddef.h>
+
+struct OutBuf;
+
+/* Widest line kept; printing past it wraps, like a terminal would */
+#define VTPARSE_COLS_MAX 65536
+
+typedef struct VtParse VtParse;
+
+/* Create a parser that writes finished lines into out, NULL on
+ * allocation failure */
+VtParse *vtparse_new(struct OutBuf *out);
+
+/* Free a parser (the pending line is dropped, see vtparse_finish) */
+void vtparse_free(VtParse *vt);
+
+/*
+ * Interpret a chunk of terminal output. Printable text is laid out in
+ * styled cells on the current line; CR, BS, tabs, cursor motion along
+ * the line and erase-in-line edit it; SGR sets the style. Each line is
+ * stored on LF with only SGR sequences left in it. Other sequences
+ * (cursor addressing, modes, titles, DCS) are consumed without effect.
+ * Chunks may split sequences and UTF-8 characters anywhere.
+ * Returns 0, or -1 if the store failed.
+ */
+int vtparse_feed(VtParse *vt, const char *data, size_t len);
+
+/* Store the unfinished last line, if any (without a newline) */
+int vtparse_finish(VtParse *vt);
+
+#endif /* VTPARSE_H */
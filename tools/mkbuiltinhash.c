@@ -0,0 +1,70 @@
+/*
+ * shelli - Educational Shell
+ * tools/mkbuiltinhash.c - Generate the perfect hash for builtin dispatch
+ *
+ * Run at build time. Reads the names from src/builtins.def, finds the
+ * smallest power-of-two table and a seed for builtin_name_hash() under
+ * which no two names share a slot, and prints a header with the slot map.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "builtins.h"
+
+#define MAX_SEED_TRIES 1000000u
+
+#define BUILTIN(name, handler, flags) name,
+static const char *names[] = {
+#include "builtins.def"
+};
+#undef BUILTIN
+
+#define NAME_COUNT ((int)(sizeof(names) / sizeof(names[0])))
+
+/*
+ * Try a seed, filling slots[] on success, returns 1 if collision-free
+ */
+static int try_seed(uint32_t seed, int size, int *slots) {
+    for (int i = 0; i < size; i++) slots[i] = -1;
+
+    for (int i = 0; i < NAME_COUNT; i++) {
+        uint32_t slot = builtin_name_hash(names[i], seed) & (uint32_t)(size - 1);
+        if (slots[slot] >= 0) return 0;
+        slots[slot] = i;
+    }
+    return 1;
+}
+
+int main(void) {
+    int size = 1;
+    while (size < NAME_COUNT) size *= 2;
+
+    /* Grow the table until a seed separates every name */
+    for (; size <= 4096; size *= 2) {
+        int *slots = malloc(size * sizeof(int));
+        if (!slots) return 1;
+
+        for (uint32_t seed = 0; seed < MAX_SEED_TRIES; seed++) {
+            if (!try_seed(seed, size, slots)) continue;
+
+            printf("/* Generated by tools/mkbuiltinhash.c from src/builtins.def - do not edit */\n\n");
+            printf("#define BUILTIN_HASH_SEED %uu\n", seed);
+            printf("#define BUILTIN_HASH_SIZE %d\n\n", size);
+            printf("/* Slot -> index into the builtin table, -1 for empty */\n");
+            printf("static const signed char builtin_hash_slots[BUILTIN_HASH_SIZE] = {");
+            for (int i = 0; i < size; i++) {
+                printf("%s%d", i % 16 == 0 ? "\n    " : " ", slots[i]);
+                if (i < size - 1) printf(",");
+            }
+            printf("\n};\n");
+
+            free(slots);
+            return 0;
+        }
+        free(slots);
+    }
+
+    fprintf(stderr, "mkbuiltinhash: no perfect hash found for %d names\n", NAME_COUNT);
+    return 1;
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+#
+# shelli - Educational Shell
+# tools/mkwidthtable.py - Generate the character width table
+#
+# Writes src/tui/tui_width_table.h from the Unicode database bundled with
+# Python (unicodedata). Each code point gets one property byte: its column
+# width (bits 0-1) and its grapheme class (bits 2-4). The bytes are stored
+# as a two-level table: width_stage1[cp >> 8] picks a 256-entry block of
+# width_stage2, and identical blocks (most of the code space) are shared.
+#
+# Run with "make width-table" after a Python upgrade brings newer data.
+#
+
+import sys
+import unicodedata
+
+BLOCK = 256
+MAX_CP = 0x110000
+
+# Grapheme classes, matching GB_* in tui_width.c
+GB_OTHER = 0
+GB_CONTROL = 1
+GB_EXTEND = 2
+GB_ZWJ = 3
+GB_REGIONAL = 4
+GB_SPACING = 5
+
+
+def props(cp):
+    """Width and grapheme class of one code point"""
+    ch = chr(cp)
+    cat = unicodedata.category(ch)
+    eaw = unicodedata.east_asian_width(ch)
+
+    if cp < 0x20 or 0x7F <= cp < 0xA0:
+        return 0, GB_CONTROL
+    if cp == 0x200D:
+        return 0, GB_ZWJ
+    if 0x1F1E6 <= cp <= 0x1F1FF:
+        return 1, GB_REGIONAL
+    if 0x1F3FB <= cp <= 0x1F3FF:
+        # Emoji skin tone modifiers: wide alone, extend an emoji otherwise
+        return 2, GB_EXTEND
+    if 0x1160 <= cp <= 0x11FF or 0xD7B0 <= cp <= 0xD7FF:
+        # Hangul medial vowels and final consonants join the initial
+        return 0, GB_EXTEND
+    if cp == 0x200C or 0xE0020 <= cp <= 0xE007F:
+        # ZWNJ and the tag characters of emoji tag sequences
+        return 0, GB_EXTEND
+    if cat in ('Mn', 'Me'):
+        return 0, GB_EXTEND
+    if cat == 'Mc':
+        return 1, GB_SPACING
+    if cat == 'Cf':
+        return (1, GB_OTHER) if cp == 0x00AD else (0, GB_CONTROL)
+    if cat in ('Zl', 'Zp', 'Cs'):
+        return 0, GB_CONTROL
+    if eaw in ('W', 'F'):
+        return 2, GB_OTHER
+    if cat == 'Cn' and (0x20000 <= cp <= 0x2FFFD or 0x30000 <= cp <= 0x3FFFD):
+        # Unassigned ideograph planes are reserved for wide characters
+        return 2, GB_OTHER
+    return 1, GB_OTHER
+
+
+def main():
+    blocks = []
+    index = {}
+    stage1 = []
+
+    for base in range(0, MAX_CP, BLOCK):
+        block = []
+        for cp in range(base, base + BLOCK):
+            width, cls = props(cp)
+            block.append(width | cls << 2)
+        block = tuple(block)
+        if block not in index:
+            index[block] = len(blocks)
+            blocks.append(block)
+        stage1.append(index[block])
+
+    if len(blocks) > 256:
+        sys.exit("mkwidthtable: %d blocks do not fit a byte index" % len(blocks))
+
+    out = sys.stdout
+    out.write("/*\n")
+    out.write(" * shelli - Educational Shell\n")
+    out.write(" * tui/tui_width_table.h - Character width table (generated)\n")
+    out.write(" *\n")
+    out.write(" * Generated by tools/mkwidthtable.py from Unicode %s; do not edit.\n"
+              % unicodedata.unidata_version)
+    out.write(" * %d blocks of %d, %d bytes in all.\n"
+              % (len(blocks), BLOCK, len(stage1) + len(blocks) * BLOCK))
+    out.write(" */\n\n")
+    out.write("#define WIDTH_UNICODE_VERSION \"%s\"\n\n" % unicodedata.unidata_version)
+
+    out.write("static const uint8_t width_stage1[%d] = {\n" % len(stage1))
+    for i in range(0, len(stage1), 16):
+        out.write("    " + ", ".join("%d" % b for b in stage1[i:i + 16]) + ",\n")
+    out.write("};\n\n")
+
+    out.write("static const uint8_t width_stage2[%d] = {\n" % (len(blocks) * BLOCK))
+    for n, block in enumerate(blocks):
+        out.write("    /* block %d */\n" % n)
+        for i in range(0, BLOCK, 16):
+            out.write("    " + ", ".join("%d" % b for b in block[i:i + 16]) + ",\n")
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()